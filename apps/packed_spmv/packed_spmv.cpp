@@ -0,0 +1,103 @@
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "taco.h"
+#include "taco/util/timers.h"
+
+using namespace taco;
+
+// Benchmarks y = A*x with the columns of A stored as Int32 coordinates (CSR)
+// and as bit-packed coordinates, and reports the bytes each kernel moves and
+// its throughput.
+//
+// Usage: packed_spmv [rows] [nonzeros per row] [band width] [repeats]
+
+/// The bytes a kernel moves at least: the index and values of A, and x and y.
+static size_t bytesMoved(const Tensor<double>& A, int rows, int cols) {
+  return A.getStorage().getSizeInBytes() +
+         (size_t)(rows + cols) * sizeof(double);
+}
+
+static size_t indexBytes(const Tensor<double>& A) {
+  size_t bytes = 0;
+  for (auto& modeSizes : A.getStorage().getIndexSizesInBytes()) {
+    for (size_t size : modeSizes) {
+      bytes += size;
+    }
+  }
+  return bytes;
+}
+
+static util::TimeResults benchmark(Tensor<double>& y,
+                                   const Tensor<double>& A,
+                                   const Tensor<double>& x, int repeats) {
+  IndexVar i, j;
+  y(i) = A(i,j) * x(j);
+  y.compile();
+  y.assemble();
+  util::Timer timer;
+  for (int r = 0; r < repeats; r++) {
+    timer.start();
+    y.compute();
+    timer.stop();
+  }
+  return timer.getResult();
+}
+
+static void report(std::string name, const Tensor<double>& A, int rows,
+                   int cols, size_t nnz, util::TimeResults result) {
+  double seconds = result.median / 1000;
+  size_t bytes = bytesMoved(A, rows, cols);
+  std::cout << name << std::endl
+            << "  index bytes:  " << indexBytes(A) << std::endl
+            << "  bytes moved:  " << bytes << std::endl
+            << "  median (ms):  " << result.median << std::endl
+            << "  nonzeros/s:   " << nnz / seconds << std::endl
+            << "  GB/s:         " << bytes / seconds / 1e9 << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+  int rows      = (argc > 1) ? atoi(argv[1]) : 100000;
+  int rowNnz    = (argc > 2) ? atoi(argv[2]) : 32;
+  int bandWidth = (argc > 3) ? atoi(argv[3]) : 1024;
+  int repeats   = (argc > 4) ? atoi(argv[4]) : 20;
+  int cols      = rows;
+
+  // The nonzeros of each row lie in a band around the diagonal, so the
+  // differences of their coordinates fit in few bits
+  Tensor<double> Acsr({rows, cols}, CSR);
+  Tensor<double> Apacked({rows, cols}, Format({Dense,Packed}));
+  size_t nnz = 0;
+  for (int i = 0; i < rows; i++) {
+    int first = std::max(0, std::min(i - bandWidth/2, cols - bandWidth));
+    int stride = std::max(1, bandWidth / rowNnz);
+    for (int j = first; j < std::min(cols, first + bandWidth); j += stride) {
+      double value = (double)((i + j) % 7 + 1);
+      Acsr.insert({i, j}, value);
+      Apacked.insert({i, j}, value);
+      nnz++;
+    }
+  }
+  Tensor<double> x({cols}, Format({Dense}));
+  for (int j = 0; j < cols; j++) {
+    x.insert({j}, 1.0 / (j + 1));
+  }
+  Acsr.pack();
+  Apacked.pack();
+  x.pack();
+
+  Tensor<double> ycsr({rows}, Format({Dense}));
+  Tensor<double> ypacked({rows}, Format({Dense}));
+  util::TimeResults csrResult    = benchmark(ycsr, Acsr, x, repeats);
+  util::TimeResults packedResult = benchmark(ypacked, Apacked, x, repeats);
+
+  std::cout << rows << "x" << cols << " matrix with " << nnz << " nonzeros"
+            << std::endl;
+  report("Int32 coordinates (CSR)", Acsr, rows, cols, nnz, csrResult);
+  report("Packed coordinates", Apacked, rows, cols, nnz, packedResult);
+  if (!equals(ycsr, ypacked)) {
+    std::cerr << "The results differ" << std::endl;
+    return 1;
+  }
+}
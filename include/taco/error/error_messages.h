@@ -18,12 +18,33 @@ extern const std::string expr_einsum_missformed;
 
 // compile error messages
 extern const std::string compile_without_expr;
+extern const std::string compile_merge_duplicates;
+extern const std::string compile_duplicates_sparse_result;
+extern const std::string compile_hashed_operand;
+extern const std::string compile_hashed_result;
+extern const std::string format_hashed_mode;
+extern const std::string format_diagonal_mode;
+extern const std::string format_index_type;
+extern const std::string format_index_width;
+extern const std::string format_packed_mode;
+extern const std::string compile_hashed_assemble_while_compute;
+extern const std::string compile_bitmap_result;
+extern const std::string compile_fixed_result;
+extern const std::string compile_diagonal_result;
+extern const std::string compile_packed_result;
+
+// conversion error messages
+extern const std::string convert_mode_ordering;
+extern const std::string convert_component_type;
+extern const std::string convert_unpacked_source;
 
 // assemble error messages
 extern const std::string assemble_without_compile;
 
 // compute error messages
 extern const std::string compute_without_compile;
+extern const std::string compute_without_others;
+extern const std::string compute_pending_operand;
 
 // factory function error messages
 extern const std::string requires_matrix;
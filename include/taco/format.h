@@ -10,9 +10,14 @@
 namespace taco {
 
 enum ModeType {
-  Dense,   // e.g. first  mode in CSR
-  Sparse,  // e.g. second mode in CSR
-  Fixed    // e.g. second mode in ELL
+  Dense,     // e.g. first  mode in CSR
+  Sparse,    // e.g. second mode in CSR
+  Fixed,     // e.g. second mode in ELL
+  Singleton, // e.g. second mode in COO
+  Hashed,    // e.g. second mode of a matrix with hash maps as rows
+  Bitmap,    // e.g. second mode of a matrix with bit vectors as rows
+  Diagonal,  // e.g. second mode in DIA
+  Packed     // e.g. second mode of CSR with bit-packed coordinates
 };
 
 class Format {
@@ -76,9 +81,27 @@ extern const Format CSR;
 extern const Format CSC;
 extern const Format DCSR;
 extern const Format DCSC;
+extern const Format COO;
+
+/// Block compressed sparse row format of a blocked matrix, whose modes are the
+/// block row, the block column, and the row and column within a block (see
+/// Tensor::block).
+extern const Format BCSR;
+
+/// Diagonal format of a matrix, which stores the offsets of the non-empty
+/// diagonals and the values of each diagonal contiguously.
+extern const Format DIA;
 
 /// True if all modes are Dense
 bool isDense(const Format&);
 
+/// True if the mode stored in position i stores one coordinate per stored
+/// coordinate of the mode below it, so that its segments may contain the same
+/// coordinate several times (e.g. the first mode in COO).
+bool hasDuplicates(const Format&, size_t i);
+
+/// True if the format has a hashed mode.
+bool isHashed(const Format&);
+
 }
 #endif
@@ -571,6 +571,9 @@ public:
   /// Set the name of the tensor variable.
   void setName(std::string name);
 
+  /// Set the format of the tensor variable, e.g. to change its index types.
+  void setFormat(const Format& format);
+
   /// Set the index assignment statement that computes the tensor's values.
   void setAssignment(Assignment assignment);
 
@@ -46,6 +46,23 @@ public:
   /// Removes operator splits from the schedule.
   void clearOperatorSplits();
 
+  /// Returns the largest dense mode dimension that loops are specialized to.
+  size_t getMaxSpecializedDimension() const;
+
+  /// Specialize the loops over dense modes whose dimension is a compile-time
+  /// constant no larger than `dimension`, by fully unrolling them. A value of
+  /// zero (the default) leaves the loops rolled.
+  void setMaxSpecializedDimension(size_t dimension);
+
+  /// Returns the number of loop iterations ahead that indirectly accessed
+  /// operand values are prefetched.
+  size_t getPrefetchDistance() const;
+
+  /// Prefetch the operand values that a loop over a sparse level accesses
+  /// through its indices `distance` iterations ahead. A distance of zero (the
+  /// default) disables prefetching.
+  void setPrefetchDistance(size_t distance);
+
 private:
   struct Content;
   std::shared_ptr<Content> content;
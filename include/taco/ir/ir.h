@@ -43,6 +43,7 @@ enum class IRNodeType {
   Case,
   Switch,
   Load,
+  Call,
   Store,
   For,
   While,
@@ -54,6 +55,7 @@ enum class IRNodeType {
   Comment,
   BlankLine,
   Print,
+  Prefetch,
   GetProperty
 };
 
@@ -450,6 +452,18 @@ public:
   static const IRNodeType _type_info = IRNodeType::Load;
 };
 
+/** A call to a function of the runtime library: func(args...). */
+struct Call : public ExprNode<Call> {
+public:
+  std::string func;
+  std::vector<Expr> args;
+
+  static Expr make(const std::string& func, const std::vector<Expr>& args,
+                   DataType returnType);
+
+  static const IRNodeType _type_info = IRNodeType::Call;
+};
+
 /** A sequence of statements. */
 struct Block : public StmtNode<Block> {
 public:
@@ -519,7 +533,7 @@ public:
   static const IRNodeType _type_info = IRNodeType::Switch;
 };
 
-enum class LoopKind {Serial, Static, Dynamic, Vectorized};
+enum class LoopKind {Serial, Static, Dynamic, Vectorized, Unrolled};
 
 /** A for loop from start to end by increment.
  * A vectorized loop will require the increment to be 1 and the
@@ -528,6 +542,8 @@ enum class LoopKind {Serial, Static, Dynamic, Vectorized};
  * If the loop is vectorized, the width says which vector width
  * to use.  By default (0), it will not set a specific width and
  * let clang determine the width to use.
+ *
+ * An unrolled loop must have literal bounds, and is fully unrolled.
  */
 struct For : public StmtNode<For> {
 public:
@@ -631,6 +647,20 @@ public:
   static const IRNodeType _type_info = IRNodeType::Print;
 };
 
+/** A prefetch of an array element.
+ * Hints that `arr[loc]` will soon be loaded, so that its cache line can be
+ * fetched ahead of the load. It has no other effect.
+ */
+struct Prefetch : public StmtNode<Prefetch> {
+public:
+  Expr arr;
+  Expr loc;
+
+  static Stmt make(Expr arr, Expr loc);
+
+  static const IRNodeType _type_info = IRNodeType::Prefetch;
+};
+
 /** A tensor property.
  * This unpacks one of the properties of a tensor into an Expr.
  */
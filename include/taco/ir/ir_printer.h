@@ -46,6 +46,7 @@ protected:
   virtual void visit(const Case*);
   virtual void visit(const Switch*);
   virtual void visit(const Load*);
+  virtual void visit(const Call*);
   virtual void visit(const Store*);
   virtual void visit(const For*);
   virtual void visit(const While*);
@@ -57,6 +58,7 @@ protected:
   virtual void visit(const Comment*);
   virtual void visit(const BlankLine*);
   virtual void visit(const Print*);
+  virtual void visit(const Prefetch*);
   virtual void visit(const GetProperty*);
 
   std::ostream &stream;
@@ -1,6 +1,8 @@
 #ifndef TACO_IR_REWRITER_H
 #define TACO_IR_REWRITER_H
 
+#include <map>
+
 #include "taco/ir/ir_visitor.h"
 #include "taco/ir/ir.h"
 
@@ -49,6 +51,7 @@ protected:
   virtual void visit(const Case* op);
   virtual void visit(const Switch* op);
   virtual void visit(const Load* op);
+  virtual void visit(const Call* op);
   virtual void visit(const Store* op);
   virtual void visit(const For* op);
   virtual void visit(const While* op);
@@ -60,8 +63,17 @@ protected:
   virtual void visit(const Comment* op);
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
+  virtual void visit(const Prefetch* op);
   virtual void visit(const GetProperty* op);
 };
 
+/// Rewrite the expression, replacing the variables that are keys of the
+/// substitution map with the expressions they map to.
+Expr replace(Expr expr, const std::map<Expr,Expr>& substitutions);
+
+/// Rewrite the statement, replacing the variables that are keys of the
+/// substitution map with the expressions they map to.
+Stmt replace(Stmt stmt, const std::map<Expr,Expr>& substitutions);
+
 }}
 #endif
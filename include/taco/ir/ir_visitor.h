@@ -29,6 +29,7 @@ struct IfThenElse;
 struct Case;
 struct Switch;
 struct Load;
+struct Call;
 struct Store;
 struct For;
 struct While;
@@ -40,6 +41,7 @@ struct Allocate;
 struct Comment;
 struct BlankLine;
 struct Print;
+struct Prefetch;
 struct GetProperty;
 
 /// Extend this class to visit every node in the IR.
@@ -72,6 +74,7 @@ public:
   virtual void visit(const Case*) = 0;
   virtual void visit(const Switch*) = 0;
   virtual void visit(const Load*) = 0;
+  virtual void visit(const Call*) = 0;
   virtual void visit(const Store*) = 0;
   virtual void visit(const For*) = 0;
   virtual void visit(const While*) = 0;
@@ -83,6 +86,7 @@ public:
   virtual void visit(const Comment*) = 0;
   virtual void visit(const BlankLine*) = 0;
   virtual void visit(const Print*) = 0;
+  virtual void visit(const Prefetch*) = 0;
   virtual void visit(const GetProperty*) = 0;
 };
 
@@ -118,6 +122,7 @@ public:
   virtual void visit(const Case* op);
   virtual void visit(const Switch* op);
   virtual void visit(const Load* op);
+  virtual void visit(const Call* op);
   virtual void visit(const Store* op);
   virtual void visit(const For* op);
   virtual void visit(const While* op);
@@ -129,6 +134,7 @@ public:
   virtual void visit(const Comment* op);
   virtual void visit(const BlankLine* op);
   virtual void visit(const Print* op);
+  virtual void visit(const Prefetch* op);
   virtual void visit(const GetProperty* op);
 };
 
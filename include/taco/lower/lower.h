@@ -24,5 +24,13 @@ enum Property {
 ir::Stmt lower(TensorVar tensor, std::string functionName,
                std::set<Property> properties, int allocSize);
 
+/// Lower an index statement built from assignments, multi statements and
+/// sequence statements into one function that computes all the results. The
+/// results are the function outputs and the other operands are the inputs, in
+/// the order the assignments first access them. Loops of the assignments that
+/// iterate over the same space are fused, so that operands are read once.
+ir::Stmt lower(IndexStmt stmt, std::string functionName,
+               std::set<Property> properties, int allocSize);
+
 }}
 #endif
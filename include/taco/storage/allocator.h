@@ -0,0 +1,115 @@
+#ifndef TACO_STORAGE_ALLOCATOR_H
+#define TACO_STORAGE_ALLOCATOR_H
+
+#include <cstddef>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+namespace storage {
+
+/// An allocator provides the memory of the index and value arrays of tensors:
+/// both the arrays the library allocates (e.g. when packing) and the arrays
+/// generated kernels allocate for results. Its functions must behave like
+/// malloc, realloc and free, and are passed the context of the allocator, so
+/// custom allocators can place tensors in memory pools, huge pages or pinned
+/// memory. This *must* be kept in sync with taco_allocator_t.
+struct Allocator {
+  void* (*allocate)(void* context, size_t size);
+  void* (*reallocate)(void* context, void* data, size_t size);
+  void  (*deallocate)(void* context, void* data);
+  void* context;
+};
+
+/// The alignment, in bytes, of the arrays of aligned allocators.
+const size_t ARRAY_ALIGNMENT = 64;
+
+/// How aligned allocators back large arrays with huge pages.
+enum class HugePages {
+  /// Never use huge pages.
+  None,
+
+  /// Map large arrays and advise the kernel to back them with transparent
+  /// huge pages.
+  Transparent,
+
+  /// Map large arrays from the reserved huge page pool, falling back to
+  /// transparent huge pages when the pool is exhausted.
+  Explicit
+};
+
+/// Returns the allocator that calls malloc, realloc and free.
+Allocator getDefaultAllocator();
+
+/// Returns an allocator whose arrays are aligned to ARRAY_ALIGNMENT bytes, and
+/// whose arrays of at least `hugePageThreshold` bytes are mapped on their own
+/// and backed by huge pages. Kernels compiled while an aligned allocator is
+/// set assume their arrays are aligned.
+Allocator getAlignedAllocator(HugePages hugePages=HugePages::Transparent,
+                              size_t hugePageThreshold=(1 << 21));
+
+/// Returns true if the arrays of the allocator are aligned to ARRAY_ALIGNMENT.
+bool isAligned(const Allocator& allocator);
+
+/// Returns the allocator that new arrays are allocated with.
+Allocator getAllocator();
+
+/// Set the allocator that new arrays are allocated with. Arrays are reclaimed
+/// by the allocator that allocated them, so arrays allocated by a previous
+/// allocator may outlive the switch.
+void setAllocator(const Allocator& allocator);
+
+/// Statistics of the memory allocated by the default and aligned allocators,
+/// and of the temporary memory the library records while packing tensors.
+struct MemoryStats {
+  /// The number of bytes that are allocated
+  size_t liveBytes;
+
+  /// The largest number of bytes that were allocated at once since the peak
+  /// was last reset
+  size_t peakBytes;
+
+  /// The number of allocations and reallocations
+  size_t numAllocations;
+};
+
+/// Returns the statistics of the memory allocated by the library.
+MemoryStats getMemoryStats();
+
+/// Reset the peak of the memory statistics to the number of live bytes, so
+/// the peak of an operation can be measured.
+void resetPeakMemory();
+
+/// Record that `bytes` bytes were allocated, or deallocated, outside of the
+/// allocators, so that they count towards the memory statistics.
+void recordAllocation(size_t bytes);
+void recordDeallocation(size_t bytes);
+
+struct ArenaContent;
+
+/// An arena recycles the arrays allocated through it. Deallocated arrays are
+/// kept, and allocating an array of the same size again reuses one, so results
+/// that are assembled with the same structure repeatedly reuse the arrays of
+/// previous assemblies instead of allocating new ones. Arrays that outlive the
+/// arena are reclaimed by the underlying allocator.
+class Arena : util::Uncopyable {
+public:
+  /// Create an arena that allocates new arrays with `allocator`.
+  Arena(const Allocator& allocator=storage::getAllocator());
+  ~Arena();
+
+  /// Returns an allocator that allocates through the arena.
+  Allocator getAllocator() const;
+
+  /// Returns the number of bytes of the deallocated arrays the arena keeps.
+  size_t getKeptBytes() const;
+
+  /// Reclaim the deallocated arrays the arena keeps.
+  void clear();
+
+private:
+  ArenaContent* content;
+};
+
+}}
+#endif
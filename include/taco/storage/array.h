@@ -4,6 +4,7 @@
 #include <memory>
 #include <ostream>
 #include <taco/type.h>
+#include <taco/storage/allocator.h>
 #include <taco/storage/typed_value.h>
 
 namespace taco {
@@ -15,8 +16,10 @@ class Array {
 public:
   /// The memory reclamation policy of Array objects. UserOwns means the Array
   /// object will not free its data, free means it will reclaim data  with the
-  /// C free function and delete means it will reclaim data with delete[].
-  enum Policy {UserOwns, Free, Delete};
+  /// C free function, delete means it will reclaim data with delete[],
+  /// deallocate means it will reclaim data with the allocator of the array and
+  /// unmap means the data is a memory mapping of its own that it will unmap.
+  enum Policy {UserOwns, Free, Delete, Deallocate, Unmap};
 
   /// Construct an empty array of undefined elements.
   Array();
@@ -24,6 +27,10 @@ public:
   /// Construct an array of elements of the given type.
   Array(DataType type, void* data, size_t size, Policy policy=Free);
 
+  /// Construct an array of elements of the given type, whose data was
+  /// allocated by `allocator` and is reclaimed by it.
+  Array(DataType type, void* data, size_t size, const Allocator& allocator);
+
   /// Returns the type of the array elements
   const DataType& getType() const;
 
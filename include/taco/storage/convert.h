@@ -0,0 +1,28 @@
+/// The conversion machinery converts the storage of a tensor to another format
+/// or mode order without inserting its components one at a time. The stored
+/// components are unpacked in the order of the source levels, sorted into the
+/// order of the target levels with stable counting sorts (a histogram and a
+/// prefix sum of the coordinates of one level per pass), and packed straight
+/// from the sorted entries, so no memory proportional to the dimensions is
+/// used besides the dense levels of the result.
+
+#ifndef TACO_STORAGE_CONVERT_H
+#define TACO_STORAGE_CONVERT_H
+
+#include <vector>
+
+namespace taco {
+class Format;
+namespace storage {
+class Storage;
+
+/// Convert `storage`, the storage of a tensor with the given dimensions, to
+/// `format`. Mode i of the converted tensor is mode `modeOrdering[i]` of the
+/// original tensor, so the mode ordering {1,0} transposes a matrix. Only the
+/// levels of `format` whose order differs from the source levels are sorted,
+/// so for example a CSR to CSC conversion takes one counting sort pass.
+Storage convert(const Storage& storage, const std::vector<int>& dimensions,
+                const std::vector<int>& modeOrdering, const Format& format);
+
+}}
+#endif
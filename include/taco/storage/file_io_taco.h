@@ -0,0 +1,41 @@
+/// Read and write the native binary tensor format of taco, which stores the
+/// packed arrays of a tensor so that loading it needs no parsing or packing.
+/// A file starts with a header of the component type, dimensions and format
+/// of the tensor, including the types of its index arrays, followed by the
+/// index arrays of each level and the value array. Every array starts at a
+/// multiple of 4096 bytes, so that it can be memory mapped on its own. Numbers
+/// are stored in the byte order of the machine that wrote the file.
+
+#ifndef TACO_FILE_IO_TACO_H
+#define TACO_FILE_IO_TACO_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace taco {
+class TensorBase;
+class Format;
+
+/// Read a tensor in the binary format from a file. The arrays of the tensor
+/// are memory mapped from the file rather than read, so reading takes
+/// constant time and the pages of the arrays are loaded as they are accessed.
+/// Changes to the arrays are not written back to the file. If `format`
+/// differs from the format of the file then the tensor is converted to it.
+/// The tensor is always packed.
+TensorBase readTaco(std::string filename, const Format& format,
+                    bool pack=true);
+
+/// Read a tensor in the binary format from a stream.
+TensorBase readTaco(std::istream& stream, const Format& format,
+                    bool pack=true);
+
+/// Write a packed tensor in the binary format to a file.
+void writeTaco(std::string filename, const TensorBase& tensor);
+
+/// Write a packed tensor in the binary format to a stream.
+void writeTaco(std::ostream& stream, const TensorBase& tensor);
+
+}
+
+#endif
@@ -7,6 +7,7 @@
 #define TACO_STORAGE_PACK_H
 
 #include <climits>
+#include <memory>
 #include <vector>
 #include "taco/type.h"
 #include "taco/storage/typed_vector.h"
@@ -28,6 +29,62 @@ Storage pack(const std::vector<int>&              dimensions,
              const size_t numCoordinates,
              DataType datatype);
 
+/// Returns true if `format` can be packed by packEntries: if its modes are
+/// dense, sparse, singleton, packed or hashed modes.
+bool canPackEntries(const Format& format);
+
+/// Pack tensor entries into a format. The entries are stored as an array of
+/// structures, where each entry of `entrySize` bytes is the coordinates of
+/// the entry as ints followed by its value. The entries must be sorted
+/// lexicographically and have distinct coordinates. The packed arrays are
+/// counted in one pass over the entries, allocated at their final sizes and
+/// filled in a second pass, so the only memory pack uses besides the entries
+/// is the packed tensor. If `chunkSize` is not zero then the memory of the
+/// entries is released every `chunkSize` bytes as they are packed, and the
+/// released entries are lost.
+Storage packEntries(const std::vector<int>& dimensions, const Format& format,
+                    char* entries, size_t numEntries, size_t entrySize,
+                    DataType datatype, size_t chunkSize);
+
+/// Returns true if `format` can be built by a StorageBuilder: if its modes are
+/// dense or sparse modes.
+bool canBuildStorage(const Format& format);
+
+/// Builds the storage of a tensor in one pass over its components, which are
+/// appended sorted lexicographically in the order of the levels of the format.
+/// The index and value arrays of every level grow as components are appended,
+/// so unlike pack the only memory used is that of the storage.
+class StorageBuilder {
+public:
+  /// Create a builder of a tensor whose levels have the given dimensions.
+  StorageBuilder(const std::vector<int>& dimensions, const Format& format,
+                 DataType datatype);
+
+  /// Reserve space for `numComponents` components.
+  void reserve(size_t numComponents);
+
+  /// Append the component at `coordinates`, which are given in the order of
+  /// the levels. Returns false, and appends nothing, if the component comes
+  /// before the previous component. Like in pack, a component at the same
+  /// coordinates as the previous one is ignored.
+  bool append(const int* coordinates, const void* value);
+
+  /// Returns the built storage. No components may be appended afterwards.
+  Storage getStorage();
+
+private:
+  struct Content;
+  std::shared_ptr<Content> content;
+};
+
+/// Convert the hashed last mode of a storage, whose other modes are dense, to
+/// a sparse mode whose segments are sorted.
+Storage sortHashedModes(const Storage& storage);
+
+/// Convert the sparse last mode of a storage, whose other modes are dense, to
+/// the hashed last mode of `format`.
+Storage hashSparseModes(const Storage& storage, const Format& format);
+
 /// Generate code to pack tensor coordinates into a specific format. In the
 /// generated code the coordinates must be stored as a structure of arrays,
 /// that is one vector per axis coordinate and one vector for the values.
@@ -45,7 +45,13 @@ public:
   Array getValues();
 
   /// Returns the size of the storage in bytes.
-  size_t getSizeInBytes();
+  size_t getSizeInBytes() const;
+
+  /// Returns the size in bytes of each index array of each mode.
+  std::vector<std::vector<size_t>> getIndexSizesInBytes() const;
+
+  /// Returns the size of the value array in bytes.
+  size_t getValuesSizeInBytes() const;
 
 private:
   struct Content;
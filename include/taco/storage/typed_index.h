@@ -27,7 +27,7 @@ protected:
   /// Sets mem to value (ensure that it does not write to bytes past the size of the type in the union)
   void set(IndexTypeUnion& mem, const IndexTypeUnion& value);
   /// Sets mem to casted value of integer
-  void setInt(IndexTypeUnion& mem, const int value);
+  void setInt(IndexTypeUnion& mem, const long long value);
   /// Add the values of two IndexTypeUnions into a result
   void add(IndexTypeUnion& result, const IndexTypeUnion& a, const IndexTypeUnion& b) const;
   /// Add the values of one IndexTypeUnions with an integer constant into a result
@@ -54,7 +54,7 @@ public:
   /// Create a TypedIndexVal initialized with the value and type of ref
   TypedIndexVal(TypedIndexRef ref);
   /// Create a TypedIndexVal initialized with the value stored at ptr of the size of DataType t
-  TypedIndexVal(DataType t, int constant) {
+  TypedIndexVal(DataType t, long long constant) {
     dType = t;
     set(constant);
   }
@@ -75,7 +75,7 @@ public:
   /// Sets the value to the value of a TypedIndexRef (must be same type)
   void set(TypedIndexRef value);
   /// Sets the value to the value of a constant
-  void set(int constant);
+  void set(long long constant);
   /// Sets the value to the value of a TypedComponentVal (must be same type)
   void set(TypedComponentVal val);
   /// Sets the value to the value of a TypedComponentRef (must be same type)
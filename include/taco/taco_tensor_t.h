@@ -5,7 +5,9 @@
 #ifndef TACO_TENSOR_T_DEFINED
 #define TACO_TENSOR_T_DEFINED
 
-typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;
+typedef enum { taco_mode_dense, taco_mode_sparse, taco_mode_singleton,
+               taco_mode_hashed, taco_mode_bitmap, taco_mode_fixed,
+               taco_mode_diagonal, taco_mode_packed } taco_mode_t;
 
 typedef struct {
   int32_t      order;         // tensor order (number of modes)
@@ -17,4 +19,13 @@ typedef struct {
   uint8_t*     vals;          // tensor values
 } taco_tensor_t;
 
+// The functions that generated kernels allocate result arrays with, which
+// receive the context (see storage::Allocator)
+typedef struct {
+  void* (*allocate)(void* context, size_t size);
+  void* (*reallocate)(void* context, void* data, size_t size);
+  void  (*deallocate)(void* context, void* data);
+  void* context;
+} taco_allocator_t;
+
 #endif
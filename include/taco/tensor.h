@@ -78,6 +78,15 @@ public:
   /// Reserve space for `numCoordinates` additional coordinates.
   void reserve(size_t numCoordinates);
 
+  /// Returns the number of bytes of an entry of the coordinate buffer: the
+  /// getOrder() int coordinates of a component followed by its value.
+  size_t getEntrySize() const;
+
+  /// Insert the components in `entries`, a buffer of getEntrySize()-byte
+  /// entries, in bulk. The buffer is taken over without a copy when no other
+  /// components have been inserted since the tensor was last packed.
+  void insertEntries(std::vector<char>&& entries);
+
   /// Insert a value into the tensor. The number of coordinates must match the
   /// tensor order.
   template <typename T>
@@ -134,6 +143,17 @@ public:
   /// Pack tensor into the given format
   void pack();
 
+  /// Pack the components of `source` into the format of this tensor, where
+  /// mode i of this tensor is mode `modeOrdering[i]` of the source. The
+  /// components are converted directly from the storage of the source rather
+  /// than inserted and sorted, which makes format conversions and transposes
+  /// take linear time.
+  void pack(const TensorBase& source, const std::vector<int>& modeOrdering);
+
+  /// Returns a copy of this tensor whose hashed mode is converted to a sparse
+  /// mode with sorted segments, or this tensor if it has no hashed mode.
+  TensorBase sortHashedModes() const;
+
   /// Zero out the values
   void zero();
 
@@ -173,9 +193,35 @@ public:
   /// Compute the given expression and put the values in the tensor storage.
   void compute();
 
-  /// Compile, assemble and compute as needed.
+  /// Compile, assemble and compute as needed, after evaluating the tensors it
+  /// (transitively) reads whose assignments have not been computed.
   void evaluate();
 
+  /// Evaluate the tensor together with the tensors it (transitively) reads
+  /// whose assignments have not been computed. A temporary that is only read
+  /// once, where its assignment can be substituted for the access, is inlined
+  /// into the expression that reads it and is not computed. The kernels read
+  /// the operands of inlined temporaries instead, but the tensors keep their
+  /// assignments, so eliminated temporaries can still be evaluated later. The
+  /// remaining temporaries are computed in the tensor's kernels, and copies
+  /// are converted in between. Returns the eliminated temporaries.
+  std::vector<TensorBase> evaluateLazily();
+
+  /// True if the tensor's assignment has not been computed since it was set.
+  bool needsCompute() const;
+
+  /// True if the tensor's assignment only copies a tensor into the format or
+  /// mode order of this tensor, which is computed by converting its storage.
+  bool isConversion() const;
+
+  /// Rewrite a product of three or more tensors in the tensor's assignment,
+  /// such as `A(i,l) = B(i,j)*C(j,k)*D(k,l)`, into pairwise products through
+  /// temporaries, if that is estimated to be cheaper given the dimensions and
+  /// densities of the operands. The contraction order minimizes the estimated
+  /// number of multiplications. Returns the temporaries in the order they must
+  /// be computed, which `evaluateLazily` computes together with the tensor.
+  std::vector<TensorBase> optimizeContractionOrder();
+
   /// Get the source code of the kernel functions.
   std::string getSource() const;
 
@@ -198,9 +244,47 @@ public:
   /// Get the size of the initial index allocations.
   size_t getAllocSize() const;
 
+  /// Set whether `pack` stores the index arrays of sparse and singleton modes
+  /// with the narrowest integer types that fit the packed tensor: coordinates
+  /// by the dimension of their mode and positions by the number of entries.
+  /// Kernels that read the tensor are recompiled when its index types change.
+  void setIndexNarrowing(bool narrow);
+
+  /// Returns true if `pack` narrows the index arrays of the tensor.
+  bool getIndexNarrowing() const;
+
+  /// Set the number of bytes of inserted coordinates that `pack` packs before
+  /// it releases their memory. Since the packed arrays are mapped on demand as
+  /// they are filled, this bounds the resident memory of packing a large
+  /// tensor to about the larger of its inserted coordinates and its packed
+  /// arrays, plus the budget. A budget of zero releases the coordinates only
+  /// once they are all packed. The default budget is 16MB.
+  void setPackBudget(size_t budget);
+
+  /// Get the number of bytes of inserted coordinates `pack` packs before it
+  /// releases their memory.
+  size_t getPackBudget() const;
+
+  /// Set whether the structure of the tensor is fixed once it is assembled, as
+  /// when the same expression is computed with new values every iteration.
+  /// Assembling a tensor with fixed structure then keeps its index and value
+  /// arrays, and computing it only computes into its value array, until the
+  /// tensor is packed again.
+  void setFixedStructure(bool fixed);
+
+  /// Returns true if the structure of the tensor is fixed once it is assembled.
+  bool getFixedStructure() const;
+
   /// Get the taco_tensor_t representation of this tensor.
   taco_tensor_t* getTacoTensorT();
 
+  /// Compile, assemble and compute several tensors together.
+  friend void compile(const std::vector<TensorBase>&, bool);
+  friend void compile(const std::vector<TensorBase>&,
+                      const std::vector<Assignment>&, bool);
+  friend void assemble(const std::vector<TensorBase>&);
+  friend void compute(const std::vector<TensorBase>&);
+
   /// True iff two tensors have the same type and the same values.
   friend bool equals(const TensorBase&, const TensorBase&);
 
@@ -262,7 +346,8 @@ public:
         " components to a Tensor<" << type<CType>() << ">";
   }
 
-  /// Simple transpose that packs a new tensor from the values in the current tensor
+  /// Transpose the tensor into a new tensor whose mode i is mode
+  /// `newModeOrdering[i]` of this tensor (see TensorBase::pack).
   Tensor<CType> transpose(std::string name, std::vector<int> newModeOrdering) const {
     return transpose(name, newModeOrdering, getFormat());
   }
@@ -280,15 +365,62 @@ public:
     }
 
     Tensor<CType> newTensor(name, newDimensions, format);
+    newTensor.pack(*this, newModeOrdering);
+    return newTensor;
+  }
+
+  /// Reinterpret the tensor as a tensor of dense blocks with the given block
+  /// sizes (e.g. a BCSR matrix). The blocked tensor has twice the order: mode
+  /// i indexes the blocks along mode i, and mode order+i indexes the
+  /// components within a block. Blocks at the tensor edges are padded with
+  /// zeros. Block loops of small fixed size are unrolled when the schedule of
+  /// the result sets a large enough maximum specialized dimension.
+  Tensor<CType> block(const std::vector<int>& blockSizes,
+                      Format format=BCSR) const {
+    taco_uassert(blockSizes.size() == getOrder()) <<
+        "The tensor " << getName() << " must have one block size per mode";
+    std::vector<int> blockedDimensions(2 * getOrder());
+    for (size_t i = 0; i < getOrder(); ++i) {
+      taco_uassert(blockSizes[i] > 0) << "Block sizes must be positive";
+      blockedDimensions[i] = (getDimension(i) + blockSizes[i] - 1) / blockSizes[i];
+      blockedDimensions[getOrder() + i] = blockSizes[i];
+    }
+
+    Tensor<CType> blocked(util::uniqueName('A'), blockedDimensions, format);
+    std::vector<int> blockedCoordinate(2 * getOrder());
     for (const std::pair<std::vector<size_t>,CType>& value : *this) {
-      std::vector<int> newCoordinate;
-      for (int mode : newModeOrdering) {
-        newCoordinate.push_back((int) value.first[mode]);
+      for (size_t i = 0; i < getOrder(); ++i) {
+        blockedCoordinate[i] = (int)value.first[i] / blockSizes[i];
+        blockedCoordinate[getOrder() + i] = (int)value.first[i] % blockSizes[i];
       }
-      newTensor.insert(newCoordinate, value.second);
+      blocked.insert(blockedCoordinate, value.second);
     }
-    newTensor.pack();
-    return newTensor;
+    blocked.pack();
+    return blocked;
+  }
+
+  /// Reinterpret a tensor of dense blocks (see block) as a tensor with the
+  /// given dimensions, dropping the zeros stored in the blocks.
+  Tensor<CType> unblock(const std::vector<int>& dimensions,
+                        Format format) const {
+    taco_uassert(getOrder() == 2 * dimensions.size()) <<
+        "The tensor " << getName() << " must have one block mode per mode";
+    size_t order = dimensions.size();
+    Tensor<CType> unblocked(util::uniqueName('A'), dimensions, format);
+    std::vector<int> coordinate(order);
+    for (const std::pair<std::vector<size_t>,CType>& value : *this) {
+      bool inBounds = true;
+      for (size_t i = 0; i < order; ++i) {
+        coordinate[i] = (int)(value.first[i] * getDimension(order + i) +
+                              value.first[order + i]);
+        inBounds = inBounds && coordinate[i] < dimensions[i];
+      }
+      if (inBounds && value.second != CType()) {
+        unblocked.insert(coordinate, value.second);
+      }
+    }
+    unblocked.pack();
+    return unblocked;
   }
 
   template<typename T>
@@ -437,6 +569,106 @@ public:
           }
           break;
         }
+        case Singleton: {
+          const auto& idx = modeIndex.getIndexArray(0);
+
+          if (advance) {
+            goto resume_singleton;
+          }
+
+          ptrs[lvl] = ptrs[lvl - 1];
+          coord[lvl] = idx.get(ptrs[lvl].getAsIndex()).getAsIndex();
+
+        resume_singleton:
+          if (advanceIndex(lvl + 1)) {
+            return true;
+          }
+          break;
+        }
+        case Bitmap: {
+          const auto& bits = modeIndex.getIndexArray(1);
+          const auto& rank = modeIndex.getIndexArray(2);
+          const size_t size = modeIndex.getIndexArray(0)[0].getAsIndex();
+          const size_t numWords = (size + 31) / 32;
+          const TypedIndexVal  k   = (lvl == 0) ? TypedIndexVal(type<T>(), 0) : ptrs[lvl - 1];
+          const size_t firstWord = k.getAsIndex() * numWords;
+
+          if (advance) {
+            goto resume_bitmap;
+          }
+
+          ptrs[lvl] = rank.get(firstWord).getAsIndex();
+          for (coord[lvl] = 0; coord[lvl] < size; ++coord[lvl]) {
+            if (((uint32_t)bits.get(firstWord + coord[lvl].getAsIndex() / 32)
+                     .getAsIndex() >> (coord[lvl].getAsIndex() % 32)) & 1) {
+            resume_bitmap:
+              if (advanceIndex(lvl + 1)) {
+                return true;
+              }
+              ++ptrs[lvl];
+            }
+          }
+          break;
+        }
+        case Packed: {
+          // The coordinates of a segment are bit-packed differences from the
+          // first coordinate of the segment
+          const int* pos = (const int*)modeIndex.getIndexArray(0).getData();
+          const int* seg = (const int*)modeIndex.getIndexArray(1).getData();
+          const uint32_t* bits =
+              (const uint32_t*)modeIndex.getIndexArray(2).getData();
+          const size_t k = (lvl == 0) ? 0 : ptrs[lvl - 1].getAsIndex();
+
+          if (advance) {
+            goto resume_packed;
+          }
+
+          for (ptrs[lvl] = pos[k]; ptrs[lvl] < pos[k+1]; ++ptrs[lvl]) {
+            {
+              const uint64_t bit = (ptrs[lvl].getAsIndex() - pos[k]) *
+                                   (uint64_t)seg[3*k+1];
+              const uint32_t* word = bits + seg[3*k+2] + bit / 32;
+              const uint64_t w = word[0] | ((uint64_t)word[1] << 32);
+              coord[lvl] = seg[3*k] + (int)((w >> (bit % 32)) &
+                                            ((1ull << seg[3*k+1]) - 1));
+            }
+
+          resume_packed:
+            if (advanceIndex(lvl + 1)) {
+              return true;
+            }
+          }
+          break;
+        }
+        case Diagonal: {
+          // Diagonals are stored one after another with a value for every
+          // row, so the positions of a row are strided by the row count
+          const int* offsets = (const int*)modeIndex.getIndexArray(1).getData();
+          const size_t numDiagonals = modeIndex.getIndexArray(0)[0].getAsIndex();
+          const size_t numRows = storage.getIndex().getModeIndex(lvl - 1)
+                                        .getIndexArray(0)[0].getAsIndex();
+          const long long numCols = tensor->getDimension(modeOrdering[lvl]);
+          const long long row = coord[lvl - 1].getAsIndex();
+
+          if (advance) {
+            goto resume_diagonal;
+          }
+
+          for (ptrs[lvl] = ptrs[lvl - 1];
+               ptrs[lvl] < (int)(numDiagonals * numRows);
+               ptrs[lvl] = ptrs[lvl] + (int)numRows) {
+            if (row + offsets[ptrs[lvl].getAsIndex() / numRows] >= 0 &&
+                row + offsets[ptrs[lvl].getAsIndex() / numRows] < numCols) {
+              coord[lvl] = (int)(row + offsets[ptrs[lvl].getAsIndex()/numRows]);
+
+            resume_diagonal:
+              if (advanceIndex(lvl + 1)) {
+                return true;
+              }
+            }
+          }
+          break;
+        }
         default:
           taco_not_supported_yet;
           break;
@@ -496,11 +728,19 @@ enum class FileType {
   ttx,
 
   /// .rb  - The rutherford-boeing sparse matrix format.
-  rb
+  rb,
+
+  /// .taco - The native binary format of taco. It consists of a header with
+  ///         the component type, dimensions and format of a packed tensor,
+  ///         followed by its index and value arrays, which are memory mapped
+  ///         when the tensor is read from a file.
+  taco
 };
 
 /// Read a tensor from a file. The file format is inferred from the filename
-/// and the tensor is returned packed by default.
+/// and the tensor is returned packed by default. Files with a .gz or .zst
+/// extension after that of their format are decompressed as they are read, by
+/// running the gzip, pigz or zstd program (see util::FileStream).
 TensorBase read(std::string filename, Format format, bool pack = true);
 
 /// Read a tensor from a file of the given file format and the tensor is
@@ -513,7 +753,9 @@ TensorBase read(std::string filename, FileType filetype, Format format,
 TensorBase read(std::istream& stream, FileType filetype, Format format,
                 bool pack = true);
 
-/// Write a tensor to a file. The file format is inferred from the filename.
+/// Write a tensor to a file. The file format is inferred from the filename,
+/// and the file is compressed if it has a .gz or .zst extension after that of
+/// its format, by running the gzip, pigz or zstd program.
 void write(std::string filename, const TensorBase& tensor);
 
 /// Write a tensor to a file in the given file format.
@@ -622,6 +864,31 @@ void getCSCArrays(const TensorBase& tensor,
 /// Pack the operands in the given expression.
 void packOperands(const TensorBase& tensor);
 
+/// Compile the expressions of several tensors into one assemble and one
+/// compute kernel. The expressions are computed in order, so a tensor can be an
+/// operand of the expressions of the tensors after it. Loops that iterate over
+/// the same space are fused, so e.g. `y(i) = A(i,j)*x(j)` and
+/// `z(j) = A(i,j)*w(i)` are computed in one pass over `A`.
+void compile(const std::vector<TensorBase>& tensors,
+             bool assembleWhileCompute=false);
+
+/// Compile the tensors to compute the given assignments instead of their own,
+/// such as their assignments with temporaries inlined. Tensors that are
+/// conversions are converted before the kernels run, or after them if they
+/// copy a tensor the kernels compute, which the kernels must then not read.
+void compile(const std::vector<TensorBase>& tensors,
+             const std::vector<Assignment>& assignments,
+             bool assembleWhileCompute=false);
+
+/// Assemble the storage of tensors that are compiled together.
+void assemble(const std::vector<TensorBase>& tensors);
+
+/// Compute the values of tensors that are compiled together.
+void compute(const std::vector<TensorBase>& tensors);
+
+/// Compile, assemble and compute several tensors together as needed.
+void evaluate(const std::vector<TensorBase>& tensors);
+
 /// Iterate over the typed values of a TensorBase.
 template <typename CType>
 Tensor<CType> iterate(const TensorBase& tensor) {
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <fstream>
+#include <iostream>
+#include <memory>
 
 namespace taco {
 namespace util {
@@ -11,5 +13,38 @@ std::string sanitizePath(std::string path);
 
 void openStream(std::fstream& stream, std::string path, std::fstream::openmode mode);
 
+/// The compression of a file, which is given by its last extension.
+enum class Compression {None, Gzip, Zstd};
+
+/// Returns the compression of the file at `path`: gzip for .gz files and zstd
+/// for .zst and .zstd files.
+Compression getCompression(std::string path);
+
+/// Returns `path` without the extension of its compression, if any.
+std::string stripCompression(std::string path);
+
+/// A stream that reads or writes a file, and decompresses or compresses files
+/// whose extension gives a compression. Compressed files are piped through a
+/// gzip or zstd process started with popen, which runs concurrently with the
+/// reader or writer, so the gzip (or pigz) and zstd programs must be on the
+/// PATH at runtime. Gzip uses pigz when it is installed, which is looked for
+/// with system, and zstd compresses on all cores. Decompression is a single
+/// sequential stream either way.
+class FileStream : public std::iostream {
+public:
+  /// Open the file at `path` for reading or writing, as given by `mode`.
+  FileStream(std::string path, std::ios_base::openmode mode);
+  ~FileStream();
+
+  /// Close the file and wait for its compressor or decompressor, raising an
+  /// error if it failed.
+  void close();
+
+private:
+  std::string path;
+  std::unique_ptr<std::streambuf> buffer;
+  bool compressed;
+};
+
 }}
 #endif
@@ -0,0 +1,37 @@
+#ifndef TACO_UTIL_PARALLEL_H
+#define TACO_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace taco {
+namespace util {
+
+/// Returns the number of threads to split `n` iterations over, such that each
+/// thread gets at least `chunkSize` of them.
+inline size_t getNumThreads(size_t n, size_t chunkSize) {
+  size_t numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+  return std::max(std::min(numThreads, n / chunkSize), (size_t)1);
+}
+
+/// Run `body(t, begin, end)` for each of `numThreads` contiguous chunks of
+/// [0,n), on one thread per chunk.
+inline void parallelChunks(size_t n, size_t numThreads,
+                    const std::function<void(size_t,size_t,size_t)>& body) {
+  if (numThreads == 1) {
+    body(0, 0, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < numThreads; t++) {
+    workers.emplace_back(body, t, t * n / numThreads, (t+1) * n / numThreads);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+}}
+#endif
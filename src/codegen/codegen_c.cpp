@@ -22,6 +22,16 @@ namespace {
 // stdlib.h for malloc/realloc
 // math.h for sqrt
 // MIN preprocessor macro
+// The allocator of result arrays, which the library sets before calling the
+// kernels and which is weak so that several kernel sources can be linked
+// Hash table insertion and lookup for hashed modes, whose hash function *must*
+// be kept in sync with the one in storage/pack.cpp
+// Selection of the coordinate of a position in a bitmap mode
+// Ranges of the diagonals of a diagonal mode that intersect a row
+// Decoding of the bit-packed coordinates of a packed mode, one position at a
+// time or a block of positions into a local buffer, which *must* be kept in
+// sync with the encoding in storage/pack.cpp and the block size of
+// storage/packed_iterator.cpp
 // This *must* be kept in sync with taco_tensor_t.h
 const string cHeaders =
   "#ifndef TACO_C_HEADERS\n"
@@ -34,7 +44,9 @@ const string cHeaders =
   "#define TACO_MIN(_a,_b) ((_a) < (_b) ? (_a) : (_b))\n"
   "#ifndef TACO_TENSOR_T_DEFINED\n"
   "#define TACO_TENSOR_T_DEFINED\n"
-  "typedef enum { taco_mode_dense, taco_mode_sparse } taco_mode_t;\n"
+  "typedef enum { taco_mode_dense, taco_mode_sparse, taco_mode_singleton,\n"
+  "               taco_mode_hashed, taco_mode_bitmap, taco_mode_fixed,\n"
+  "               taco_mode_diagonal, taco_mode_packed } taco_mode_t;\n"
   "typedef struct {\n"
   "  int32_t      order;         // tensor order (number of modes)\n"
   "  int32_t*     dimensions;    // tensor dimensions\n"
@@ -44,7 +56,152 @@ const string cHeaders =
   "  uint8_t***   indices;       // tensor index data (per mode)\n"
   "  uint8_t*     vals;          // tensor values\n"
   "} taco_tensor_t;\n"
+  "typedef struct {\n"
+  "  void* (*allocate)(void* context, size_t size);\n"
+  "  void* (*reallocate)(void* context, void* data, size_t size);\n"
+  "  void  (*deallocate)(void* context, void* data);\n"
+  "  void* context;\n"
+  "} taco_allocator_t;\n"
   "#endif\n"
+  "static inline void* taco_malloc(void* context, size_t size) {\n"
+  "  return malloc(size);\n"
+  "}\n"
+  "static inline void* taco_realloc(void* context, void* data, size_t size) {\n"
+  "  return realloc(data, size);\n"
+  "}\n"
+  "static inline void taco_free(void* context, void* data) {\n"
+  "  free(data);\n"
+  "}\n"
+  "taco_allocator_t taco_allocator __attribute__((weak)) =\n"
+  "    {taco_malloc, taco_realloc, taco_free, NULL};\n"
+  "#define TACO_ALLOCATE(_size) \\\n"
+  "    taco_allocator.allocate(taco_allocator.context, (_size))\n"
+  "#define TACO_REALLOCATE(_data,_size) \\\n"
+  "    taco_allocator.reallocate(taco_allocator.context, (_data), (_size))\n"
+  "#define TACO_DEALLOCATE(_data) \\\n"
+  "    taco_allocator.deallocate(taco_allocator.context, (_data))\n"
+  "#define TACO_HASH(_p,_c) (((uint32_t)(_p)*2654435761u+(uint32_t)(_c))*2246822519u)\n"
+  "static inline int32_t taco_hash_capacity(taco_tensor_t* t, int32_t mode) {\n"
+  "  int32_t* size = (int32_t*)t->indices[mode][0];\n"
+  "  return (size == NULL) ? 0 : size[0];\n"
+  "}\n"
+  "static inline int32_t taco_hash_find(taco_tensor_t* t, int32_t mode,\n"
+  "                                     int32_t parent, int32_t coord) {\n"
+  "  int32_t capacity = taco_hash_capacity(t, mode);\n"
+  "  int32_t* crd = (int32_t*)t->indices[mode][1];\n"
+  "  int32_t* par = (int32_t*)t->indices[mode][2];\n"
+  "  if (capacity == 0) return -1;\n"
+  "  uint32_t slot = TACO_HASH(parent, coord) & (capacity - 1);\n"
+  "  while (crd[slot] >= 0 && (crd[slot] != coord || par[slot] != parent)) {\n"
+  "    slot = (slot + 1) & (capacity - 1);\n"
+  "  }\n"
+  "  return (crd[slot] >= 0) ? (int32_t)slot : -1;\n"
+  "}\n"
+  "static inline int32_t taco_hash_insert(taco_tensor_t* t, int32_t mode,\n"
+  "                                       int32_t parent, int32_t coord) {\n"
+  "  int32_t* size = (int32_t*)t->indices[mode][0];\n"
+  "  if (size == NULL) {\n"
+  "    size = (int32_t*)TACO_ALLOCATE(2 * sizeof(int32_t));\n"
+  "    size[0] = 0;\n"
+  "    size[1] = 0;\n"
+  "    t->indices[mode][0] = (uint8_t*)size;\n"
+  "    t->indices[mode][1] = NULL;\n"
+  "    t->indices[mode][2] = NULL;\n"
+  "  }\n"
+  "  if (2 * (size[1] + 1) > size[0]) {\n"
+  "    int32_t capacity = (size[0] == 0) ? 16 : 2 * size[0];\n"
+  "    int32_t* oldCrd = (int32_t*)t->indices[mode][1];\n"
+  "    int32_t* oldPar = (int32_t*)t->indices[mode][2];\n"
+  "    int32_t* crd = (int32_t*)TACO_ALLOCATE(capacity * sizeof(int32_t));\n"
+  "    int32_t* par = (int32_t*)TACO_ALLOCATE(capacity * sizeof(int32_t));\n"
+  "    for (int32_t i = 0; i < capacity; i++) crd[i] = -1;\n"
+  "    for (int32_t i = 0; i < size[0]; i++) {\n"
+  "      if (oldCrd[i] < 0) continue;\n"
+  "      uint32_t slot = TACO_HASH(oldPar[i], oldCrd[i]) & (capacity - 1);\n"
+  "      while (crd[slot] >= 0) slot = (slot + 1) & (capacity - 1);\n"
+  "      crd[slot] = oldCrd[i];\n"
+  "      par[slot] = oldPar[i];\n"
+  "    }\n"
+  "    TACO_DEALLOCATE(oldCrd);\n"
+  "    TACO_DEALLOCATE(oldPar);\n"
+  "    t->indices[mode][1] = (uint8_t*)crd;\n"
+  "    t->indices[mode][2] = (uint8_t*)par;\n"
+  "    size[0] = capacity;\n"
+  "  }\n"
+  "  int32_t* crd = (int32_t*)t->indices[mode][1];\n"
+  "  int32_t* par = (int32_t*)t->indices[mode][2];\n"
+  "  uint32_t slot = TACO_HASH(parent, coord) & (size[0] - 1);\n"
+  "  while (crd[slot] >= 0 && (crd[slot] != coord || par[slot] != parent)) {\n"
+  "    slot = (slot + 1) & (size[0] - 1);\n"
+  "  }\n"
+  "  if (crd[slot] < 0) {\n"
+  "    crd[slot] = coord;\n"
+  "    par[slot] = parent;\n"
+  "    size[1]++;\n"
+  "  }\n"
+  "  return (int32_t)slot;\n"
+  "}\n"
+  "static inline int32_t taco_bitmap_locate(const int32_t* bits,\n"
+  "                                         const int32_t* rank,\n"
+  "                                         int32_t word, int32_t coord) {\n"
+  "  uint32_t w = (uint32_t)bits[word + (coord >> 5)];\n"
+  "  uint32_t bit = (uint32_t)1 << (coord & 31);\n"
+  "  if ((w & bit) == 0) return -1;\n"
+  "  return rank[word + (coord >> 5)] + __builtin_popcount(w & (bit - 1));\n"
+  "}\n"
+  "static inline int32_t taco_diagonal_begin(const int32_t* offsets,\n"
+  "                                          int32_t numDiagonals,\n"
+  "                                          int32_t row) {\n"
+  "  int32_t lo = 0;\n"
+  "  int32_t hi = numDiagonals;\n"
+  "  while (lo < hi) {\n"
+  "    int32_t mid = lo + (hi - lo) / 2;\n"
+  "    if (row + offsets[mid] < 0) lo = mid + 1; else hi = mid;\n"
+  "  }\n"
+  "  return lo;\n"
+  "}\n"
+  "static inline int32_t taco_diagonal_end(const int32_t* offsets,\n"
+  "                                        int32_t numDiagonals,\n"
+  "                                        int32_t row, int32_t numColumns) {\n"
+  "  int32_t lo = 0;\n"
+  "  int32_t hi = numDiagonals;\n"
+  "  while (lo < hi) {\n"
+  "    int32_t mid = lo + (hi - lo) / 2;\n"
+  "    if (row + offsets[mid] < numColumns) lo = mid + 1; else hi = mid;\n"
+  "  }\n"
+  "  return lo;\n"
+  "}\n"
+  "static inline int32_t taco_packed_coordinate(const int32_t* seg,\n"
+  "                                             const int32_t* bits,\n"
+  "                                             const int32_t* pos,\n"
+  "                                             int32_t parent, int32_t p) {\n"
+  "  const int32_t* s = seg + 3 * parent;\n"
+  "  int64_t bit = (int64_t)(p - pos[parent]) * s[1];\n"
+  "  const uint32_t* word = (const uint32_t*)bits + s[2] + (bit >> 5);\n"
+  "  uint64_t w = (uint64_t)word[0] | ((uint64_t)word[1] << 32);\n"
+  "  return s[0] + (int32_t)((w >> (bit & 31)) & ((1ull << s[1]) - 1));\n"
+  "}\n"
+  "#define TACO_PACKED_BLOCK 16\n"
+  "#define taco_packed_buffer() ((int32_t[TACO_PACKED_BLOCK]){0})\n"
+  "static inline int32_t taco_packed_decode(const int32_t* seg,\n"
+  "                                         const int32_t* bits,\n"
+  "                                         const int32_t* pos,\n"
+  "                                         int32_t parent, int32_t p,\n"
+  "                                         int32_t end, int32_t* crd) {\n"
+  "  const int32_t* s = seg + 3 * parent;\n"
+  "  int32_t n = TACO_MIN(TACO_PACKED_BLOCK, end - p);\n"
+  "  int32_t base = s[0];\n"
+  "  int32_t width = s[1];\n"
+  "  uint64_t mask = (1ull << width) - 1;\n"
+  "  int64_t bit = (int64_t)(p - pos[parent]) * width;\n"
+  "  const uint32_t* words = (const uint32_t*)bits + s[2];\n"
+  "  for (int32_t i = 0; i < n; i++, bit += width) {\n"
+  "    const uint32_t* word = words + (bit >> 5);\n"
+  "    uint64_t w = (uint64_t)word[0] | ((uint64_t)word[1] << 32);\n"
+  "    crd[i] = base + (int32_t)((w >> (bit & 31)) & mask);\n"
+  "  }\n"
+  "  return n;\n"
+  "}\n"
   "#endif\n";
 
 // find variables for generating declarations
@@ -158,8 +315,18 @@ string toCType(DataType type, bool is_ptr) {
   return ret.str();
 }
 
+// helper to read an array of a tensor, telling the C compiler the array is
+// aligned if arrays are aligned
+string unpackArray(string array, size_t arrayAlignment) {
+  if (arrayAlignment == 0) {
+    return array;
+  }
+  return "__builtin_assume_aligned(" + array + ", " +
+         to_string(arrayAlignment) + ")";
+}
+
 string unpackTensorProperty(string varname, const GetProperty* op,
-                            bool is_output_prop) {
+                            bool is_output_prop, size_t arrayAlignment) {
   stringstream ret;
   ret << "  ";
   
@@ -168,7 +335,7 @@ string unpackTensorProperty(string varname, const GetProperty* op,
     // for the values, it's in the last slot
     ret << toCType(tensor->type, true);
     ret << " restrict " << varname << " = (" << toCType(tensor->type, true) << ")(";
-    ret << tensor->name << "->vals);\n";
+    ret << unpackArray(tensor->name + "->vals", arrayAlignment) << ");\n";
     return ret.str();
   }
   
@@ -179,20 +346,24 @@ string unpackTensorProperty(string varname, const GetProperty* op,
   
   // for a Dense level, nnz is an int
   // for a Fixed level, ptr is an int
-  // all others are int*
+  // for a Diagonal level, the number of diagonals is an int
+  // all others are pointers to the index type of the array
   if ((tensor->format.getModeTypes()[op->mode] == ModeType::Dense &&
        op->property == TensorProperty::Dimension) ||
       (tensor->format.getModeTypes()[op->mode] == ModeType::Fixed &&
+       op->property == TensorProperty::Dimension) ||
+      (tensor->format.getModeTypes()[op->mode] == ModeType::Diagonal &&
        op->property == TensorProperty::Dimension)) {
     tp = "int";
     ret << tp << " " << varname << " = *(int*)("
         << tensor->name << "->indices[" << op->mode << "][0]);\n";
   } else {
-    tp = "int*";
+    tp = toCType(op->type, true);
     auto nm = op->index;
     ret << tp << " restrict " << varname << " = ";
-    ret << "(int*)(" << tensor->name << "->indices[" << op->mode;
-    ret << "][" << nm << "]);\n";
+    ret << "(" << tp << ")(" << unpackArray(tensor->name + "->indices[" +
+        to_string(op->mode) + "][" + to_string(nm) + "]", arrayAlignment);
+    ret << ");\n";
   }
   
   return ret.str();
@@ -237,7 +408,8 @@ string packTensorProperty(string varname, Expr tnsr, TensorProperty property,
   
 // helper to print declarations
 string printDecls(map<Expr, string, ExprCompare> varMap,
-                   vector<Expr> inputs, vector<Expr> outputs) {
+                   vector<Expr> inputs, vector<Expr> outputs,
+                   size_t arrayAlignment) {
   stringstream ret;
   unordered_set<string> propsAlreadyGenerated;
   
@@ -283,7 +455,8 @@ string printDecls(map<Expr, string, ExprCompare> varMap,
   for (auto prop: sortedProps) {
     bool isOutputProp = (find(outputs.begin(), outputs.end(),
                           prop->tensor) != outputs.end());
-    ret << unpackTensorProperty(varMap[prop], prop, isOutputProp);
+    ret << unpackTensorProperty(varMap[prop], prop, isOutputProp,
+                                arrayAlignment);
     propsAlreadyGenerated.insert(varMap[prop]);
   }
 
@@ -460,6 +633,10 @@ CodeGen_C::CodeGen_C(std::ostream &dest, OutputKind outputKind)
 
 CodeGen_C::~CodeGen_C() {}
 
+void CodeGen_C::setArrayAlignment(size_t alignment) {
+  arrayAlignment = alignment;
+}
+
 void CodeGen_C::compile(Stmt stmt, bool isFirst) {
   if (isFirst) {
     // output the headers
@@ -500,7 +677,7 @@ void CodeGen_C::visit(const Function* func) {
 
   // Print variable declarations
   out << printDecls(varFinder.varDecls,
-                    func->inputs, func->outputs);
+                    func->inputs, func->outputs, arrayAlignment);
 
   // output body
   out << endl;
@@ -543,6 +720,16 @@ static string genVectorizePragma(int width) {
   return ret.str();
 }
 
+static string genUnrollPragma(const For* op) {
+  taco_iassert(isa<Literal>(op->start) && isa<Literal>(op->end)) <<
+      "Only loops with literal bounds can be fully unrolled";
+  long long tripCount = to<Literal>(op->end)->int_value -
+                        to<Literal>(op->start)->int_value;
+  stringstream ret;
+  ret << "#pragma GCC unroll " << std::max(tripCount, 1ll);
+  return ret.str();
+}
+
 static string getParallelizePragma(LoopKind kind) {
   stringstream ret;
   ret << "#pragma omp parallel for";
@@ -553,7 +740,7 @@ static string getParallelizePragma(LoopKind kind) {
 }
 
 // The next two need to output the correct pragmas depending
-// on the loop kind (Serial, Static, Dynamic, Vectorized)
+// on the loop kind (Serial, Static, Dynamic, Vectorized, Unrolled)
 //
 // Docs for vectorization pragmas:
 // http://clang.llvm.org/docs/LanguageExtensions.html#extensions-for-loop-hint-optimizations
@@ -569,6 +756,12 @@ void CodeGen_C::visit(const For* op) {
       doIndent();
       out << getParallelizePragma(op->kind);
       out << "\n";
+      break;
+    case LoopKind::Unrolled:
+      doIndent();
+      out << genUnrollPragma(op);
+      out << "\n";
+      break;
     default:
       break;
   }
@@ -621,12 +814,12 @@ void CodeGen_C::visit(const Allocate* op) {
   stream << elementType << "*";
   stream << ")";
   if (op->is_realloc) {
-    stream << "realloc(";
+    stream << "TACO_REALLOCATE(";
     op->var.accept(this);
     stream << ", ";
   }
   else {
-    stream << "malloc(";
+    stream << "TACO_ALLOCATE(";
   }
   stream << "sizeof(" << elementType << ")";
   stream << " * ";
@@ -24,6 +24,10 @@ public:
   /// Compile a lowered function
   void compile(Stmt stmt, bool isFirst=false);
 
+  /// Assume the arrays of the tensors are aligned to `alignment` bytes, or
+  /// nothing about their alignment if it is 0
+  void setArrayAlignment(size_t alignment);
+
   // TODO: Remove & use name generator from IRPrinter
   static std::string genUniqueName(std::string varName="");
   
@@ -46,6 +50,8 @@ protected:
   std::ostream &out;
   
   OutputKind outputKind;
+
+  size_t arrayAlignment = 0;
 };
 
 } // namespace ir
@@ -8,6 +8,7 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/env.h"
+#include "taco/storage/allocator.h"
 
 using namespace std;
 
@@ -44,6 +45,7 @@ void Module::compileToSource(string path, string prefix) {
         "Only C99 codegen supported currently";
     CodeGen_C codegen(source, CodeGen_C::OutputKind::C99Implementation);
     CodeGen_C headergen(header, CodeGen_C::OutputKind::C99Header);
+    codegen.setArrayAlignment(arrayAlignment);
     
     
     for (auto func: funcs) {
@@ -84,6 +86,15 @@ void writeShims(vector<Stmt> funcs, string path, string prefix) {
   shims_file.close();
 }
 
+/// Libraries compiled by this process, keyed on the compile command and the
+/// source they were compiled from. Kernels that bake in different dimensions
+/// have different sources, while kernels that read all dimensions at runtime
+/// are shared by tensors of any size.
+map<string,pair<string,void*>>& getCompiledLibraries() {
+  static map<string,pair<string,void*>> compiledLibraries;
+  return compiledLibraries;
+}
+
 } // anonymous namespace
 
 string Module::compile() {
@@ -102,6 +113,14 @@ string Module::compile() {
   // open the output file & write out the source
   compileToSource(tmpdir, libname);
   
+  // reuse the library if the same source has already been compiled
+  string key = cc + " " + cflags + "\n" + source.str();
+  auto& compiledLibraries = getCompiledLibraries();
+  if (compiledLibraries.count(key) > 0) {
+    lib_handle = compiledLibraries.at(key).second;
+    return compiledLibraries.at(key).first;
+  }
+
   // write out the shims
   writeShims(funcs, tmpdir, libname);
   
@@ -112,6 +131,7 @@ string Module::compile() {
 
   // use dlsym() to open the compiled library
   lib_handle = dlopen(fullpath.data(), RTLD_NOW | RTLD_LOCAL);
+  compiledLibraries.insert({key, {fullpath, lib_handle}});
 
   return fullpath;
 }
@@ -121,6 +141,10 @@ void Module::setSource(string source) {
   moduleFromUserSource = true;
 }
 
+void Module::setArrayAlignment(size_t alignment) {
+  arrayAlignment = alignment;
+}
+
 string Module::getSource() {
   return source.str();
 }
@@ -130,6 +154,14 @@ void* Module::getFunc(std::string name) {
 }
 
 int Module::callFuncPackedRaw(std::string name, void** args) {
+  // Kernels allocate result arrays with the current allocator. Modules
+  // compiled from user source may not have an allocator.
+  storage::Allocator* allocator =
+      static_cast<storage::Allocator*>(getFunc("taco_allocator"));
+  if (allocator != nullptr) {
+    *allocator = storage::getAllocator();
+  }
+
   typedef int (*fnptr_t)(void**);
   static_assert(sizeof(void*) == sizeof(fnptr_t),
     "Unable to cast dlsym() returned void pointer to function pointer");
@@ -69,6 +69,11 @@ public:
   
   /// Set the source of the module
   void setSource(std::string source);
+
+  /// Generate code that assumes the arrays of the tensors passed to the
+  /// functions are aligned to `alignment` bytes, or nothing about their
+  /// alignment if it is 0
+  void setArrayAlignment(size_t alignment);
   
 private:
   std::stringstream source;
@@ -81,6 +86,8 @@ private:
   // true iff the module was created from user-provided source
   bool moduleFromUserSource;
 
+  size_t arrayAlignment = 0;
+
   Target target;
   
   void setJITLibname();
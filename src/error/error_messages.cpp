@@ -28,12 +28,81 @@ const std::string expr_einsum_missformed =
 const std::string compile_without_expr =
   "The tensor must be assigned to before compile is called.";
 
+const std::string compile_merge_duplicates =
+  "Co-iterating a mode that stores duplicate coordinates, such as the first "
+  "mode of COO, with the modes of other operands is not supported.";
+
+const std::string compile_duplicates_sparse_result =
+  "Computing a sparse result from a mode that stores duplicate coordinates, "
+  "such as the first mode of COO, is not supported.";
+
+const std::string compile_hashed_operand =
+  "Tensors with hashed modes cannot be computed with. Convert their hashed "
+  "modes to sparse modes with sortHashedModes first.";
+
+const std::string compile_hashed_result =
+  "Only the last mode of a result can be hashed, and all its other modes must "
+  "be dense.";
+
+const std::string format_hashed_mode =
+  "Only the last mode of a tensor can be hashed, and all its other modes must "
+  "be dense.";
+
+const std::string format_diagonal_mode =
+  "Diagonal modes are only supported as the second mode of the DIA matrix "
+  "format.";
+
+const std::string format_index_type =
+  "Only the index arrays of sparse and singleton modes can have types other "
+  "than int32, and those types must be integers of at most 64 bits.";
+
+const std::string format_index_width =
+  "The coordinate type of a mode is too narrow to store every coordinate of "
+  "the mode.";
+
+const std::string format_packed_mode =
+  "Packed modes can only be combined with dense, sparse, singleton and packed "
+  "modes.";
+
+const std::string compile_hashed_assemble_while_compute =
+  "Results with hashed modes must be assembled before they are computed.";
+
+const std::string compile_bitmap_result =
+  "Bitmap modes can only be read, so results cannot have bitmap modes.";
+
+const std::string compile_fixed_result =
+  "Fixed modes can only be read, so results cannot have fixed modes.";
+
+const std::string compile_diagonal_result =
+  "Diagonal modes can only be read, so results cannot have diagonal modes.";
+
+const std::string compile_packed_result =
+  "Packed modes can only be read, so results cannot have packed modes.";
+
+const std::string convert_mode_ordering =
+  "A conversion must map every mode of the tensor to a distinct mode of the "
+  "source tensor with the same dimension.";
+
+const std::string convert_component_type =
+  "A conversion cannot change the component type of a tensor.";
+
+const std::string convert_unpacked_source =
+  "The source of a conversion must be packed or computed first.";
+
 const std::string assemble_without_compile =
   "The compile method must be called before assemble.";
 
 const std::string compute_without_compile =
    "The compile method must be called before compute.";
 
+const std::string compute_without_others =
+  "Tensors that are compiled together must be assembled and computed "
+  "together.";
+
+const std::string compute_pending_operand =
+  "The operands of a tensor must be computed before it is assembled or "
+  "computed, which evaluate and evaluateLazily do.";
+
 const std::string requires_matrix =
     "The argument must be a matrix.";
 
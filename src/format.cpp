@@ -56,7 +56,7 @@ DataType Format::getCoordinateTypePos(int level) const {
 }
 
 DataType Format::getCoordinateTypeIdx(int level) const {
-  if (modeTypes[level] == Sparse) {
+  if (modeTypes[level] == Sparse || modeTypes[level] == Hashed) {
     return levelArrayTypes[level][1];
   }
   return levelArrayTypes[level][0];
@@ -104,6 +104,21 @@ std::ostream& operator<<(std::ostream& os, const ModeType& modeType) {
     case ModeType::Fixed:
       os << "fixed";
       break;
+    case ModeType::Singleton:
+      os << "singleton";
+      break;
+    case ModeType::Hashed:
+      os << "hashed";
+      break;
+    case ModeType::Bitmap:
+      os << "bitmap";
+      break;
+    case ModeType::Diagonal:
+      os << "diagonal";
+      break;
+    case ModeType::Packed:
+      os << "packed";
+      break;
   }
   return os;
 }
@@ -113,6 +128,9 @@ const Format CSR({Dense, Sparse}, {0,1});
 const Format CSC({Dense, Sparse}, {1,0});
 const Format DCSR({Sparse, Sparse}, {0,1});
 const Format DCSC({Sparse, Sparse}, {1,0});
+const Format COO({Sparse, Singleton}, {0,1});
+const Format BCSR({Dense, Sparse, Dense, Dense}, {0,1,2,3});
+const Format DIA({Dense, Diagonal}, {0,1});
 
 bool isDense(const Format& format) {
   for (ModeType modeType : format.getModeTypes()) {
@@ -123,4 +141,20 @@ bool isDense(const Format& format) {
   return true;
 }
 
+bool hasDuplicates(const Format& format, size_t i) {
+  const auto& modeTypes = format.getModeTypes();
+  taco_iassert(i < modeTypes.size());
+  return modeTypes[i] == Sparse && i + 1 < modeTypes.size() &&
+         modeTypes[i + 1] == Singleton;
+}
+
+bool isHashed(const Format& format) {
+  for (ModeType modeType : format.getModeTypes()) {
+    if (modeType == Hashed) {
+      return true;
+    }
+  }
+  return false;
+}
+
 }
@@ -1095,6 +1095,10 @@ void TensorVar::setName(std::string name) {
   content->name = name;
 }
 
+void TensorVar::setFormat(const Format& format) {
+  content->format = format;
+}
+
 void TensorVar::setAssignment(Assignment assignment) {
   auto freeVars = assignment.getLhs().getIndexVars();
   auto indexExpr = assignment.getRhs();
@@ -1104,11 +1108,8 @@ void TensorVar::setAssignment(Assignment assignment) {
       << error::expr_dimension_mismatch << " "
       << error::dimensionTypecheckErrors(freeVars, indexExpr, shape);
 
-  // The following are index expressions the implementation doesn't currently
-  // support, but that are planned for the future.
-  taco_uassert(!error::containsTranspose(this->getFormat(), freeVars, indexExpr))
-      << error::expr_transposition;
-
+  // Transpositions are only rejected once the assignment is lowered, since
+  // tensors compute copies that transpose by converting their storage
   content->assignment = assignment;
 }
 
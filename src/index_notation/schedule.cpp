@@ -52,6 +52,8 @@ std::ostream& operator<<(std::ostream& os, const OperatorSplit& split) {
 // class Schedule
 struct Schedule::Content {
   map<IndexExpr, vector<OperatorSplit>> operatorSplits;
+  size_t maxSpecializedDimension = 0;
+  size_t prefetchDistance = 0;
 };
 
 Schedule::Schedule() : content(new Content) {
@@ -80,11 +82,37 @@ void Schedule::clearOperatorSplits() {
   content->operatorSplits.clear();
 }
 
+size_t Schedule::getMaxSpecializedDimension() const {
+  return content->maxSpecializedDimension;
+}
+
+void Schedule::setMaxSpecializedDimension(size_t dimension) {
+  content->maxSpecializedDimension = dimension;
+}
+
+size_t Schedule::getPrefetchDistance() const {
+  return content->prefetchDistance;
+}
+
+void Schedule::setPrefetchDistance(size_t distance) {
+  content->prefetchDistance = distance;
+}
+
 std::ostream& operator<<(std::ostream& os, const Schedule& schedule) {
   auto operatorSplits = schedule.getOperatorSplits();
   if (operatorSplits.size() > 0) {
     os << "Operator Splits:" << endl << util::join(operatorSplits, "\n");
   }
+  bool newline = operatorSplits.size() > 0;
+  if (schedule.getMaxSpecializedDimension() > 0) {
+    os << (newline ? "\n" : "") << "Specialized Dimensions: <= "
+       << schedule.getMaxSpecializedDimension();
+    newline = true;
+  }
+  if (schedule.getPrefetchDistance() > 0) {
+    os << (newline ? "\n" : "") << "Prefetch Distance: "
+       << schedule.getPrefetchDistance();
+  }
   return os;
 }
 
@@ -318,6 +318,16 @@ Expr Load::make(Expr arr, Expr loc) {
   return load;
 }
 
+// Call
+Expr Call::make(const std::string& func, const std::vector<Expr>& args,
+                DataType returnType) {
+  Call* call = new Call;
+  call->type = returnType;
+  call->func = func;
+  call->args = args;
+  return call;
+}
+
 // Block
 Stmt Block::make() {
   return Block::make({});
@@ -477,6 +487,28 @@ Stmt Print::make(std::string fmt, std::vector<Expr> params) {
   return pr;
 }
   
+// Prefetch
+Stmt Prefetch::make(Expr arr, Expr loc) {
+  taco_iassert(loc.type().isInt()) << "Can't prefetch a non-integer offset";
+  Prefetch* prefetch = new Prefetch;
+  prefetch->arr = arr;
+  prefetch->loc = loc;
+  return prefetch;
+}
+
+/// The element type of an index array. Sparse and singleton levels store
+/// their arrays with the types set by the format; all other arrays are ints.
+static DataType getIndexArrayType(const Format& format, int mode, int index) {
+  const auto& levelArrayTypes = format.getLevelArrayTypes();
+  ModeType modeType = format.getModeTypes()[mode];
+  if ((modeType == ModeType::Sparse || modeType == ModeType::Singleton) &&
+      (size_t)mode < levelArrayTypes.size() &&
+      (size_t)index < levelArrayTypes[mode].size()) {
+    return levelArrayTypes[mode][index];
+  }
+  return Int();
+}
+
 Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
                        int index, std::string name) {
   GetProperty* gp = new GetProperty;
@@ -489,6 +521,8 @@ Expr GetProperty::make(Expr tensor, TensorProperty property, int mode,
   //TODO: deal with the fact that some of these are pointers
   if (property == TensorProperty::Values)
     gp->type = tensor.type();
+  else if (property == TensorProperty::Indices)
+    gp->type = getIndexArrayType(tensor.as<Var>()->format, mode, index);
   else
     gp->type = Int();
   
@@ -590,6 +624,8 @@ template<> void StmtNode<Switch>::accept(IRVisitorStrict *v)
     const { v->visit((const Switch*)this); }
 template<> void ExprNode<Load>::accept(IRVisitorStrict *v)
     const { v->visit((const Load*)this); }
+template<> void ExprNode<Call>::accept(IRVisitorStrict *v)
+    const { v->visit((const Call*)this); }
 template<> void StmtNode<Store>::accept(IRVisitorStrict *v)
     const { v->visit((const Store*)this); }
 template<> void StmtNode<For>::accept(IRVisitorStrict *v)
@@ -612,6 +648,8 @@ template<> void StmtNode<BlankLine>::accept(IRVisitorStrict *v)
     const { v->visit((const BlankLine*)this); }
 template<> void StmtNode<Print>::accept(IRVisitorStrict *v)
     const { v->visit((const Print*)this); }
+template<> void StmtNode<Prefetch>::accept(IRVisitorStrict *v)
+    const { v->visit((const Prefetch*)this); }
 template<> void ExprNode<GetProperty>::accept(IRVisitorStrict *v)
     const { v->visit((const GetProperty*)this); }
 
@@ -294,6 +294,18 @@ void IRPrinter::visit(const Load* op) {
   stream << "]";
 }
 
+void IRPrinter::visit(const Call* op) {
+  stream << op->func << "(";
+  for (size_t i = 0; i < op->args.size(); ++i) {
+    if (i > 0) {
+      stream << ", ";
+    }
+    parentPrecedence = Precedence::TOP;
+    op->args[i].accept(this);
+  }
+  stream << ")";
+}
+
 void IRPrinter::visit(const Store* op) {
   doIndent();
   op->arr.accept(this);
@@ -385,7 +397,9 @@ void IRPrinter::visit(const Function* op) {
 void IRPrinter::visit(const VarAssign* op) {
   doIndent();
   if (op->is_decl) {
-    stream << keywordString(util::toString(op->lhs.type())) << " ";
+    const Var* var = op->lhs.as<Var>();
+    stream << keywordString(util::toString(op->lhs.type()))
+           << ((var != nullptr && var->is_ptr) ? "* " : " ");
     string varName = varNameGenerator.getUniqueName(util::toString(op->lhs));
     varNames.insert({op->lhs, varName});
   }
@@ -455,6 +469,17 @@ void IRPrinter::visit(const Print* op) {
   stream << ");";
 }
 
+void IRPrinter::visit(const Prefetch* op) {
+  doIndent();
+  stream << "__builtin_prefetch(&";
+  parentPrecedence = Precedence::LOAD;
+  op->arr.accept(this);
+  stream << "[";
+  parentPrecedence = Precedence::TOP;
+  op->loc.accept(this);
+  stream << "]);";
+}
+
 void IRPrinter::visit(const GetProperty* op) {
   stream << op->name;
 }
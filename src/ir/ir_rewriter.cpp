@@ -1,6 +1,7 @@
 #include "taco/ir/ir_rewriter.h"
 
 #include <vector>
+#include <map>
 
 #include "taco/ir/ir.h"
 
@@ -233,6 +234,24 @@ void IRRewriter::visit(const Load* op) {
   }
 }
 
+void IRRewriter::visit(const Call* op) {
+  vector<Expr> args;
+  bool argsSame = true;
+  for (auto& arg : op->args) {
+    Expr rewrittenArg = rewrite(arg);
+    args.push_back(rewrittenArg);
+    if (rewrittenArg != arg) {
+      argsSame = false;
+    }
+  }
+  if (argsSame) {
+    expr = op;
+  }
+  else {
+    expr = Call::make(op->func, args, op->type);
+  }
+}
+
 void IRRewriter::visit(const Store* op) {
   Expr arr  = rewrite(op->arr);
   Expr loc  = rewrite(op->loc);
@@ -256,6 +275,10 @@ void IRRewriter::visit(const For* op) {
     stmt = op;
   }
   else {
+    // For::make scopes the loop body, so unwrap the rewritten scope
+    if (isa<Scope>(contents)) {
+      contents = to<Scope>(contents)->scopedStmt;
+    }
     stmt = For::make(var, start, end, increment, contents, op->kind,
                      op->vec_width);
   }
@@ -268,6 +291,10 @@ void IRRewriter::visit(const While* op) {
     stmt = op;
   }
   else {
+    // While::make scopes the loop body, so unwrap the rewritten scope
+    if (isa<Scope>(contents)) {
+      contents = to<Scope>(contents)->scopedStmt;
+    }
     stmt = While::make(cond, contents, op->kind, op->vec_width);
   }
 }
@@ -379,6 +406,17 @@ void IRRewriter::visit(const Print* op) {
   }
 }
 
+void IRRewriter::visit(const Prefetch* op) {
+  Expr arr = rewrite(op->arr);
+  Expr loc = rewrite(op->loc);
+  if (arr == op->arr && loc == op->loc) {
+    stmt = op;
+  }
+  else {
+    stmt = Prefetch::make(arr, loc);
+  }
+}
+
 void IRRewriter::visit(const GetProperty* op) {
   Expr tensor = rewrite(op->tensor);
   if (tensor == op->tensor) {
@@ -390,4 +428,31 @@ void IRRewriter::visit(const GetProperty* op) {
 }
 
 
+
+// Substitutions
+struct ReplaceVars : public IRRewriter {
+  const map<Expr,Expr>& substitutions;
+
+  ReplaceVars(const map<Expr,Expr>& substitutions)
+      : substitutions(substitutions) {
+  }
+
+  using IRRewriter::visit;
+
+  void visit(const Var* op) {
+    auto it = substitutions.find(op);
+    expr = (it != substitutions.end()) ? it->second : op;
+  }
+};
+
+Expr replace(Expr expr, const map<Expr,Expr>& substitutions) {
+  return substitutions.empty() ? expr
+                               : ReplaceVars(substitutions).rewrite(expr);
+}
+
+Stmt replace(Stmt stmt, const map<Expr,Expr>& substitutions) {
+  return substitutions.empty() ? stmt
+                               : ReplaceVars(substitutions).rewrite(stmt);
+}
+
 }}
@@ -147,6 +147,12 @@ void IRVisitor::visit(const Load* op) {
   op->loc.accept(this);
 }
 
+void IRVisitor::visit(const Call* op) {
+  for (auto& arg : op->args) {
+    arg.accept(this);
+  }
+}
+
 void IRVisitor::visit(const Store* op) {
   op->arr.accept(this);
   op->loc.accept(this);
@@ -204,5 +210,10 @@ void IRVisitor::visit(const Print* op) {
     e.accept(this);
 }
 
+void IRVisitor::visit(const Prefetch* op) {
+  op->arr.accept(this);
+  op->loc.accept(this);
+}
+
 }  // namespace ir
 }  // namespace taco
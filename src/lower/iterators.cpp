@@ -37,7 +37,8 @@ Iterators::Iterators(const IterationGraph& graph,
       taco_iassert(path.getStep(i).getStep() == i);
       Iterator iterator = Iterator::make(path, name, tensorVarExpr, i,
                                          format.getModeTypes()[i],
-                                         format.getModeOrdering()[i], parent,
+                                         format.getModeOrdering()[i],
+                                         !hasDuplicates(format, i), parent,
                                          tensorVar.getType());
       iterators.insert({path.getStep(i), iterator});
       parent = iterator;
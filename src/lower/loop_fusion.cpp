@@ -0,0 +1,275 @@
+#include "loop_fusion.h"
+
+#include <set>
+#include <string>
+#include <sstream>
+
+#include "taco/ir/ir_printer.h"
+#include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
+#include "taco/util/collections.h"
+
+using namespace std;
+
+namespace taco {
+namespace lower {
+
+using namespace taco::ir;
+
+/// Prints expressions such that two expressions print the same iff they are
+/// structurally equal and refer to the same variables.
+class IdentityPrinter : public IRPrinter {
+public:
+  IdentityPrinter(ostream& stream) : IRPrinter(stream) {
+  }
+
+  using IRPrinter::print;
+  void print(Expr expr) {
+    parentPrecedence = TOP;
+    expr.accept(this);
+  }
+
+protected:
+  using IRPrinter::visit;
+
+  void visit(const Var* op) {
+    stream << op->name << "@" << (const void*)op;
+  }
+
+  void visit(const GetProperty* op) {
+    op->tensor.accept(this);
+    stream << "." << (int)op->property << "." << op->mode << "." << op->index;
+  }
+};
+
+static string getKey(Expr expr) {
+  stringstream stream;
+  IdentityPrinter printer(stream);
+  printer.print(expr);
+  return stream.str();
+}
+
+/// The variables that are assigned to after their declaration, and the arrays
+/// that are stored to.
+struct Mutations : public IRVisitor {
+  set<Expr>    vars;
+  set<string>  arrays;
+
+  using IRVisitor::visit;
+
+  void visit(const VarAssign* op) {
+    if (!op->is_decl) {
+      vars.insert(op->lhs);
+    }
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Store* op) {
+    arrays.insert(getKey(op->arr));
+    IRVisitor::visit(op);
+  }
+
+  void visit(const Allocate* op) {
+    arrays.insert(getKey(op->var));
+    IRVisitor::visit(op);
+  }
+};
+
+/// Returns true iff the expression evaluates to the same value everywhere it
+/// is in scope, as it does not refer to mutated variables or arrays.
+static bool isInvariant(Expr expr, const Mutations& mutations) {
+  struct IsInvariant : public IRVisitor {
+    const Mutations& mutations;
+    bool invariant = true;
+
+    IsInvariant(const Mutations& mutations) : mutations(mutations) {
+    }
+
+    using IRVisitor::visit;
+
+    void visit(const Var* op) {
+      invariant = invariant && !util::contains(mutations.vars, op);
+    }
+
+    void visit(const Load* op) {
+      invariant = invariant &&
+                  !util::contains(mutations.arrays, getKey(op->arr));
+      IRVisitor::visit(op);
+    }
+  };
+  IsInvariant isInvariant(mutations);
+  expr.accept(&isInvariant);
+  return isInvariant.invariant;
+}
+
+/// Returns the statements of a loop body or block, flattening nested blocks.
+static vector<Stmt> getStatements(Stmt stmt) {
+  if (isa<Scope>(stmt)) {
+    stmt = to<Scope>(stmt)->scopedStmt;
+  }
+  if (!isa<Block>(stmt)) {
+    return {stmt};
+  }
+  vector<Stmt> stmts;
+  for (auto& blockStmt : to<Block>(stmt)->contents) {
+    if (isa<Block>(blockStmt)) {
+      util::append(stmts, getStatements(blockStmt));
+    }
+    else {
+      stmts.push_back(blockStmt);
+    }
+  }
+  return stmts;
+}
+
+class LoopFuser {
+public:
+  LoopFuser(const DenseLoops& denseLoops, const Mutations& mutations,
+            bool independent)
+      : denseLoops(denseLoops), mutations(mutations),
+        independent(independent) {
+  }
+
+  /// Fuse the statements `stmts2` into the statements `stmts1`. Statements of
+  /// `stmts2` that precede a loop that is fused are moved to just before the
+  /// fused loop, and declarations that duplicate a declaration of `stmts1`
+  /// are removed.
+  vector<Stmt> fuse(const vector<Stmt>& stmts1, const vector<Stmt>& stmts2) {
+    vector<Stmt> fused = stmts1;
+    vector<Stmt> pending;
+
+    // Statements of `stmts2` may not be moved to before this position
+    size_t first = 0;
+
+    for (auto& stmt : stmts2) {
+      if (isa<For>(stmt)) {
+        const For* loop2 = to<For>(stmt);
+        bool isFused = false;
+        for (size_t i = first; i < fused.size() && !isFused; ++i) {
+          if (isa<For>(fused[i]) && canFuse(to<For>(fused[i]), loop2)) {
+            fused[i] = fuse(to<For>(fused[i]), loop2);
+            fused.insert(fused.begin() + i, pending.begin(), pending.end());
+            first = i + pending.size() + 1;
+            pending.clear();
+            isFused = true;
+          }
+        }
+        if (isFused) {
+          continue;
+        }
+      }
+      else if (isa<VarAssign>(stmt) && to<VarAssign>(stmt)->is_decl) {
+        const VarAssign* decl2 = to<VarAssign>(stmt);
+        Expr rhs = replace(decl2->rhs, substitutions);
+        bool isDuplicate = false;
+        if (isInvariant(decl2->lhs, mutations) &&
+            isInvariant(rhs, mutations)) {
+          string rhsKey = getKey(rhs);
+          for (size_t i = 0; i < fused.size() && !isDuplicate; ++i) {
+            const VarAssign* decl1 = fused[i].as<VarAssign>();
+            if (decl1 != nullptr && decl1->is_decl &&
+                decl1->lhs.type() == decl2->lhs.type() &&
+                isInvariant(decl1->lhs, mutations) &&
+                getKey(decl1->rhs) == rhsKey) {
+              substitutions.insert({decl2->lhs, decl1->lhs});
+              first = max(first, i + 1);
+              isDuplicate = true;
+            }
+          }
+        }
+        if (isDuplicate) {
+          continue;
+        }
+      }
+      pending.push_back(replace(stmt, substitutions));
+    }
+    util::append(fused, pending);
+    return fused;
+  }
+
+  /// Fuse the last outer loop of `loops1` with the first outer loop of
+  /// `loops2`, appending the body of the latter to the body of the former.
+  vector<Stmt> fuseOuter(const vector<Stmt>& loops1,
+                         const vector<Stmt>& loops2) {
+    vector<Stmt> fused = loops1;
+    size_t first = 0;
+    if (!loops1.empty() && !loops2.empty() &&
+        isa<For>(loops1.back()) && isa<For>(loops2.front()) &&
+        canFuse(to<For>(loops1.back()), to<For>(loops2.front()))) {
+      fused.back() = fuse(to<For>(loops1.back()), to<For>(loops2.front()));
+      first = 1;
+    }
+    for (size_t i = first; i < loops2.size(); ++i) {
+      fused.push_back(replace(loops2[i], substitutions));
+    }
+    return fused;
+  }
+
+private:
+  const DenseLoops& denseLoops;
+  const Mutations&  mutations;
+  bool              independent;
+
+  /// Maps variables of the fused statements to equivalent variables of the
+  /// statements they are fused into.
+  map<Expr,Expr>    substitutions;
+
+  bool canFuse(const For* loop1, const For* loop2) {
+    if (loop1->var.type() != loop2->var.type()) {
+      return false;
+    }
+
+    if (util::contains(denseLoops, loop1->var) &&
+        util::contains(denseLoops, loop2->var)) {
+      auto& domain1 = denseLoops.at(loop1->var);
+      auto& domain2 = denseLoops.at(loop2->var);
+      if (domain1.first == domain2.first && domain1.second.isFixed() &&
+          domain1.second == domain2.second) {
+        return true;
+      }
+    }
+
+    return getKey(loop1->start) ==
+               getKey(replace(loop2->start, substitutions)) &&
+           getKey(loop1->end) ==
+               getKey(replace(loop2->end, substitutions)) &&
+           getKey(loop1->increment) ==
+               getKey(replace(loop2->increment, substitutions));
+  }
+
+  Stmt fuse(const For* loop1, const For* loop2) {
+    substitutions.insert({loop2->var, loop1->var});
+
+    vector<Stmt> body1 = getStatements(loop1->contents);
+    vector<Stmt> body2 = getStatements(loop2->contents);
+    vector<Stmt> body;
+    if (independent) {
+      body = fuse(body1, body2);
+    }
+    else {
+      body = body1;
+      for (auto& stmt : body2) {
+        body.push_back(replace(stmt, substitutions));
+      }
+    }
+
+    LoopKind kind = (loop1->kind == loop2->kind) ? loop1->kind
+                                                 : LoopKind::Serial;
+    return For::make(loop1->var, loop1->start, loop1->end, loop1->increment,
+                     Block::make(body), kind, loop1->vec_width);
+  }
+};
+
+vector<Stmt> fuseLoops(const vector<Stmt>& loops1, const vector<Stmt>& loops2,
+                       const DenseLoops& denseLoops, bool independent) {
+  Mutations mutations;
+  for (auto& stmt : util::combine(loops1, loops2)) {
+    stmt.accept(&mutations);
+  }
+
+  LoopFuser fuser(denseLoops, mutations, independent);
+  return independent ? fuser.fuse(loops1, loops2)
+                     : fuser.fuseOuter(loops1, loops2);
+}
+
+}}
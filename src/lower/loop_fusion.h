@@ -0,0 +1,33 @@
+#ifndef TACO_LOOP_FUSION_H
+#define TACO_LOOP_FUSION_H
+
+#include <vector>
+#include <map>
+#include <utility>
+
+#include "taco/ir/ir.h"
+#include "taco/index_notation/index_notation.h"
+#include "taco/type.h"
+
+namespace taco {
+namespace lower {
+
+/// Maps the variables of loops that iterate over the full domain of an index
+/// variable (i.e. loops over dense modes) to the index variable and domain.
+typedef std::map<ir::Expr, std::pair<IndexVar,Dimension>> DenseLoops;
+
+/// Fuses the loop nests `loops2` into the loop nests `loops1`, which computes
+/// before `loops2`. Two loops are fused if they iterate over the same range,
+/// or if both are dense loops over the same index variable with the same fixed
+/// size domain. If `independent` is true, then the loop nests do not read or
+/// write the results of each other, and loops are fused at every depth.
+/// Otherwise, only the last outer loop of `loops1` is fused with the first
+/// outer loop of `loops2`, by appending the body of the latter to the body of
+/// the former. Statements of `loops2` that are not fused are appended.
+std::vector<ir::Stmt> fuseLoops(const std::vector<ir::Stmt>& loops1,
+                                const std::vector<ir::Stmt>& loops2,
+                                const DenseLoops& denseLoops,
+                                bool independent);
+
+}}
+#endif
@@ -8,6 +8,7 @@
 
 #include "taco/ir/ir.h"
 #include "taco/ir/ir_visitor.h"
+#include "taco/ir/ir_rewriter.h"
 #include "ir/ir_generators.h"
 
 #include "lower_codegen.h"
@@ -16,10 +17,13 @@
 #include "merge_lattice.h"
 #include "iteration_graph.h"
 #include "expr_tools.h"
+#include "loop_fusion.h"
 #include "taco/index_notation/index_notation_nodes.h"
 #include "taco/index_notation/index_notation_rewriter.h"
 #include "taco/index_notation/schedule.h"
 #include "storage/iterator.h"
+#include "taco/error/error_messages.h"
+#include "error/error_checks.h"
 #include "taco/util/name_generator.h"
 #include "taco/util/collections.h"
 #include "taco/util/strings.h"
@@ -49,13 +53,35 @@ struct Context {
   /// (Not clear if this approach to temporaries is too hacky.)
   map<TensorVar,Expr> temporaries;
 
+  /// Loops over dense modes with constant dimensions no larger than this are
+  /// fully unrolled.
+  size_t               maxSpecializedDimension;
+
+  /// The number of loop iterations ahead to prefetch indirect accesses.
+  size_t               prefetchDistance;
+
+  /// The domains of the index variables
+  map<IndexVar,Dimension> indexVarDomains;
+
+  /// The emitted loops that iterate over the full domain of an index variable
+  DenseLoops           denseLoops;
+
+  /// True if an operand iterates over duplicate coordinates of a free
+  /// variable, so that result values are computed by several loop iterations.
+  bool                 accumulateDuplicates = false;
+
   Context(const IterationGraph& iterationGraph,
           const set<Property>& properties,
-          const map<TensorVar,Expr>& tensorVars) {
+          const map<TensorVar,Expr>& tensorVars,
+          const map<IndexVar,Dimension>& indexVarDomains,
+          const Schedule& schedule) {
     this->properties = properties;
     this->iterationGraph = iterationGraph;
     this->allocSize  = Var::make("init_alloc_size", Int());
     this->iterators = Iterators(iterationGraph, tensorVars);
+    this->indexVarDomains = indexVarDomains;
+    this->maxSpecializedDimension = schedule.getMaxSpecializedDimension();
+    this->prefetchDistance = schedule.getPrefetchDistance();
   }
 };
 
@@ -115,6 +141,14 @@ static bool needsZero(const Context& ctx) {
   const auto& graph = ctx.iterationGraph;
   const auto& resultIdxVars = graph.getResultTensorPath().getVariables();
 
+  // The empty slots of hashed levels must hold zeros
+  const auto& resultPath = graph.getResultTensorPath();
+  for (size_t i = 0; i < resultPath.getSize(); ++i) {
+    if (ctx.iterators[resultPath.getStep(i)].getCapacity().defined()) {
+      return true;
+    }
+  }
+
   if (graph.hasReductionVariableAncestor(resultIdxVars.back())) {
     return true;
   }
@@ -206,6 +240,71 @@ static LoopKind doParallelize(const IndexVar& indexVar, const Expr& tensor,
   return LoopKind::Dynamic;
 }
 
+/// Returns the loop kind of a for loop over `iterator`, which is unrolled if
+/// the iterator is dense and its dimension is a small enough constant.
+static LoopKind getLoopKind(const IndexVar& indexVar, const Iterator& iterator,
+                            const Context& ctx) {
+  // Iterations over duplicate coordinates may update the same result values
+  if (!iterator.isUnique()) {
+    return LoopKind::Serial;
+  }
+
+  LoopKind kind = doParallelize(indexVar, iterator.getTensor(), ctx);
+  if (kind == LoopKind::Serial && iterator.isDense() &&
+      isa<ir::Literal>(iterator.begin()) && isa<ir::Literal>(iterator.end())) {
+    long long dimension = to<ir::Literal>(iterator.end())->int_value;
+    if (dimension <= (long long)ctx.maxSpecializedDimension) {
+      return LoopKind::Unrolled;
+    }
+  }
+  return kind;
+}
+
+/// Returns a statement that prefetches the values of the random access
+/// iterators, at the index that the sequential access `iterator` reaches
+/// `ctx.prefetchDistance` loop iterations ahead:
+/// if (pA2 + 16 < A2_pos[pA1 + 1]) __builtin_prefetch(&x_vals[A2_idx[pA2 + 16]]);
+/// Random access iterators with sparse levels below them are not prefetched.
+static Stmt prefetch(const Iterator& iterator,
+                     const vector<Iterator>& randomAccessIterators,
+                     const Context& ctx) {
+  Expr ptr = ir::Add::make(iterator.getIteratorVar(),
+                           (long long)ctx.prefetchDistance);
+  Expr idx = iterator.getIdx(ptr);
+  if (ctx.prefetchDistance == 0 || !idx.defined()) {
+    return Stmt();
+  }
+
+  vector<Stmt> prefetches;
+  for (auto& randomAccessIterator : randomAccessIterators) {
+    // Compute the position of the first value of the sub-tensor at `idx`
+    Expr pos = ir::Add::make(
+        ir::Mul::make(randomAccessIterator.getParent().getPtrVar(),
+                      randomAccessIterator.end()), idx);
+    const TensorPath& path = randomAccessIterator.getTensorPath();
+    bool below = false;
+    for (size_t i = 0; i < path.getSize() && pos.defined(); ++i) {
+      Iterator levelIterator = ctx.iterators[path.getStep(i)];
+      if (below) {
+        pos = levelIterator.isDense() ? ir::Mul::make(pos, levelIterator.end())
+                                      : Expr();
+      }
+      below = below || (levelIterator == randomAccessIterator);
+    }
+    if (pos.defined()) {
+      Expr vals = GetProperty::make(randomAccessIterator.getTensor(),
+                                    TensorProperty::Values);
+      prefetches.push_back(Prefetch::make(vals, pos));
+    }
+  }
+
+  if (prefetches.empty()) {
+    return Stmt();
+  }
+  return IfThenElse::make(Lt::make(ptr, iterator.end()),
+                          Block::make(prefetches));
+}
+
 /// Expression evaluates to true iff none of the iteratators are exhausted
 static Expr noneExhausted(const vector<Iterator>& iterators) {
   vector<Expr> stepIterLqEnd;
@@ -253,6 +352,18 @@ static Iterator getIterator(const Expr& idx,
   return Iterator();
 }
 
+/// Returns the iterators of `lp` whose coordinates are located instead of
+/// iterated, which are the locatable iterators that are not merged.
+static vector<Iterator> getLocatedIterators(const MergeLatticePoint& lp) {
+  vector<Iterator> located;
+  for (auto& iterator : lp.getIterators()) {
+    if (!iterator.isDense() && !contains(lp.getRangeIterators(), iterator)) {
+      located.push_back(iterator);
+    }
+  }
+  return located;
+}
+
 static vector<Iterator> removeIterator(const Expr& idx,
                                        const vector<Iterator>& iterators) {
   vector<Iterator> result;
@@ -316,20 +427,40 @@ static vector<Stmt> lower(const Target&      target,
                                   ? ctx.iterators[resultStep]
                                   : Iterator();
 
-  bool accumulate   = util::contains(ctx.properties, Accumulate);
+  bool accumulate   = util::contains(ctx.properties, Accumulate) ||
+                      ctx.accumulateDuplicates;
   bool emitCompute  = util::contains(ctx.properties, Compute);
   bool emitAssemble = util::contains(ctx.properties, Assemble);
   bool emitMerge    = needsMerge(lattice);
 
+  if (emitMerge) {
+    for (auto& iterator : lattice.getIterators()) {
+      taco_uassert(iterator.isUnique()) << error::compile_merge_duplicates;
+    }
+  }
+
   vector<Stmt> code;
 
   // Emit code to initialize pos variables:
   // B2_pos = B2_pos_arr[B1_pos];
   if (emitMerge) {
+    set<Iterator> rangeIterators;
+    for (auto& lp : lattice) {
+      rangeIterators.insert(lp.getRangeIterators().begin(),
+                            lp.getRangeIterators().end());
+    }
     for (auto& iterator : lattice.getIterators()) {
+      // Iterators that are only located are not iterated
+      if (!iterator.isDense() && !contains(rangeIterators, iterator)) {
+        continue;
+      }
       Expr iteratorVar = iterator.getIteratorVar();
       Stmt iteratorInit = VarAssign::make(iteratorVar, iterator.begin(), true);
       code.push_back(iteratorInit);
+      Stmt mergeVarsInit = iterator.initMergeVars();
+      if (mergeVarsInit.defined()) {
+        code.push_back(mergeVarsInit);
+      }
     }
   }
 
@@ -345,14 +476,21 @@ static vector<Stmt> lower(const Target&      target,
     // int kB = B1_idx_arr[B1_pos];
     // int kc = c0_idx_arr[c0_pos];
     vector<Expr> mergeIdxVariables;
-    auto sequentialAccessIterators = getSequentialAccessIterators(lpIterators);
+    auto locatedIterators = getLocatedIterators(lp);
+    vector<Iterator> sequentialAccessIterators;
+    for (auto& iterator : getSequentialAccessIterators(lpIterators)) {
+      if (!contains(locatedIterators, iterator)) {
+        sequentialAccessIterators.push_back(iterator);
+      }
+    }
     for (Iterator& iterator : sequentialAccessIterators) {
       Stmt initIdx = iterator.initDerivedVar();
       loopBody.push_back(initIdx);
       mergeIdxVariables.push_back(iterator.getIdxVar());
     }
 
-    const bool mergeWithSwitch = (sequentialAccessIterators.size() > 2 && 
+    const bool mergeWithSwitch = (locatedIterators.empty() &&
+        sequentialAccessIterators.size() > 2 && 
         sequentialAccessIterators.size() <= UInt().getNumBits() && 
         lpLattice.getSize() == (1u << sequentialAccessIterators.size()) - 1);
 
@@ -369,13 +507,15 @@ static vector<Stmt> lower(const Target&      target,
             : lp.getMergeIterators()[0].getIdxVar();
     }
 
-    // Emit code to initialize random access pos variables:
+    // Emit code to initialize random access pos variables, and the positions
+    // of located iterators, which are -1 if they do not store the index:
     // D1_pos = (D0_pos * 3) + k;
-    auto randomAccessIterators =
-        getRandomAccessIterators(util::combine(lpIterators, {resultIterator}));
+    auto randomAccessIterators = util::combine(
+        getRandomAccessIterators(util::combine(lpIterators, {resultIterator})),
+        locatedIterators);
     for (Iterator& iterator : randomAccessIterators) {
-      Expr val = ir::Add::make(ir::Mul::make(iterator.getParent().getPtrVar(),
-                                             iterator.end()), idx);
+      Expr val = iterator.locate(idx, emitAssemble &&
+                                      iterator == resultIterator);
       Stmt initPos = VarAssign::make(iterator.getPtrVar(), val, true);
       loopBody.push_back(initPos);
     }
@@ -532,10 +672,30 @@ static vector<Stmt> lower(const Target&      target,
         util::append(caseBody, {posInc});
       }
 
-      auto caseIterators = removeIterator(idx, lq.getRangeIterators());
+      vector<Iterator> caseIterators;
+      for (auto& iterator : removeIterator(idx, lq.getRangeIterators())) {
+        if (!contains(locatedIterators, iterator)) {
+          caseIterators.push_back(iterator);
+        }
+      }
       Expr cond = mergeWithSwitch 
                   ? indicatorMask(sequentialAccessIterators, caseIterators) 
                   : allEqualTo(caseIterators,idx);
+
+      // Cases with located iterators require them to store the index
+      vector<Expr> locatedConds;
+      for (auto& iterator : lq.getIterators()) {
+        if (contains(locatedIterators, iterator)) {
+          locatedConds.push_back(Gte::make(iterator.getPtrVar(), 0ll));
+        }
+      }
+      if (!locatedConds.empty()) {
+        auto lit = cond.as<ir::Literal>();
+        if (lit == nullptr || lit->type != Bool || !lit->bool_value) {
+          locatedConds.insert(locatedConds.begin(), cond);
+        }
+        cond = conjunction(locatedConds);
+      }
       cases.push_back({cond, Block::make(caseBody)});
     }
     loopBody.push_back(createIfStatements(cases, lpLattice, ind));
@@ -549,27 +709,20 @@ static vector<Stmt> lower(const Target&      target,
       if (mergeWithSwitch) {
         for (size_t i = 0; i < sequentialAccessIterators.size(); ++i) {
           const auto& iterator = sequentialAccessIterators[i];
-          Expr ivar = iterator.getIteratorVar();
           Expr incExpr = Neq::make(BitAnd::make(ind, 1ull << i), 0ull);
-          incExpr = Cast::make(incExpr, ivar.type());
-          Stmt inc = VarAssign::make(ivar, ir::Add::make(ivar, incExpr));
-          loopBody.push_back(inc);
+          loopBody.push_back(iterator.advance(incExpr));
         }
       } else {
         for (auto& iterator : removeIterator(idx, lp.getRangeIterators())) {
-          Expr ivar = iterator.getIteratorVar();
           Expr tensorIdx = iterator.getIdxVar();
-          Expr incExpr = Cast::make(Eq::make(tensorIdx, idx), ivar.type());
-          Stmt inc = VarAssign::make(ivar, ir::Add::make(ivar, incExpr));
-          loopBody.push_back(inc);
+          loopBody.push_back(iterator.advance(Eq::make(tensorIdx, idx)));
         }
       }
 
       /// k++
       auto idxIterator = getIterator(idx, lpIterators);
       if (idxIterator.defined()) {
-        Expr ivar = idxIterator.getIteratorVar();
-        loopBody.push_back(VarAssign::make(ivar, ir::Add::make(ivar, 1ll)));
+        loopBody.push_back(idxIterator.advance(ir::Literal::make(true)));
       }
     }
 
@@ -581,9 +734,28 @@ static vector<Stmt> lower(const Target&      target,
     }
     else {
       Iterator iter = lp.getRangeIterators()[0];
-      loop = For::make(iter.getIteratorVar(), iter.begin(), iter.end(), (long long) 1,
-                       Block::make(loopBody), 
-                       doParallelize(indexVar, iter.getTensor(), ctx));
+      if (emitCompute && iter.isSequentialAccess()) {
+        vector<Iterator> operandIterators;
+        for (auto& iterator : getRandomAccessIterators(lpIterators)) {
+          if (iterator != resultIterator) {
+            operandIterators.push_back(iterator);
+          }
+        }
+        Stmt prefetchStmt = prefetch(iter, operandIterators, ctx);
+        if (prefetchStmt.defined()) {
+          loopBody.insert(loopBody.begin(), prefetchStmt);
+        }
+      }
+      if (iter.isDense() && util::contains(ctx.indexVarDomains, indexVar)) {
+        ctx.denseLoops.insert({iter.getIteratorVar(),
+                               {indexVar, ctx.indexVarDomains.at(indexVar)}});
+      }
+      LoopKind kind = getLoopKind(indexVar, iter, ctx);
+      loop = iter.makeLoop(Block::make(loopBody), kind);
+      if (!loop.defined()) {
+        loop = For::make(iter.getIteratorVar(), iter.begin(), iter.end(),
+                         (long long) 1, Block::make(loopBody), kind);
+      }
     }
     loops.push_back(loop);
   }
@@ -601,13 +773,45 @@ static vector<Stmt> lower(const Target&      target,
   return code;
 }
 
-Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
-           int allocSize) {
+/// The code that computes an assignment, split up so that the code of several
+/// assignments can be combined into one function.
+struct LoweredAssignment {
+  vector<Expr>        parameters;
+  vector<Expr>        results;
+  map<TensorVar,Expr> tensorVars;
+  IterationGraph      iterationGraph;
+
+  /// Allocation of the result storage
+  vector<Stmt>        init;
+
+  /// Initialization of the result pos variables and values
+  vector<Stmt>        header;
+
+  /// The loop nests (or scalar code) that compute the assignment
+  vector<Stmt>        loops;
+
+  /// Code that follows the loops (allocation of assembled result values)
+  vector<Stmt>        footer;
+
+  /// The emitted loops that iterate over the full domain of an index variable
+  DenseLoops          denseLoops;
+};
+
+static LoweredAssignment lowerAssignment(TensorVar tensorVar,
+                                         set<Property> properties,
+                                         int allocSize) {
   auto name = tensorVar.getName();
   auto assignment = tensorVar.getAssignment();
   auto indexExpr = assignment.getRhs();
   auto freeVars = assignment.getFreeVars();
 
+  // The following are index expressions the implementation doesn't currently
+  // support, but that are planned for the future.
+  taco_uassert(!error::containsTranspose(tensorVar.getFormat(),
+                                         assignment.getLhs().getIndexVars(),
+                                         indexExpr))
+      << error::expr_transposition;
+
   const bool emitAssemble = util::contains(properties, Assemble);
   const bool emitCompute = util::contains(properties, Compute);
   taco_tassert(!assignment.getOp().defined() ||
@@ -618,16 +822,64 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
 
   Schedule schedule = tensorVar.getSchedule();
 
+  // Hashed levels can only be written to, below dense levels, and their
+  // values can only be written after all the coordinates have been inserted
+  for (auto& operand : getOperands(indexExpr)) {
+    taco_uassert(!isHashed(operand.getFormat())) <<
+        error::compile_hashed_operand;
+  }
+  if (isHashed(tensorVar.getFormat())) {
+    const auto& modeTypes = tensorVar.getFormat().getModeTypes();
+    for (size_t i = 0; i < modeTypes.size(); ++i) {
+      taco_uassert(modeTypes[i] == (i + 1 < modeTypes.size() ? Dense : Hashed))
+          << error::compile_hashed_result;
+    }
+    taco_uassert(!emitAssemble || !emitCompute) <<
+        error::compile_hashed_assemble_while_compute;
+  }
+  for (ModeType modeType : tensorVar.getFormat().getModeTypes()) {
+    taco_uassert(modeType != Bitmap) << error::compile_bitmap_result;
+    taco_uassert(modeType != Fixed) << error::compile_fixed_result;
+    taco_uassert(modeType != Diagonal) << error::compile_diagonal_result;
+    taco_uassert(modeType != Packed) << error::compile_packed_result;
+  }
+  for (auto& operand : getOperands(indexExpr)) {
+    const auto& modeTypes = operand.getFormat().getModeTypes();
+    taco_uassert(!util::contains(modeTypes, Diagonal) ||
+                 operand.getFormat() == DIA) << error::format_diagonal_mode;
+  }
+
   // Pack the tensor and it's expression operands into the parameter list
-  vector<Expr> parameters;
-  vector<Expr> results;
-  map<TensorVar,Expr> tensorVars;
-  tie(parameters,results,tensorVars) = getTensorVars(tensorVar);
+  LoweredAssignment lowered;
+  tie(lowered.parameters,lowered.results,lowered.tensorVars) =
+      getTensorVars(tensorVar);
 
   IterationGraph iterationGraph = IterationGraph::make(tensorVar);
-  Context ctx(iterationGraph, properties, tensorVars);
+  lowered.iterationGraph = iterationGraph;
+  Context ctx(iterationGraph, properties, lowered.tensorVars,
+              assignment.getIndexVarDomains(), schedule);
+
+  // Operands that iterate over duplicate coordinates of a free variable visit
+  // the same result values several times, so the results are accumulated into
+  // a zeroed dense result.
+  for (auto& path : iterationGraph.getTensorPaths()) {
+    for (size_t i = 0; i < path.getSize(); ++i) {
+      if (!ctx.iterators[path.getStep(i)].isUnique() &&
+          iterationGraph.isFree(path.getVariables()[i])) {
+        ctx.accumulateDuplicates = true;
+      }
+    }
+  }
+  if (ctx.accumulateDuplicates) {
+    TensorPath resultPath = iterationGraph.getResultTensorPath();
+    for (size_t i = 0; i < resultPath.getSize(); ++i) {
+      taco_uassert(ctx.iterators[resultPath.getStep(i)].isDense()) <<
+          error::compile_duplicates_sparse_result;
+    }
+  }
 
-  vector<Stmt> init, body;
+  vector<Stmt>& init = lowered.init;
+  vector<Stmt>& body = lowered.header;
 
   TensorPath resultPath = ctx.iterationGraph.getResultTensorPath();
   if (emitAssemble) {
@@ -667,7 +919,8 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
       }
     }
   }
-  taco_iassert(results.size() == 1) << "An expression can only have one result";
+  taco_iassert(lowered.results.size() == 1) <<
+      "An expression can only have one result";
 
   // Lower the iteration graph
   auto& roots = ctx.iterationGraph.getRoots();
@@ -686,6 +939,10 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
       Expr size = (long long) 1;
       for (auto& indexVar : resultPath.getVariables()) {
         const Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
+        if (iter.getCapacity().defined()) {
+          size = iter.getCapacity();
+          continue;
+        }
         if (!iter.isFixedRange()) {
           size = ctx.allocSize;
           break;
@@ -725,7 +982,7 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
     if (emitLoops) {
       for (auto& root : roots) {
         auto loopNest = lower::lower(target, root, indexExpr, {}, ctx);
-        util::append(body, loopNest);
+        util::append(lowered.loops, loopNest);
       }
     }
 
@@ -733,15 +990,16 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
       Expr size = (long long) 1;
       for (auto& indexVar : resultPath.getVariables()) {
         Iterator iter = ctx.iterators[resultPath.getStep(indexVar)];
-        size = iter.isFixedRange() ? ir::Mul::make(size, iter.end()) :
+        size = iter.getCapacity().defined() ? iter.getCapacity() :
+               iter.isFixedRange() ? ir::Mul::make(size, iter.end()) :
                iter.getPtrVar();
       }
       Stmt allocVals = Allocate::make(target.tensor, size);
       
-      if (!body.empty()) {
-        body.push_back(BlankLine::make());
+      if (!body.empty() || !lowered.loops.empty()) {
+        lowered.footer.push_back(BlankLine::make());
       }
-      body.push_back(allocVals);
+      lowered.footer.push_back(allocVals);
     }
   }
   // Lower scalar expressions
@@ -758,14 +1016,229 @@ Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
                                           ctx.iterationGraph,
                                           map<TensorVar,Expr>());
       Stmt compute = Store::make(vals, (long long) 0, expr);
-      body.push_back(compute);
+      lowered.loops.push_back(compute);
+    }
+  }
+
+  lowered.denseLoops = ctx.denseLoops;
+  return lowered;
+}
+
+Stmt lower(TensorVar tensorVar, string functionName, set<Property> properties,
+           int allocSize) {
+  LoweredAssignment lowered = lowerAssignment(tensorVar, properties, allocSize);
+
+  vector<Stmt> body = lowered.init;
+  if (!body.empty()) {
+    body.push_back(BlankLine::make());
+  }
+  util::append(body, lowered.header);
+  util::append(body, lowered.loops);
+  util::append(body, lowered.footer);
+
+  return Function::make(functionName, lowered.parameters, lowered.results,
+                        Block::make(body));
+}
+
+/// Returns the assignments of an index statement built from assignments,
+/// multi statements and sequence statements, in the order they execute.
+static vector<Assignment> getAssignments(IndexStmt stmt) {
+  if (isa<Assignment>(stmt)) {
+    return {to<Assignment>(stmt)};
+  }
+  else if (isa<Multi>(stmt)) {
+    return util::combine(getAssignments(to<Multi>(stmt).getStmt1()),
+                         getAssignments(to<Multi>(stmt).getStmt2()));
+  }
+  else if (isa<Sequence>(stmt)) {
+    return util::combine(getAssignments(to<Sequence>(stmt).getDefinition()),
+                         getAssignments(to<Sequence>(stmt).getMutation()));
+  }
+  taco_not_supported_yet << "Lowering " << stmt;
+  return {};
+}
+
+/// Returns the accesses of a tensor in an assignment.
+static vector<Access> getAccesses(const Assignment& assignment,
+                                  const TensorVar& tensor) {
+  vector<Access> accesses;
+  if (assignment.getLhs().getTensorVar() == tensor) {
+    accesses.push_back(assignment.getLhs());
+  }
+  match(assignment.getRhs(),
+    function<void(const AccessNode*)>([&](const AccessNode* op) {
+      if (op->tensorVar == tensor) {
+        accesses.push_back(op);
+      }
+    })
+  );
+  return accesses;
+}
+
+/// Returns true iff the outer loop of `consumer`, which reads or writes the
+/// result of `producer`, can be fused with the outer loop of `producer`. This
+/// is the case if the result is dense, both outer loops iterate over the same
+/// free variable of `producer`, and `consumer` only accesses the result at the
+/// locations that `producer` writes in the same outer loop iteration.
+static bool canFuseOuterLoops(const Assignment& producer,
+                              const LoweredAssignment& loweredProducer,
+                              const Assignment& consumer,
+                              const LoweredAssignment& loweredConsumer) {
+  TensorVar result = producer.getLhs().getTensorVar();
+  if (!isDense(result.getFormat())) {
+    return false;
+  }
+
+  auto& producerRoots = loweredProducer.iterationGraph.getRoots();
+  auto& consumerRoots = loweredConsumer.iterationGraph.getRoots();
+  if (producerRoots.size() != 1 || consumerRoots.size() != 1 ||
+      producerRoots[0] != consumerRoots[0] ||
+      !util::contains(producer.getFreeVars(), producerRoots[0])) {
+    return false;
+  }
+
+  for (auto& access : getAccesses(consumer, result)) {
+    if (access.getIndexVars() != producer.getLhs().getIndexVars()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Stmt lower(IndexStmt stmt, string functionName, set<Property> properties,
+           int allocSize) {
+  vector<Assignment> assignments = getAssignments(stmt);
+
+  vector<TensorVar> resultVars;
+  for (auto& assignment : assignments) {
+    TensorVar result = assignment.getLhs().getTensorVar();
+    if (!util::contains(resultVars, result)) {
+      resultVars.push_back(result);
+    }
+  }
+
+  // The tensor variables of the assignments are mapped to the same IR
+  // variables, so that the function has one parameter per tensor
+  map<TensorVar,Expr> tensorVars;
+
+  vector<Stmt> init, header, loops, footer;
+  DenseLoops denseLoops;
+  vector<LoweredAssignment> loweredAssignments;
+  for (size_t i = 0; i < assignments.size(); ++i) {
+    Assignment assignment = assignments[i];
+    TensorVar result = assignment.getLhs().getTensorVar();
+
+    // A result that is computed by an earlier assignment is updated in place
+    set<Property> assignmentProperties = properties;
+    bool isUpdate = false;
+    for (size_t j = 0; j < i; ++j) {
+      isUpdate = isUpdate || assignments[j].getLhs().getTensorVar() == result;
+    }
+    if (isUpdate) {
+      taco_uassert(assignment.getOp().defined() &&
+                   isDense(result.getFormat()))
+          << "Only dense tensors can be updated by a compound assignment "
+          << "after they are computed: " << assignment;
+      assignmentProperties.erase(Assemble);
+    }
+
+    // Assignments other than the tensor's own assignment are lowered through
+    // a tensor variable with the same name, type, format and schedule
+    TensorVar tensorVar = result;
+    if (result.getAssignment().ptr != assignment.ptr) {
+      tensorVar = TensorVar(result.getName(), result.getType(),
+                            result.getFormat());
+      tensorVar.setAssignment(makeReductionNotation(assignment));
+      Schedule schedule = tensorVar.getSchedule();
+      schedule.setMaxSpecializedDimension(
+          result.getSchedule().getMaxSpecializedDimension());
+      schedule.setPrefetchDistance(result.getSchedule().getPrefetchDistance());
+    }
+    LoweredAssignment lowered = lowerAssignment(tensorVar,
+                                                assignmentProperties,
+                                                allocSize);
+
+    map<Expr,Expr> substitutions;
+    for (auto& var : lowered.tensorVars) {
+      TensorVar tensor = (var.first == tensorVar) ? result : var.first;
+      if (util::contains(tensorVars, tensor)) {
+        substitutions.insert({var.second, tensorVars.at(tensor)});
+      }
+      else {
+        tensorVars.insert({tensor, var.second});
+      }
+    }
+    for (auto* stmts : {&lowered.init, &lowered.header, &lowered.loops,
+                        &lowered.footer}) {
+      for (auto& stmt : *stmts) {
+        stmt = replace(stmt, substitutions);
+      }
+    }
+
+    // Determine how deep the loops of the assignment can be fused with the
+    // loops of the earlier assignments
+    enum {None, Outer, Full} fusion = Full;
+    set<TensorVar> operands;
+    for (auto& operand : getOperands(assignment.getRhs())) {
+      operands.insert(operand);
+    }
+    for (size_t j = 0; j < i; ++j) {
+      TensorVar earlierResult = assignments[j].getLhs().getTensorVar();
+      bool reads = util::contains(operands, earlierResult);
+      bool writes = (earlierResult == result);
+      if (util::contains(getOperands(assignments[j].getRhs()), result)) {
+        fusion = None;
+      }
+      else if (reads || writes) {
+        if (!canFuseOuterLoops(assignments[j], loweredAssignments[j],
+                               assignment, lowered)) {
+          fusion = None;
+        }
+        else if (fusion == Full) {
+          fusion = Outer;
+        }
+      }
+    }
+
+    for (auto& denseLoop : lowered.denseLoops) {
+      denseLoops.insert(denseLoop);
+    }
+    util::append(init, lowered.init);
+    if (fusion == None) {
+      util::append(loops, lowered.header);
+      util::append(loops, lowered.loops);
+    }
+    else {
+      util::append(header, lowered.header);
+      loops = fuseLoops(loops, lowered.loops, denseLoops, fusion == Full);
+    }
+    util::append(footer, lowered.footer);
+    loweredAssignments.push_back(lowered);
+  }
+
+  // Outputs are the results, and inputs the remaining operands
+  vector<Expr> parameters;
+  vector<Expr> results;
+  for (auto& result : resultVars) {
+    results.push_back(tensorVars.at(result));
+  }
+  for (auto& assignment : assignments) {
+    for (auto& operand : getOperands(assignment.getRhs())) {
+      Expr parameter = tensorVars.at(operand);
+      if (!util::contains(resultVars, operand) &&
+          !util::contains(parameters, parameter)) {
+        parameters.push_back(parameter);
+      }
     }
   }
 
-  if (!init.empty()) {
-    init.push_back(BlankLine::make());
+  vector<Stmt> body = init;
+  if (!body.empty()) {
+    body.push_back(BlankLine::make());
   }
-  body = util::combine(init, body);
+  util::append(body, header);
+  util::append(body, loops);
+  util::append(body, footer);
 
   return Function::make(functionName, parameters, results, Block::make(body));
 }
@@ -353,8 +353,16 @@ bool operator!=(const MergeLattice& a, const MergeLattice& b) {
 MergeLatticePoint::MergeLatticePoint(vector<storage::Iterator> iterators,
                                      vector<storage::Iterator> mergeIterators,
                                      IndexExpr expr)
-    : iterators(iterators), rangeIterators(simplify(iterators)),
-      mergeIterators(mergeIterators), expr(expr) {
+    : iterators(iterators), mergeIterators(mergeIterators), expr(expr) {
+  // Locatable iterators that are not merged are located instead of iterated
+  for (auto& iter : simplify(iterators)) {
+    if (!iter.isLocatable() || util::contains(mergeIterators, iter)) {
+      rangeIterators.push_back(iter);
+    }
+  }
+  if (rangeIterators.empty()) {
+    rangeIterators = simplify(iterators);
+  }
 }
 
 const vector<storage::Iterator>& MergeLatticePoint::getIterators() const {
@@ -393,10 +401,23 @@ MergeLatticePoint merge(MergeLatticePoint a, MergeLatticePoint b,
                getDenseIterators(bMergeIters).size() == 0));
 
   // If both merge iterator lists consist of sparse iterators then the result
-  // is a union of those lists
+  // is a union of those lists. Conjunctive operators test the membership of
+  // the coordinates of the other iterators in locatable iterators instead of
+  // merging them.
   if (!aMergeIters[0].isDense() && !bMergeIters[0].isDense()) {
     mergeIters.insert(mergeIters.end(), aMergeIters.begin(), aMergeIters.end());
     mergeIters.insert(mergeIters.end(), bMergeIters.begin(), bMergeIters.end());
+    if (conjunctive) {
+      vector<storage::Iterator> notLocatable;
+      for (auto& iter : mergeIters) {
+        if (!iter.isLocatable()) {
+          notLocatable.push_back(iter);
+        }
+      }
+      if (!notLocatable.empty()) {
+        mergeIters = notLocatable;
+      }
+    }
   }
   // If both merge iterator lists consist of a dense iterator then the result
   // is a dense iterator
@@ -103,7 +103,8 @@ public:
 
   /// Returns the iterators that determine the range of the lattice point
   /// iteration space. These are the iterators that are checked for exhaustion
-  /// in the range of the lattice point loop.
+  /// in the range of the lattice point loop. Locatable iterators that are not
+  /// merged are located instead, and are not range iterators.
   const std::vector<storage::Iterator>& getRangeIterators() const;
 
   /// Returns the subset of iterators that needs to be merged to cover the
@@ -0,0 +1,319 @@
+#include "taco/storage/allocator.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+static atomic<size_t> liveBytes(0);
+static atomic<size_t> peakBytes(0);
+static atomic<size_t> numAllocations(0);
+
+void recordAllocation(size_t bytes) {
+  const size_t live = (liveBytes += bytes);
+  size_t peak = peakBytes.load();
+  while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {
+  }
+  ++numAllocations;
+}
+
+void recordDeallocation(size_t bytes) {
+  liveBytes -= bytes;
+}
+
+MemoryStats getMemoryStats() {
+  return {liveBytes.load(), peakBytes.load(), numAllocations.load()};
+}
+
+void resetPeakMemory() {
+  peakBytes = liveBytes.load();
+}
+
+// The memory of malloc'ed arrays is accounted by their usable size, which is
+// known again when they are freed
+static size_t getMallocSize(void* data) {
+#ifdef __APPLE__
+  return malloc_size(data);
+#else
+  return malloc_usable_size(data);
+#endif
+}
+
+static void* mallocAllocate(void* context, size_t size) {
+  void* data = malloc(size);
+  if (data != nullptr) {
+    recordAllocation(getMallocSize(data));
+  }
+  return data;
+}
+
+static void* mallocReallocate(void* context, void* data, size_t size) {
+  const size_t oldSize = (data != nullptr) ? getMallocSize(data) : 0;
+  void* resized = realloc(data, size);
+  if (resized != nullptr) {
+    recordDeallocation(oldSize);
+    recordAllocation(getMallocSize(resized));
+  }
+  return resized;
+}
+
+static void mallocDeallocate(void* context, void* data) {
+  if (data != nullptr) {
+    recordDeallocation(getMallocSize(data));
+  }
+  free(data);
+}
+
+// Aligned arrays are preceded by a header, padded to the alignment, that
+// records their size and whether they were mapped on their own.
+struct AlignedHeader {
+  size_t size;
+  bool   isMapped;
+};
+static_assert(sizeof(AlignedHeader) <= ARRAY_ALIGNMENT,
+              "The header of aligned arrays must fit in the alignment");
+
+static const size_t HUGE_PAGE_SIZE = 1 << 21;
+
+struct AlignedOptions {
+  HugePages hugePages;
+  size_t    hugePageThreshold;
+};
+
+static AlignedHeader* getHeader(void* data) {
+  return (AlignedHeader*)((char*)data - ARRAY_ALIGNMENT);
+}
+
+static size_t getMappedSize(size_t size) {
+  return (size + ARRAY_ALIGNMENT + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE *
+         HUGE_PAGE_SIZE;
+}
+
+static void* mapHugePages(size_t size, HugePages hugePages) {
+  const size_t mappedSize = getMappedSize(size);
+#ifdef MAP_HUGETLB
+  if (hugePages == HugePages::Explicit) {
+    void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base != MAP_FAILED) {
+      return base;
+    }
+  }
+#endif
+  void* base = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    return nullptr;
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(base, mappedSize, MADV_HUGEPAGE);
+#endif
+  return base;
+}
+
+static void* alignedAllocate(void* context, size_t size) {
+  const AlignedOptions& options = *(const AlignedOptions*)context;
+  void* base = nullptr;
+  bool isMapped = false;
+  if (options.hugePages != HugePages::None &&
+      size >= options.hugePageThreshold) {
+    base = mapHugePages(size, options.hugePages);
+    isMapped = (base != nullptr);
+  }
+  if (base == nullptr &&
+      posix_memalign(&base, ARRAY_ALIGNMENT, size + ARRAY_ALIGNMENT) != 0) {
+    return nullptr;
+  }
+  recordAllocation(isMapped ? getMappedSize(size) : size + ARRAY_ALIGNMENT);
+  void* data = (char*)base + ARRAY_ALIGNMENT;
+  *getHeader(data) = {size, isMapped};
+  return data;
+}
+
+static void alignedDeallocate(void* context, void* data) {
+  if (data == nullptr) {
+    return;
+  }
+  AlignedHeader* header = getHeader(data);
+  if (header->isMapped) {
+    recordDeallocation(getMappedSize(header->size));
+    munmap(header, getMappedSize(header->size));
+  } else {
+    recordDeallocation(header->size + ARRAY_ALIGNMENT);
+    free(header);
+  }
+}
+
+static void* alignedReallocate(void* context, void* data, size_t size) {
+  if (data == nullptr) {
+    return alignedAllocate(context, size);
+  }
+  // Mapped arrays grow in place until they fill their huge pages
+  AlignedHeader* header = getHeader(data);
+  if (header->isMapped && getMappedSize(size) == getMappedSize(header->size)) {
+    header->size = size;
+    return data;
+  }
+  void* resized = alignedAllocate(context, size);
+  if (resized != nullptr) {
+    memcpy(resized, data, min(size, header->size));
+    alignedDeallocate(context, data);
+  }
+  return resized;
+}
+
+static Allocator& currentAllocator() {
+  static Allocator allocator = getDefaultAllocator();
+  return allocator;
+}
+
+Allocator getDefaultAllocator() {
+  return {mallocAllocate, mallocReallocate, mallocDeallocate, nullptr};
+}
+
+Allocator getAlignedAllocator(HugePages hugePages, size_t hugePageThreshold) {
+  // The options are interned, so that allocators with the same options have
+  // the same context
+  static map<pair<HugePages,size_t>, AlignedOptions> options;
+  auto key = make_pair(hugePages, hugePageThreshold);
+  if (options.find(key) == options.end()) {
+    options[key] = {hugePages, hugePageThreshold};
+  }
+  return {alignedAllocate, alignedReallocate, alignedDeallocate, &options[key]};
+}
+
+bool isAligned(const Allocator& allocator) {
+  return allocator.allocate == alignedAllocate;
+}
+
+Allocator getAllocator() {
+  return currentAllocator();
+}
+
+void setAllocator(const Allocator& allocator) {
+  currentAllocator() = allocator;
+}
+
+struct ArenaContent {
+  Allocator allocator;
+
+  /// The sizes of the live arrays allocated through the arena
+  map<void*, size_t> sizes;
+
+  /// The deallocated arrays the arena keeps, by size
+  map<size_t, vector<void*>> kept;
+  size_t keptBytes = 0;
+
+  /// True if the arena was destroyed while some of its arrays were live, which
+  /// are then reclaimed by the underlying allocator
+  bool destroyed = false;
+
+  void clear() {
+    for (auto& arrays : kept) {
+      for (void* data : arrays.second) {
+        allocator.deallocate(allocator.context, data);
+      }
+    }
+    kept.clear();
+    keptBytes = 0;
+  }
+};
+
+static void* arenaAllocate(void* context, size_t size) {
+  ArenaContent* content = (ArenaContent*)context;
+  void* data = nullptr;
+  auto arrays = content->kept.find(size);
+  if (arrays != content->kept.end() && !arrays->second.empty()) {
+    data = arrays->second.back();
+    arrays->second.pop_back();
+    content->keptBytes -= size;
+  } else {
+    data = content->allocator.allocate(content->allocator.context, size);
+  }
+  if (data != nullptr) {
+    content->sizes[data] = size;
+  }
+  return data;
+}
+
+static void arenaDeallocate(void* context, void* data) {
+  ArenaContent* content = (ArenaContent*)context;
+  auto size = content->sizes.find(data);
+  if (size == content->sizes.end()) {
+    return;
+  }
+  if (content->destroyed) {
+    content->allocator.deallocate(content->allocator.context, data);
+  } else {
+    content->kept[size->second].push_back(data);
+    content->keptBytes += size->second;
+  }
+  content->sizes.erase(size);
+  if (content->destroyed && content->sizes.empty()) {
+    delete content;
+  }
+}
+
+static void* arenaReallocate(void* context, void* data, size_t size) {
+  ArenaContent* content = (ArenaContent*)context;
+  auto oldSize = content->sizes.find(data);
+  if (oldSize == content->sizes.end()) {
+    return arenaAllocate(context, size);
+  }
+
+  // Arrays grow into kept arrays of the new size, and otherwise in place
+  auto arrays = content->kept.find(size);
+  if (arrays != content->kept.end() && !arrays->second.empty()) {
+    void* resized = arenaAllocate(context, size);
+    memcpy(resized, data, min(size, oldSize->second));
+    arenaDeallocate(context, data);
+    return resized;
+  }
+  void* resized = content->allocator.reallocate(content->allocator.context,
+                                                data, size);
+  if (resized != nullptr) {
+    content->sizes.erase(data);
+    content->sizes[resized] = size;
+  }
+  return resized;
+}
+
+Arena::Arena(const Allocator& allocator) : content(new ArenaContent) {
+  content->allocator = allocator;
+}
+
+Arena::~Arena() {
+  content->clear();
+  if (content->sizes.empty()) {
+    delete content;
+  } else {
+    content->destroyed = true;
+  }
+}
+
+Allocator Arena::getAllocator() const {
+  return {arenaAllocate, arenaReallocate, arenaDeallocate, content};
+}
+
+size_t Arena::getKeptBytes() const {
+  return content->keptBytes;
+}
+
+void Arena::clear() {
+  content->clear();
+}
+
+}}
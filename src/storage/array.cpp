@@ -2,6 +2,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <sys/mman.h>
 
 #include "taco/type.h"
 #include "taco/error.h"
@@ -15,9 +16,10 @@ namespace storage {
 
 struct Array::Content : util::Uncopyable {
   DataType   type;
-  void*  data;
-  size_t size;
+  void*  data = nullptr;
+  size_t size = 0;
   Policy policy = Array::UserOwns;
+  Allocator allocator;
 
   ~Content() {
     switch (policy) {
@@ -27,6 +29,12 @@ struct Array::Content : util::Uncopyable {
       case Free:
         free(data);
         break;
+      case Deallocate:
+        allocator.deallocate(allocator.context, data);
+        break;
+      case Unmap:
+        munmap(data, size * type.getNumBytes());
+        break;
       case Delete:
         switch (type.getKind()) {
           case DataType::Bool:
@@ -93,6 +101,12 @@ Array::Array(DataType type, void* data, size_t size, Policy policy) : Array() {
   content->policy = policy;
 }
 
+Array::Array(DataType type, void* data, size_t size,
+             const Allocator& allocator)
+    : Array(type, data, size, Deallocate) {
+  content->allocator = allocator;
+}
+
 const DataType& Array::getType() const {
   return content->type;
 }
@@ -200,6 +214,12 @@ std::ostream& operator<<(std::ostream& os, Array::Policy policy) {
     case Array::Delete:
       os << "delete";
       break;
+    case Array::Deallocate:
+      os << "deallocate";
+      break;
+    case Array::Unmap:
+      os << "unmap";
+      break;
   }
   return os;
 }
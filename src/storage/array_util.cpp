@@ -4,7 +4,9 @@ namespace taco {
 namespace storage {
 
 Array makeArray(DataType type, size_t size) {
-  return Array(type, malloc(size * type.getNumBytes()), size, Array::Free);
+  Allocator allocator = getAllocator();
+  void* data = allocator.allocate(allocator.context, size * type.getNumBytes());
+  return Array(type, data, size, allocator);
 }
 
 }}
@@ -0,0 +1,163 @@
+#include "bitmap_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+BitmapIterator::BitmapIterator(std::string name, const Expr& tensor, int level,
+                               size_t dimension, Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+  this->numWords = (long long)((dimension + 31) / 32);
+
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     Int());
+  idxVar = Var::make(idxVarName, Int());
+  wordVar = Var::make("w" + util::toString(tensor) + std::to_string(level + 1),
+                      Int());
+  bitsVar = Var::make("b" + util::toString(tensor) + std::to_string(level + 1),
+                      UInt32);
+}
+
+bool BitmapIterator::isDense() const {
+  return false;
+}
+
+bool BitmapIterator::isFixedRange() const {
+  return false;
+}
+
+bool BitmapIterator::isRandomAccess() const {
+  return false;
+}
+
+bool BitmapIterator::isSequentialAccess() const {
+  return true;
+}
+
+bool BitmapIterator::isLocatable() const {
+  return true;
+}
+
+Expr BitmapIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr BitmapIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr BitmapIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr BitmapIterator::begin() const {
+  return Load::make(getRankArr(), getFirstWord());
+}
+
+Expr BitmapIterator::end() const {
+  return Load::make(getRankArr(), Add::make(getFirstWord(), numWords));
+}
+
+Stmt BitmapIterator::initDerivedVars() const {
+  Expr bit = Call::make("__builtin_ctz", {bitsVar}, Int());
+  Expr idx = Add::make(Mul::make(Sub::make(wordVar, getFirstWord()), 32ll),
+                       bit);
+  return VarAssign::make(getIdxVar(), idx, true);
+}
+
+Stmt BitmapIterator::initMergeVars() const {
+  return Block::make({VarAssign::make(wordVar, Sub::make(getFirstWord(), 1ll),
+                                      true),
+                      VarAssign::make(bitsVar, 0ull, true),
+                      skipEmptyWords()});
+}
+
+Stmt BitmapIterator::advance(Expr cond) const {
+  Stmt clearBit = VarAssign::make(bitsVar,
+      BitAnd::make(bitsVar, Sub::make(bitsVar, 1ull)));
+  Stmt next = Block::make({VarAssign::make(ptrVar, Add::make(ptrVar, 1ll)),
+                           clearBit, skipEmptyWords()});
+  const Literal* always = cond.as<Literal>();
+  return (always != nullptr && always->bool_value)
+         ? next : IfThenElse::make(cond, next);
+}
+
+Stmt BitmapIterator::makeLoop(Stmt body, LoopKind kind) const {
+  // Every word starts at the rank of its first bit, and its coordinates are
+  // extracted by clearing its lowest bit after each position
+  Stmt clearBit = VarAssign::make(bitsVar,
+      BitAnd::make(bitsVar, Sub::make(bitsVar, 1ull)));
+  Stmt bitLoop = While::make(Neq::make(bitsVar, 0ull),
+      Block::make({body, VarAssign::make(ptrVar, Add::make(ptrVar, 1ll)),
+                   clearBit}));
+  Expr firstWord = getFirstWord();
+  return For::make(wordVar, firstWord, Add::make(firstWord, numWords), 1ll,
+                   Block::make({
+                       VarAssign::make(ptrVar, Load::make(getRankArr(), wordVar),
+                                       true),
+                       VarAssign::make(bitsVar,
+                                       Cast::make(Load::make(getBitsArr(),
+                                                             wordVar), UInt32),
+                                       true),
+                       bitLoop}),
+                   kind);
+}
+
+Expr BitmapIterator::locate(Expr idx, bool insert) const {
+  taco_iassert(!insert);
+  return Call::make("taco_bitmap_locate",
+                    {getBitsArr(), getRankArr(), getFirstWord(), idx}, Int());
+}
+
+ir::Stmt BitmapIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt BitmapIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Expr BitmapIterator::getBitsArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_bits";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Expr BitmapIterator::getRankArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_rank";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 2, name);
+}
+
+ir::Expr BitmapIterator::getFirstWord() const {
+  return Mul::make(getParent().getPtrVar(), numWords);
+}
+
+ir::Stmt BitmapIterator::skipEmptyWords() const {
+  Expr lastWord = Sub::make(Add::make(getFirstWord(), numWords), 1ll);
+  Expr cond = And::make(Eq::make(bitsVar, 0ull),
+                        Lt::make(wordVar, lastWord));
+  return While::make(cond, Block::make({
+      VarAssign::make(wordVar, Add::make(wordVar, 1ll)),
+      VarAssign::make(bitsVar, Cast::make(Load::make(getBitsArr(), wordVar),
+                                          UInt32))}));
+}
+
+}}
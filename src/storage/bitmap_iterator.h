@@ -0,0 +1,75 @@
+#ifndef TACO_STORAGE_BITMAP_H
+#define TACO_STORAGE_BITMAP_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over a bitmap level, which stores one bit per coordinate of each
+/// segment to mark the coordinates that are present, and the number of set
+/// bits before each word of the bitmaps. The values of a bitmap level are
+/// packed, so the position of a coordinate is its rank among the set bits.
+/// The iterator keeps the word of its position and the bits of that word
+/// that are left, and derives each coordinate from the lowest of those bits.
+/// Coordinates are located by testing their bit.
+class BitmapIterator : public IteratorImpl {
+public:
+  BitmapIterator(std::string name, const ir::Expr& tensor, int level,
+                 size_t dimension, Iterator previous);
+  virtual ~BitmapIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+  bool isLocatable() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt initMergeVars() const;
+  ir::Stmt advance(ir::Expr cond) const;
+  ir::Stmt makeLoop(ir::Stmt body, ir::LoopKind kind) const;
+
+  ir::Expr locate(ir::Expr idx, bool insert) const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+  ir::Expr numWords;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+  ir::Expr wordVar;
+  ir::Expr bitsVar;
+
+  ir::Expr getBitsArr() const;
+  ir::Expr getRankArr() const;
+
+  /// Returns the first word of the bitmap of the parent's segment.
+  ir::Expr getFirstWord() const;
+
+  /// Returns a statement that moves to the next word with bits left, if the
+  /// current word has none.
+  ir::Stmt skipEmptyWords() const;
+};
+
+}}
+#endif
@@ -0,0 +1,339 @@
+#include "taco/storage/convert.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/storage/array_util.h"
+#include "taco/storage/pack.h"
+#include "taco/util/parallel.h"
+#include "index_array.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+/// The smallest number of components worth handing to a separate thread.
+static const size_t MIN_CHUNK_SIZE = (1 << 16);
+
+/// The stored components of a storage in the lexicographic order of its
+/// levels: one coordinate vector per level, and the positions of the
+/// components in the value array.
+struct Components {
+  vector<vector<int>> coordinates;
+  vector<size_t>      positions;
+};
+
+/// Unpack the components of the segment at `parentPos` of a level and the
+/// levels below it. This must match the const_iterator of Tensor.
+static void unpackLevel(const Storage& storage, const vector<int>& dimensions,
+                        size_t level, size_t parentPos, vector<int>* coordinate,
+                        Components* components) {
+  const size_t order = dimensions.size();
+  const ModeIndex modeIndex = storage.getIndex().getModeIndex(level);
+  auto visit = [&](size_t pos, long long coord) {
+    (*coordinate)[level] = (int)coord;
+    if (level + 1 < order) {
+      unpackLevel(storage, dimensions, level + 1, pos, coordinate, components);
+      return;
+    }
+    for (size_t l = 0; l < order; l++) {
+      components->coordinates[l].push_back((*coordinate)[l]);
+    }
+    components->positions.push_back(pos);
+  };
+
+  switch (storage.getFormat().getModeTypes()[level]) {
+    case Dense: {
+      const size_t size = dimensions[level];
+      for (size_t j = 0; j < size; j++) {
+        visit(parentPos * size + j, j);
+      }
+      break;
+    }
+    case Sparse: {
+      IndexArrayReader pos(modeIndex.getIndexArray(0));
+      IndexArrayReader idx(modeIndex.getIndexArray(1));
+      for (long long p = pos[parentPos]; p < pos[parentPos + 1]; p++) {
+        visit(p, idx[p]);
+      }
+      break;
+    }
+    case Singleton: {
+      IndexArrayReader idx(modeIndex.getIndexArray(0));
+      visit(parentPos, idx[parentPos]);
+      break;
+    }
+    case Fixed: {
+      // Segments are padded by repeating their last coordinate
+      IndexArrayReader idx(modeIndex.getIndexArray(1));
+      const size_t size = IndexArrayReader(modeIndex.getIndexArray(0))[0];
+      for (size_t p = parentPos * size; p < (parentPos + 1) * size; p++) {
+        if (p > parentPos * size && idx[p] <= idx[p-1]) {
+          break;
+        }
+        visit(p, idx[p]);
+      }
+      break;
+    }
+    case Bitmap: {
+      const size_t numWords = (dimensions[level] + 31) / 32;
+      const uint32_t* bits = (const uint32_t*)modeIndex.getIndexArray(1).getData();
+      const int32_t* rank = (const int32_t*)modeIndex.getIndexArray(2).getData();
+      for (size_t w = parentPos * numWords; w < (parentPos + 1) * numWords; w++) {
+        for (uint32_t word = bits[w]; word != 0; word &= word - 1) {
+          const int bit = __builtin_ctz(word);
+          const size_t pos = rank[w] + __builtin_popcount(bits[w] & ((1u << bit) - 1));
+          visit(pos, (w - parentPos * numWords) * 32 + bit);
+        }
+      }
+      break;
+    }
+    case Diagonal: {
+      // The values of a diagonal are strided by the number of rows
+      const size_t numRows = dimensions[level - 1];
+      const long long numCols = dimensions[level];
+      const size_t numDiagonals = IndexArrayReader(modeIndex.getIndexArray(0))[0];
+      IndexArrayReader offsets(modeIndex.getIndexArray(1));
+      for (size_t d = 0; d < numDiagonals; d++) {
+        const long long j = (long long)parentPos + offsets[d];
+        if (j >= 0 && j < numCols) {
+          visit(d * numRows + parentPos, j);
+        }
+      }
+      break;
+    }
+    case Packed: {
+      // This must match taco_packed_coordinate in the prelude
+      IndexArrayReader pos(modeIndex.getIndexArray(0));
+      const int32_t* seg = (const int32_t*)modeIndex.getIndexArray(1).getData() +
+                           3 * parentPos;
+      const uint32_t* bits = (const uint32_t*)modeIndex.getIndexArray(2).getData();
+      for (long long p = pos[parentPos]; p < pos[parentPos + 1]; p++) {
+        const uint64_t bit = (uint64_t)(p - pos[parentPos]) * seg[1];
+        const uint32_t* word = bits + seg[2] + (bit >> 5);
+        const uint64_t w = (uint64_t)word[0] | ((uint64_t)word[1] << 32);
+        visit(p, seg[0] + (long long)((w >> (bit & 31)) & ((1ull << seg[1]) - 1)));
+      }
+      break;
+    }
+    case Hashed: {
+      taco_ierror << "Hashed modes are unpacked through sparse modes";
+      break;
+    }
+  }
+}
+
+/// Stably sort `permutation` by the keys of the components it lists. Every
+/// thread counts the keys of a chunk, and a prefix sum over the keys and then
+/// the chunks gives each thread the positions of its components.
+static vector<size_t> countingSort(const vector<size_t>& permutation,
+                                   const vector<int>& keys, size_t numKeys) {
+  const size_t n = permutation.size();
+
+  // Every thread needs its own histogram, so wide levels use fewer threads
+  const size_t numThreads =
+      util::getNumThreads(n, max(numKeys, MIN_CHUNK_SIZE));
+  vector<vector<size_t>> offsets(numThreads, vector<size_t>(numKeys, 0));
+  util::parallelChunks(n, numThreads, [&](size_t t, size_t begin, size_t end) {
+    vector<size_t>& histogram = offsets[t];
+    for (size_t k = begin; k < end; k++) {
+      histogram[keys[permutation[k]]]++;
+    }
+  });
+
+  size_t offset = 0;
+  for (size_t key = 0; key < numKeys; key++) {
+    for (size_t t = 0; t < numThreads; t++) {
+      size_t count = offsets[t][key];
+      offsets[t][key] = offset;
+      offset += count;
+    }
+  }
+
+  vector<size_t> sorted(n);
+  util::parallelChunks(n, numThreads, [&](size_t t, size_t begin, size_t end) {
+    vector<size_t>& next = offsets[t];
+    for (size_t k = begin; k < end; k++) {
+      sorted[next[keys[permutation[k]]]++] = permutation[k];
+    }
+  });
+  return sorted;
+}
+
+template <typename T>
+static void gatherCoordinates(const vector<int>& coordinates,
+                              const vector<size_t>& permutation, char* data) {
+  T* gathered = (T*)data;
+  util::parallelChunks(permutation.size(),
+                       util::getNumThreads(permutation.size(), MIN_CHUNK_SIZE),
+                       [&](size_t t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      gathered[k] = (T)coordinates[permutation[k]];
+    }
+  });
+}
+
+/// Gather the coordinates of the sorted components into `gathered`.
+static void gatherCoordinates(const vector<int>& coordinates,
+                              const vector<size_t>& permutation,
+                              TypedIndexVector* gathered) {
+  switch (gathered->getType().getKind()) {
+    case DataType::UInt8:
+      gatherCoordinates<uint8_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::UInt16:
+      gatherCoordinates<uint16_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::UInt32:
+      gatherCoordinates<uint32_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::UInt64:
+      gatherCoordinates<uint64_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::Int8:
+      gatherCoordinates<int8_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::Int16:
+      gatherCoordinates<int16_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::Int32:
+      gatherCoordinates<int32_t>(coordinates, permutation, gathered->data());
+      break;
+    case DataType::Int64:
+      gatherCoordinates<int64_t>(coordinates, permutation, gathered->data());
+      break;
+    default:
+      taco_ierror << "Index arrays must have integer types";
+      break;
+  }
+}
+
+Storage convert(const Storage& storage, const std::vector<int>& dimensions,
+                const std::vector<int>& modeOrdering, const Format& format) {
+  const size_t order = dimensions.size();
+  const DataType type = storage.getValues().getType();
+  const size_t numBytes = type.getNumBytes();
+  taco_iassert(storage.getFormat().getOrder() == order);
+  taco_iassert(format.getOrder() == order && modeOrdering.size() == order);
+
+  if (order == 0) {
+    Array values = makeArray(type, 1);
+    memcpy(values.getData(), storage.getValues().getData(), numBytes);
+    Storage result(format);
+    result.setValues(values);
+    return result;
+  }
+
+  // The segments of hashed modes are not sorted
+  const Storage source = isHashed(storage.getFormat())
+                         ? sortHashedModes(storage) : storage;
+
+  // Find the source level that each level of `format` is stored in
+  const Format& sourceFormat = source.getFormat();
+  vector<int> sourceDimensions(order);
+  vector<size_t> sourceLevelOfMode(order);
+  for (size_t l = 0; l < order; l++) {
+    const size_t mode = sourceFormat.getModeOrdering()[l];
+    sourceDimensions[l] = dimensions[mode];
+    sourceLevelOfMode[mode] = l;
+  }
+  vector<size_t> sourceLevels(order);
+  vector<int> levelDimensions(order);
+  for (size_t l = 0; l < order; l++) {
+    sourceLevels[l] = sourceLevelOfMode[modeOrdering[format.getModeOrdering()[l]]];
+    levelDimensions[l] = sourceDimensions[sourceLevels[l]];
+  }
+
+  Components components;
+  components.coordinates.resize(order);
+  for (auto& coordinates : components.coordinates) {
+    coordinates.reserve(source.getValues().getSize());
+  }
+  components.positions.reserve(source.getValues().getSize());
+  vector<int> coordinate(order);
+  unpackLevel(source, sourceDimensions, 0, 0, &coordinate, &components);
+  const size_t numComponents = components.positions.size();
+
+  // The components are sorted by the source levels, so the levels after the
+  // first `numPasses` levels of `format` are already in order once those are
+  size_t numPasses = 0;
+  for (; numPasses < order; numPasses++) {
+    vector<size_t> remainingLevels;
+    for (size_t l = 0; l < order; l++) {
+      if (find(sourceLevels.begin(), sourceLevels.begin() + numPasses, l) ==
+          sourceLevels.begin() + numPasses) {
+        remainingLevels.push_back(l);
+      }
+    }
+    if (equal(remainingLevels.begin(), remainingLevels.end(),
+              sourceLevels.begin() + numPasses)) {
+      break;
+    }
+  }
+
+  vector<size_t> permutation(numComponents);
+  iota(permutation.begin(), permutation.end(), 0);
+  for (size_t l = numPasses; l-- > 0;) {
+    permutation = countingSort(permutation,
+                               components.coordinates[sourceLevels[l]],
+                               levelDimensions[l]);
+  }
+
+  // The components are in the order of the levels of `format`, so formats
+  // that packEntries handles are packed from entries gathered in that order,
+  // whose arrays are allocated at their final sizes
+  const char* sourceValues = (const char*)source.getValues().getData();
+  const size_t numThreads = util::getNumThreads(numComponents, MIN_CHUNK_SIZE);
+  if (canPackEntries(format)) {
+    const size_t entrySize = order * sizeof(int) + numBytes;
+    vector<char> entries(numComponents * entrySize);
+    util::parallelChunks(numComponents, numThreads,
+                         [&](size_t t, size_t begin, size_t end) {
+      for (size_t k = begin; k < end; k++) {
+        char* entry = &entries[k * entrySize];
+        int* coords = (int*)entry;
+        for (size_t l = 0; l < order; l++) {
+          coords[l] = components.coordinates[sourceLevels[l]][permutation[k]];
+        }
+        memcpy(coords + order,
+               &sourceValues[components.positions[permutation[k]] * numBytes],
+               numBytes);
+      }
+    });
+    components = Components();
+    return packEntries(levelDimensions, format, entries.data(), numComponents,
+                       entrySize, type, 0);
+  }
+
+  vector<TypedIndexVector> coordinates(order);
+  for (size_t l = 0; l < order; l++) {
+    coordinates[l] = TypedIndexVector(format.getCoordinateTypeIdx(l),
+                                      numComponents);
+    gatherCoordinates(components.coordinates[sourceLevels[l]], permutation,
+                      &coordinates[l]);
+  }
+  components.coordinates.clear();
+
+  vector<char> values(numComponents * numBytes);
+  util::parallelChunks(numComponents, numThreads,
+                       [&](size_t t, size_t begin, size_t end) {
+    for (size_t k = begin; k < end; k++) {
+      memcpy(&values[k * numBytes],
+             &sourceValues[components.positions[permutation[k]] * numBytes],
+             numBytes);
+    }
+  });
+
+  return pack(levelDimensions, format, coordinates, values.data(),
+              numComponents, type);
+}
+
+}}
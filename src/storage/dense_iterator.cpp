@@ -13,9 +13,15 @@ DenseIterator::DenseIterator(std::string name, const Expr& tensor, int level,
   this->tensor = tensor;
   this->level = level;
 
+  // Dense levels below a level with 64-bit positions need 64-bit positions
   std::string indexVarName = name + util::toString(tensor);
+  DataType ptrType = Int();
+  if (isa<Var>(previous.getPtrVar()) &&
+      previous.getPtrVar().type().getNumBits() > ptrType.getNumBits()) {
+    ptrType = previous.getPtrVar().type();
+  }
   ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
-                     Int());
+                     ptrType);
   idxVar = Var::make(indexVarName, Int());
 
   this->dimension = (long long)dimension;
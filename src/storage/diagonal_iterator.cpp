@@ -0,0 +1,105 @@
+#include "diagonal_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+DiagonalIterator::DiagonalIterator(std::string name, const Expr& tensor,
+                                   int level, size_t dimension,
+                                   Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+  this->numColumns = (long long)dimension;
+
+  std::string idxVarName = name + util::toString(tensor);
+  diagonalVar = Var::make("d" + util::toString(tensor) +
+                          std::to_string(level + 1), Int());
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     Int());
+  idxVar = Var::make(idxVarName, Int());
+}
+
+bool DiagonalIterator::isDense() const {
+  return false;
+}
+
+bool DiagonalIterator::isFixedRange() const {
+  return false;
+}
+
+bool DiagonalIterator::isRandomAccess() const {
+  return false;
+}
+
+bool DiagonalIterator::isSequentialAccess() const {
+  return true;
+}
+
+Expr DiagonalIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr DiagonalIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr DiagonalIterator::getIteratorVar() const {
+  return diagonalVar;
+}
+
+Expr DiagonalIterator::begin() const {
+  return Call::make("taco_diagonal_begin",
+                    {getOffsetsArr(), getNumDiagonals(),
+                     getParent().getPtrVar()}, Int());
+}
+
+Expr DiagonalIterator::end() const {
+  return Call::make("taco_diagonal_end",
+                    {getOffsetsArr(), getNumDiagonals(),
+                     getParent().getPtrVar(), numColumns}, Int());
+}
+
+Stmt DiagonalIterator::initDerivedVars() const {
+  Expr ptrVal = Add::make(Mul::make(diagonalVar, getParent().end()),
+                          getParent().getPtrVar());
+  Expr idxVal = Add::make(getParent().getPtrVar(),
+                          Load::make(getOffsetsArr(), diagonalVar));
+  return Block::make({VarAssign::make(getPtrVar(), ptrVal, true),
+                      VarAssign::make(getIdxVar(), idxVal, true)});
+}
+
+ir::Stmt DiagonalIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt DiagonalIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Expr DiagonalIterator::getNumDiagonals() const {
+  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+}
+
+ir::Expr DiagonalIterator::getOffsetsArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_offsets";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+}}
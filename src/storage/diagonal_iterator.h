@@ -0,0 +1,60 @@
+#ifndef TACO_STORAGE_DIAGONAL_H
+#define TACO_STORAGE_DIAGONAL_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over a diagonal level, which stores the sorted offsets of the
+/// non-empty diagonals of a matrix (e.g. the second level of DIA). The values
+/// of each diagonal are contiguous, so the position of the coordinate on
+/// diagonal d of row i is d * rows + i. The iterator visits the diagonals that
+/// intersect the row of its parent, which must be the dense first level so
+/// that the positions of the parent are the rows.
+class DiagonalIterator : public IteratorImpl {
+public:
+  DiagonalIterator(std::string name, const ir::Expr& tensor, int level,
+                   size_t dimension, Iterator previous);
+  virtual ~DiagonalIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+  ir::Expr numColumns;
+
+  ir::Expr diagonalVar;
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+
+  ir::Expr getNumDiagonals() const;
+  ir::Expr getOffsetsArr() const;
+};
+
+}}
+#endif
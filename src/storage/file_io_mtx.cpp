@@ -5,33 +5,26 @@
 #include <sstream>
 #include <cstdlib>
 #include <climits>
+#include <cstring>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/storage/pack.h"
+#include "taco/storage/storage.h"
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/files.h"
+#include "text_parser.h"
+#include "text_writer.h"
 
 using namespace std;
 
 namespace taco {
 
-TensorBase readMTX(std::string filename, const Format& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readMTX(file, format, pack);
-  file.close();
-  return tensor;
-}
-
-TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
-  string line;
-  if (!std::getline(stream, line)) {
-    return TensorBase();
-  }
-
-  // Read Header
+/// Check the MatrixMarket banner and return its storage format, coordinate or
+/// array, and whether it is symmetric.
+static string readBanner(const string& line, bool* symm) {
   std::stringstream lineStream(line);
   string head, type, formats, field, symmetry;
   lineStream >> head >> type >> formats >> field >> symmetry;
@@ -45,8 +38,138 @@ TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
   // symmetry = [general symmetric skew-symmetric Hermitian]
   taco_uassert((symmetry=="general") || (symmetry=="symmetric"))
                                        << "MatrixMarket symmetry not available";
+  *symm = (symmetry=="symmetric");
+  return formats;
+}
+
+/// Read the numbers of a size line: the dimensions, followed by the number of
+/// nonzeros of coordinate files, which may exceed INT_MAX.
+static vector<size_t> readSizes(const string& line) {
+  vector<size_t> sizes;
+  char* linePtr = (char*)line.data();
+  while (size_t field = strtoull(linePtr, &linePtr, 10)) {
+    sizes.push_back(field);
+  }
+  return sizes;
+}
 
-  bool symm = (symmetry=="symmetric");
+static vector<int> toDimensions(const vector<size_t>& sizes) {
+  vector<int> dimensions;
+  for (size_t dimension : sizes) {
+    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
+    dimensions.push_back(static_cast<int>(dimension));
+  }
+  return dimensions;
+}
+
+TensorBase readMTX(std::string filename, const Format& format, bool pack) {
+  // The header is read from the first block of the file
+  storage::FileContents file(filename);
+  const char* end = file.end();
+  if (file.begin() == end) {
+    return TensorBase();
+  }
+  const char* line = storage::nextLine(file.begin(), end);
+  bool symm;
+  if (readBanner(string(file.begin(), line), &symm) != "coordinate") {
+    util::FileStream stream(filename, fstream::in);
+    TensorBase tensor = readMTX(stream, format, pack);
+    stream.close();
+    return tensor;
+  }
+
+  // Skip comments at the top of the file
+  auto isComment = [&](const char* pos) {
+    while (pos < end && (*pos == ' ' || *pos == '\t')) {
+      pos++;
+    }
+    return pos == end || *pos == '%' || *pos == '\n' || *pos == '\r';
+  };
+  while (line < end && isComment(line)) {
+    line = storage::nextLine(line, end);
+  }
+  const char* body = storage::nextLine(line, end);
+  const size_t bodyOffset = body - file.begin();
+  vector<size_t> sizes = readSizes(string(line, body));
+  taco_uassert(sizes.size() >= 2) << "MatrixMarket size line not available";
+  size_t nnz = sizes.back();
+  sizes.pop_back();
+  vector<int> dimensions = toDimensions(sizes);
+  if (symm)
+    taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
+
+  // Files that are sorted in the order of the levels of the format, which is
+  // detected as they are read, are built straight into the arrays of the
+  // format in one pass. Other files are read again from the first block.
+  TensorBase tensor(type<double>(), dimensions, format);
+  if (pack && !symm && storage::canBuildStorage(tensor.getFormat())) {
+    vector<size_t> modeOrdering = tensor.getFormat().getModeOrdering();
+    vector<int> levelDimensions;
+    for (size_t mode : modeOrdering) {
+      levelDimensions.push_back(dimensions[mode]);
+    }
+    storage::StorageBuilder builder(levelDimensions, tensor.getFormat(),
+                                    type<double>());
+    builder.reserve(nnz);
+    bool sorted = true;
+    for (const char* begin = body; sorted && begin != nullptr;
+         begin = file.next() ? file.begin() : nullptr) {
+      sorted = storage::parseSortedEntries(begin, file.end(), modeOrdering,
+                                           &builder);
+    }
+    if (sorted) {
+      storage::Storage built = builder.getStorage();
+      storage::Storage storage = tensor.getStorage();
+      storage.setIndex(built.getIndex());
+      storage.setValues(built.getValues());
+      return tensor;
+    }
+    file.rewind();
+    body = file.begin() + bodyOffset;
+  }
+
+  // Parse the entries straight into a coordinate buffer sized by the header,
+  // a block of the file at a time
+  const size_t order = dimensions.size();
+  const size_t entrySize = order * sizeof(int) + sizeof(double);
+  vector<char> entries;
+  entries.reserve((symm ? 2 : 1) * nnz * entrySize);
+  for (const char* begin = body; begin != nullptr;
+       begin = file.next() ? file.begin() : nullptr) {
+    storage::parseEntries(begin, file.end(), order, &entries);
+  }
+  if (symm) {
+    const size_t numEntries = entries.size() / entrySize;
+    for (size_t i = 0; i < numEntries; i++) {
+      const int* coord = (const int*)&entries[i * entrySize];
+      if (coord[0] != coord[1]) {
+        int mirrored[2] = {coord[1], coord[0]};
+        size_t size = entries.size();
+        entries.resize(size + entrySize);
+        memcpy(&entries[size], mirrored, sizeof(mirrored));
+        memcpy(&entries[size + sizeof(mirrored)],
+               &entries[i * entrySize + sizeof(mirrored)], sizeof(double));
+      }
+    }
+  }
+
+  taco_iassert(tensor.getEntrySize() == entrySize);
+  tensor.insertEntries(std::move(entries));
+  if (pack) {
+    tensor.pack();
+  }
+  return tensor;
+}
+
+TensorBase readMTX(std::istream& stream, const Format& format, bool pack) {
+  string line;
+  if (!std::getline(stream, line)) {
+    return TensorBase();
+  }
+
+  // Read Header
+  bool symm;
+  string formats = readBanner(line, &symm);
 
   TensorBase tensor;
   if (formats=="coordinate")
@@ -77,15 +200,12 @@ TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
     }
   } while (std::getline(stream, line));
 
-  // The first non-comment line is the header with dimensions
-  vector<int> dimensions;
-  char* linePtr = (char*)line.data();
-  while (size_t dimension = strtoul(linePtr, &linePtr, 10)) {
-    taco_uassert(dimension <= INT_MAX) << "Dimension exceeds INT_MAX";
-    dimensions.push_back(static_cast<int>(dimension));
-  }
-  size_t nnz = dimensions[dimensions.size()-1];
-  dimensions.pop_back();
+  // The first non-comment line is the header with dimensions, followed by
+  // the number of nonzeros
+  vector<size_t> header = readSizes(line);
+  size_t nnz = header.back();
+  header.pop_back();
+  vector<int> dimensions = toDimensions(header);
   if (symm)
     taco_uassert(dimensions.size()==2) << "Symmetry only available for matrix";
 
@@ -95,7 +215,7 @@ TensorBase readSparse(std::istream& stream, const Format& format, bool symm) {
   values.reserve(nnz);
 
   while (std::getline(stream, line)) {
-    linePtr = (char*)line.data();
+    char* linePtr = (char*)line.data();
     for (size_t i=0; i < dimensions.size(); i++) {
       long index = strtol(linePtr, &linePtr, 10);
       taco_uassert(index <= INT_MAX) << "Index exceeds INT_MAX";
@@ -192,8 +312,7 @@ TensorBase readDense(std::istream& stream, const Format& format, bool symm) {
 }
 
 void writeMTX(std::string filename, const TensorBase& tensor) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::out);
+  util::FileStream file(filename, fstream::out);
   writeMTX(file, tensor);
   file.close();
 }
@@ -213,12 +332,7 @@ void writeSparse(std::ostream& stream, const TensorBase& tensor) {
   stream << "%"                                             << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " ";
   stream << tensor.getStorage().getIndex().getSize() << endl;
-  for (auto& value : iterate<double>(tensor)) {
-    for (size_t coord : value.first) {
-      stream << coord+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+  storage::writeComponents(stream, tensor, true);
 }
 
 void writeDense(std::ostream& stream, const TensorBase& tensor) {
@@ -228,9 +342,7 @@ void writeDense(std::ostream& stream, const TensorBase& tensor) {
     stream << "%%MatrixMarket tensor array real general" << std::endl;
   stream << "%"                                        << std::endl;
   stream << util::join(tensor.getDimensions(), " ") << " " << endl;
-  for (auto& value : iterate<double>(tensor)) {
-    stream << value.second << endl;
-  }
+  storage::writeComponents(stream, tensor, false);
 }
 
 }
@@ -14,6 +14,7 @@
 #include "taco/storage/array_util.h"
 #include "taco/util/files.h"
 #include "taco/util/collections.h"
+#include "text_writer.h"
 
 using namespace std;
 
@@ -229,13 +230,19 @@ void readIndices(std::istream &hbfile, int linesize, int indices[]){
 
 void writeIndices(std::ostream &hbfile, int indsize,
                   int indperline, int indices[]){
+  storage::TextBuffer text((int)hbfile.precision());
   for (auto i = 1; i <= indsize; i++) {
-    hbfile << indices[i-1] + 1 << " ";
-    if (i%indperline==0)
-      hbfile << "\n";
+    text.append((long long)indices[i-1] + 1);
+    text.append(' ');
+    if (i%indperline==0) {
+      text.append('\n');
+      if (text.size() >= (1 << 20))
+        text.flush(hbfile);
+    }
   }
   if (indsize%indperline != 0)
-    hbfile << "\n";
+    text.append('\n');
+  text.flush(hbfile);
 }
 
 void readValues(std::istream &hbfile, int linesize, double values[]){
@@ -254,16 +261,22 @@ void readValues(std::istream &hbfile, int linesize, double values[]){
 
 void writeValues(std::ostream &hbfile, int valuesize,
                  int valperline, double values[]){
+  storage::TextBuffer text((int)hbfile.precision());
   for (auto i = 1; i <= valuesize; i++) {
+    text.append(values[i-1]);
     if (std::floor(values[i-1]) == values[i-1])
-      hbfile << values[i-1] << ".0 ";
+      text.append(".0 ", 3);
     else
-      hbfile << values[i-1] << " ";
-    if (i%valperline==0)
-      hbfile << "\n";
+      text.append(' ');
+    if (i%valperline==0) {
+      text.append('\n');
+      if (text.size() >= (1 << 20))
+        text.flush(hbfile);
+    }
   }
   if (valuesize%valperline != 0)
-    hbfile << "\n";
+    text.append('\n');
+  text.flush(hbfile);
 }
 
 // Useless for Taco
@@ -271,8 +284,7 @@ void readRHS(){  }
 void writeRHS(){  }
 
 TensorBase readRB(std::string filename, const Format& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
+  util::FileStream file(filename, fstream::in);
   TensorBase tensor = readRB(file, format, pack);
   file.close();
 
@@ -312,8 +324,7 @@ void writeRB(std::string filename, const TensorBase& tensor) {
       "The .rb format only supports matrices. Consider using the .tns format "
       "instead";
 
-  std::fstream file;
-  util::openStream(file, filename, fstream::out);
+  util::FileStream file(filename, fstream::out);
   writeRB(file, tensor);
   file.close();
 }
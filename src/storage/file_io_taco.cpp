@@ -0,0 +1,345 @@
+#include "taco/storage/file_io_taco.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/storage/array_util.h"
+#include "taco/util/files.h"
+
+using namespace std;
+using namespace taco::storage;
+
+namespace taco {
+
+static const char   MAGIC[8]       = {'T','A','C','O','B','I','N','\0'};
+static const size_t VERSION        = 1;
+static const size_t FILE_ALIGNMENT = 4096;
+
+/// The largest number of index arrays of a level, which hashed levels have.
+static const size_t MAX_LEVEL_ARRAYS = 3;
+
+static size_t alignOffset(size_t offset) {
+  return (offset + FILE_ALIGNMENT - 1) / FILE_ALIGNMENT * FILE_ALIGNMENT;
+}
+
+/// The type, size and file offset of an array.
+struct ArrayInfo {
+  DataType type;
+  size_t   size;
+  size_t   offset;
+};
+
+/// The header of a tensor file.
+struct Header {
+  DataType          ctype;
+  vector<int>       dimensions;
+  Format            format;
+  vector<vector<ArrayInfo>> indexArrays;
+  ArrayInfo         values;
+  size_t            size;
+};
+
+/// Reads the words of a header from a stream.
+class HeaderReader {
+public:
+  HeaderReader(istream& stream) : stream(stream), offset(0) {}
+
+  uint64_t next() {
+    uint64_t word = 0;
+    stream.read((char*)&word, sizeof(word));
+    taco_uassert(stream.good()) << "The binary tensor file is truncated";
+    offset += sizeof(word);
+    return word;
+  }
+
+  /// Returns the next word, which must be at most `max`.
+  uint64_t next(uint64_t max) {
+    uint64_t word = next();
+    taco_uassert(word <= max) << "The binary tensor file is corrupt";
+    return word;
+  }
+
+  DataType nextType() {
+    return DataType((DataType::Kind)next(DataType::Complex128));
+  }
+
+  ModeType nextModeType() {
+    return (ModeType)next(Packed);
+  }
+
+  ArrayInfo nextArray() {
+    ArrayInfo info;
+    info.type = nextType();
+    info.size = next(SIZE_MAX / info.type.getNumBytes());
+    info.offset = next();
+    return info;
+  }
+
+  size_t getOffset() const {
+    return offset;
+  }
+
+private:
+  istream& stream;
+  size_t   offset;
+};
+
+static Header readHeader(istream& stream) {
+  char magic[sizeof(MAGIC)];
+  stream.read(magic, sizeof(MAGIC));
+  taco_uassert(stream.good() && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0)
+      << "The file is not a binary tensor file";
+
+  HeaderReader reader(stream);
+  taco_uassert(reader.next() == VERSION)
+      << "The binary tensor file has an unsupported version";
+  Header header;
+  // Every word is checked before it sizes a vector or becomes an enum, so a
+  // corrupt header is reported rather than read out of bounds
+  const size_t order = reader.next(INT_MAX);
+  header.ctype = reader.nextType();
+  for (size_t i = 0; i < order; i++) {
+    header.dimensions.push_back((int)reader.next(INT_MAX));
+  }
+  vector<ModeType> modeTypes;
+  for (size_t i = 0; i < order; i++) {
+    modeTypes.push_back(reader.nextModeType());
+  }
+  vector<size_t> modeOrdering;
+  vector<bool> isOrdered(order, false);
+  for (size_t i = 0; i < order; i++) {
+    modeOrdering.push_back(reader.next(order - 1));
+    taco_uassert(!isOrdered[modeOrdering.back()])
+        << "The binary tensor file is corrupt";
+    isOrdered[modeOrdering.back()] = true;
+  }
+  header.format = Format(modeTypes, modeOrdering);
+  const size_t numLevelArrayTypes = reader.next(order);
+  taco_uassert(numLevelArrayTypes == 0 || numLevelArrayTypes == order)
+      << "The binary tensor file is corrupt";
+  vector<vector<DataType>> levelArrayTypes(numLevelArrayTypes);
+  for (auto& types : levelArrayTypes) {
+    types.resize(reader.next(MAX_LEVEL_ARRAYS));
+    for (auto& type : types) {
+      type = reader.nextType();
+    }
+  }
+  header.format.setLevelArrayTypes(levelArrayTypes);
+
+  header.indexArrays.resize(order);
+  for (auto& arrays : header.indexArrays) {
+    arrays.resize(reader.next(MAX_LEVEL_ARRAYS));
+    for (auto& array : arrays) {
+      array = reader.nextArray();
+    }
+  }
+  header.values = reader.nextArray();
+  header.size = sizeof(MAGIC) + reader.getOffset();
+  return header;
+}
+
+/// Returns the tensor of the header and arrays, converted to `format` if it
+/// is a different format of the same order.
+static TensorBase makeTensor(const Header& header,
+                             const vector<ModeIndex>& modeIndices,
+                             const Array& values, const Format& format) {
+  TensorBase tensor(header.ctype, header.dimensions, header.format);
+  Storage storage = tensor.getStorage();
+  storage.setIndex(Index(header.format, modeIndices));
+  storage.setValues(values);
+  if (format.getOrder() != header.format.getOrder() ||
+      format == header.format) {
+    return tensor;
+  }
+
+  TensorBase converted(header.ctype, header.dimensions, format);
+  vector<int> modeOrdering(header.dimensions.size());
+  for (size_t i = 0; i < modeOrdering.size(); i++) {
+    modeOrdering[i] = (int)i;
+  }
+  converted.pack(tensor, modeOrdering);
+  return converted;
+}
+
+/// Returns true if the array lies within a file of `fileSize` bytes.
+static bool isInFile(const ArrayInfo& info, size_t fileSize) {
+  const size_t numBytes = info.size * info.type.getNumBytes();
+  return numBytes == 0 ||
+         (info.offset <= fileSize && numBytes <= fileSize - info.offset);
+}
+
+/// Map an array from the file, or read it if it is not at a page boundary.
+static Array mapArray(int fd, const ArrayInfo& info) {
+  const size_t numBytes = info.size * info.type.getNumBytes();
+  if (numBytes == 0) {
+    return makeArray(info.type, 0);
+  }
+  if (info.offset % sysconf(_SC_PAGESIZE) == 0) {
+    void* data = mmap(nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      fd, info.offset);
+    taco_uassert(data != MAP_FAILED)
+        << "The binary tensor file could not be mapped";
+    return Array(info.type, data, info.size, Array::Unmap);
+  }
+  Array array = makeArray(info.type, info.size);
+  taco_uassert(pread(fd, array.getData(), numBytes, info.offset) ==
+               (ssize_t)numBytes) << "The binary tensor file is truncated";
+  return array;
+}
+
+TensorBase readTaco(std::string filename, const Format& format, bool pack) {
+  util::FileStream file(filename, fstream::in | fstream::binary);
+  if (util::getCompression(filename) != util::Compression::None) {
+    TensorBase tensor = readTaco(file, format, pack);
+    file.close();
+    return tensor;
+  }
+  Header header = readHeader(file);
+  file.close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  taco_uassert(fd >= 0) << "Error opening file: " << filename;
+
+  // Mapped pages past the end of the file fault when they are read, so the
+  // arrays must lie within the file
+  struct stat info;
+  bool inFile = (fstat(fd, &info) == 0) &&
+                isInFile(header.values, info.st_size);
+  for (auto& arrays : header.indexArrays) {
+    for (auto& array : arrays) {
+      inFile = inFile && isInFile(array, info.st_size);
+    }
+  }
+  if (!inFile) {
+    close(fd);
+    taco_uerror << "The binary tensor file is truncated";
+  }
+
+  vector<ModeIndex> modeIndices;
+  for (auto& arrays : header.indexArrays) {
+    vector<Array> indexArrays;
+    for (auto& array : arrays) {
+      indexArrays.push_back(mapArray(fd, array));
+    }
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+  Array values = mapArray(fd, header.values);
+  close(fd);
+  return makeTensor(header, modeIndices, values, format);
+}
+
+TensorBase readTaco(std::istream& stream, const Format& format, bool pack) {
+  Header header = readHeader(stream);
+  size_t offset = header.size;
+  auto readArray = [&](const ArrayInfo& info) {
+    Array array = makeArray(info.type, info.size);
+    const size_t numBytes = info.size * info.type.getNumBytes();
+    if (numBytes > 0) {
+      taco_uassert(info.offset >= offset)
+          << "The arrays of the binary tensor file are out of order";
+      stream.ignore(info.offset - offset);
+      stream.read((char*)array.getData(), numBytes);
+      taco_uassert(stream.good()) << "The binary tensor file is truncated";
+      offset = info.offset + numBytes;
+    }
+    return array;
+  };
+
+  vector<ModeIndex> modeIndices;
+  for (auto& arrays : header.indexArrays) {
+    vector<Array> indexArrays;
+    for (auto& array : arrays) {
+      indexArrays.push_back(readArray(array));
+    }
+    modeIndices.push_back(ModeIndex(indexArrays));
+  }
+  Array values = readArray(header.values);
+  return makeTensor(header, modeIndices, values, format);
+}
+
+void writeTaco(std::string filename, const TensorBase& tensor) {
+  util::FileStream file(filename, fstream::out | fstream::binary);
+  writeTaco(file, tensor);
+  file.close();
+}
+
+void writeTaco(std::ostream& stream, const TensorBase& tensor) {
+  const Storage& storage = tensor.getStorage();
+  const Format& format = storage.getFormat();
+  taco_uassert(storage.getValues().getType().getKind() != DataType::Undefined)
+      << "Only packed tensors can be written to the binary format";
+
+  vector<uint64_t> words = {VERSION, tensor.getOrder(),
+                            (uint64_t)tensor.getComponentType().getKind()};
+  for (int dimension : tensor.getDimensions()) {
+    words.push_back(dimension);
+  }
+  for (ModeType modeType : format.getModeTypes()) {
+    words.push_back(modeType);
+  }
+  for (size_t mode : format.getModeOrdering()) {
+    words.push_back(mode);
+  }
+  words.push_back(format.getLevelArrayTypes().size());
+  for (auto& types : format.getLevelArrayTypes()) {
+    words.push_back(types.size());
+    for (auto& type : types) {
+      words.push_back(type.getKind());
+    }
+  }
+
+  // The offsets of the arrays follow the header, so they are filled in once
+  // the size of the header is known
+  vector<Array> arrays;
+  vector<size_t> offsetWords;
+  auto addArray = [&](const Array& array) {
+    words.push_back(array.getType().getKind());
+    words.push_back(array.getSize());
+    offsetWords.push_back(words.size());
+    words.push_back(0);
+    arrays.push_back(array);
+  };
+  const Index& index = storage.getIndex();
+  for (size_t i = 0; i < tensor.getOrder(); i++) {
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    words.push_back(modeIndex.numIndexArrays());
+    for (size_t j = 0; j < modeIndex.numIndexArrays(); j++) {
+      addArray(modeIndex.getIndexArray(j));
+    }
+  }
+  addArray(storage.getValues());
+
+  size_t offset = alignOffset(sizeof(MAGIC) + words.size() * sizeof(uint64_t));
+  for (size_t i = 0; i < arrays.size(); i++) {
+    words[offsetWords[i]] = offset;
+    offset = alignOffset(offset + arrays[i].getSize() *
+                                  arrays[i].getType().getNumBytes());
+  }
+
+  stream.write(MAGIC, sizeof(MAGIC));
+  stream.write((const char*)words.data(), words.size() * sizeof(uint64_t));
+  offset = sizeof(MAGIC) + words.size() * sizeof(uint64_t);
+  const vector<char> padding(FILE_ALIGNMENT, 0);
+  for (size_t i = 0; i < arrays.size(); i++) {
+    const size_t numBytes = arrays[i].getSize() *
+                            arrays[i].getType().getNumBytes();
+    stream.write(padding.data(), words[offsetWords[i]] - offset);
+    stream.write((const char*)arrays[i].getData(), numBytes);
+    offset = words[offsetWords[i]] + numBytes;
+  }
+}
+
+}
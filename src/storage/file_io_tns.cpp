@@ -13,16 +13,70 @@
 #include "taco/error.h"
 #include "taco/util/strings.h"
 #include "taco/util/files.h"
+#include "text_parser.h"
+#include "text_writer.h"
 
 using namespace std;
 
 namespace taco {
 
 TensorBase readTNS(std::string filename, const Format& format, bool pack) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::in);
-  TensorBase tensor = readTNS(file, format, pack);
-  file.close();
+  storage::FileContents file(filename);
+  if (file.begin() == file.end()) {
+    return TensorBase();
+  }
+
+  // Infer tensor order from the first coordinate
+  auto skipBlanks = [&](const char* p) {
+    while (p < file.end() && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      p++;
+    }
+    return p;
+  };
+  auto isComment = [&](const char* line) {
+    const char* p = skipBlanks(line);
+    return p == file.end() || *p == '\n' || *p == '#' || *p == '%';
+  };
+  const char* line = file.begin();
+  while (line < file.end() && isComment(line)) {
+    line = storage::nextLine(line, file.end());
+    if (line == file.end() && file.next()) {
+      line = file.begin();
+    }
+  }
+  size_t numFields = 0;
+  for (const char* p = line; p < file.end() && *p != '\n';) {
+    p = skipBlanks(p);
+    if (p < file.end() && *p != '\n') {
+      numFields++;
+    }
+    while (p < file.end() && *p != ' ' && *p != '\t' && *p != '\r' &&
+           *p != '\n') {
+      p++;
+    }
+  }
+  taco_uassert(numFields >= 2) << "Unknown format of tns file";
+  size_t order = numFields - 1;
+
+  // Parse the coordinates straight into a coordinate buffer, a block of the
+  // file at a time
+  vector<char> entries;
+  vector<int> dimensions(order, 0);
+  for (const char* begin = line; begin != nullptr;
+       begin = file.next() ? file.begin() : nullptr) {
+    vector<int> blockDimensions =
+        storage::parseEntries(begin, file.end(), order, &entries);
+    for (size_t i = 0; i < order; i++) {
+      dimensions[i] = std::max(dimensions[i], blockDimensions[i]);
+    }
+  }
+
+  TensorBase tensor(type<double>(), dimensions, format);
+  taco_iassert(tensor.getEntrySize() == order*sizeof(int) + sizeof(double));
+  tensor.insertEntries(std::move(entries));
+  if (pack) {
+    tensor.pack();
+  }
   return tensor;
 }
 
@@ -77,19 +131,13 @@ TensorBase readTNS(std::istream& stream, const Format& format, bool pack) {
 }
 
 void writeTNS(std::string filename, const TensorBase& tensor) {
-  std::fstream file;
-  util::openStream(file, filename, fstream::out);
+  util::FileStream file(filename, fstream::out);
   writeTNS(file, tensor);
   file.close();
 }
 
 void writeTNS(std::ostream& stream, const TensorBase& tensor) {
-  for (auto& value : iterate<double>(tensor)) {
-    for (size_t coord : value.first) {
-      stream << coord+1 << " ";
-    }
-    stream << value.second << endl;
-  }
+  storage::writeComponents(stream, tensor, true);
 }
 
 }
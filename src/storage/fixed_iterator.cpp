@@ -2,23 +2,22 @@
 
 #include "taco/util/strings.h"
 
+using namespace std;
 using namespace taco::ir;
 
 namespace taco {
 namespace storage {
 
 FixedIterator::FixedIterator(std::string name, const Expr& tensor, int level,
-                             size_t fixedSize, Iterator previous)
+                             Iterator previous)
     : IteratorImpl(previous, tensor) {
   this->tensor = tensor;
   this->level = level;
 
   std::string idxVarName = name + util::toString(tensor);
-  ptrVar = Var::make(util::toString(tensor) + std::to_string(level) + "_ptr",
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
                      Int());
-  idxVar = Var::make(idxVarName,Int());
-
-  this->fixedSize = (long long)fixedSize;
+  idxVar = Var::make(idxVarName, Int());
 }
 
 bool FixedIterator::isDense() const {
@@ -37,6 +36,10 @@ bool FixedIterator::isSequentialAccess() const {
   return true;
 }
 
+bool FixedIterator::isUnique() const {
+  return false;
+}
+
 Expr FixedIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -50,17 +53,21 @@ Expr FixedIterator::getIteratorVar() const {
 }
 
 Expr FixedIterator::begin() const {
-  return (long long) 0;
+  return Mul::make(getParent().getPtrVar(), getSizeArr());
 }
 
 Expr FixedIterator::end() const {
-  return fixedSize;
+  return Mul::make(Add::make(getParent().getPtrVar(), (long long) 1),
+                   getSizeArr());
 }
 
 Stmt FixedIterator::initDerivedVars() const {
-  Expr ptrVal = Add::make(Mul::make(getParent().getPtrVar(), end()),
-                          getIdxVar());
-  return VarAssign::make(getIdxVar(), ptrVal);
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
+}
+
+Expr FixedIterator::getIdx(Expr ptr) const {
+  return Load::make(getIdxArr(), ptr);
 }
 
 ir::Stmt FixedIterator::storePtr() const {
@@ -71,17 +78,17 @@ ir::Stmt FixedIterator::storeIdx(ir::Expr idx) const {
   return Store::make(getIdxArr(), getPtrVar(), idx);
 }
 
-ir::Expr FixedIterator::getPtrArr() const {
+ir::Expr FixedIterator::getSizeArr() const {
   return GetProperty::make(tensor, TensorProperty::Dimension, level);
 }
 
 ir::Expr FixedIterator::getIdxArr() const {
-  return GetProperty::make(tensor, TensorProperty::Dimension, level);
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_idx";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
 }
 
 ir::Stmt FixedIterator::initStorage(ir::Expr size) const {
-  return Block::make({Allocate::make(getPtrArr(), (long long) 1),
-                      Allocate::make(getIdxArr(), size)});
+  return Allocate::make(getIdxArr(), size);
 }
 
 ir::Stmt FixedIterator::resizePtrStorage(ir::Expr size) const {
@@ -9,10 +9,14 @@
 namespace taco {
 namespace storage {
 
+/// Iterator over a fixed level, which stores the same number of coordinates
+/// for every position of its parent level (e.g. the second level of ELL). The
+/// segments are padded by repeating their last coordinate with zero values,
+/// so a coordinate may be visited several times.
 class FixedIterator : public IteratorImpl {
 public:
   FixedIterator(std::string name, const ir::Expr& tensor, int level,
-                size_t fixedSize, Iterator previous);
+                Iterator previous);
   virtual ~FixedIterator() {};
 
   bool isDense() const;
@@ -21,6 +25,8 @@ public:
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
 
+  bool isUnique() const;
+
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
 
@@ -30,6 +36,8 @@ public:
 
   ir::Stmt initDerivedVars() const;
 
+  ir::Expr getIdx(ir::Expr ptr) const;
+
   ir::Stmt storePtr() const;
   ir::Stmt storeIdx(ir::Expr idx) const;
 
@@ -44,10 +52,8 @@ private:
   ir::Expr ptrVar;
   ir::Expr idxVar;
 
-  ir::Expr getPtrArr() const;
+  ir::Expr getSizeArr() const;
   ir::Expr getIdxArr() const;
-
-  ir::Expr fixedSize;
 };
 
 }}
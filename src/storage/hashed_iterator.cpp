@@ -0,0 +1,93 @@
+#include "hashed_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+HashedIterator::HashedIterator(std::string name, const Expr& tensor, int level,
+                               Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     Int());
+  idxVar = Var::make(idxVarName, Int());
+}
+
+bool HashedIterator::isDense() const {
+  return false;
+}
+
+bool HashedIterator::isFixedRange() const {
+  return false;
+}
+
+bool HashedIterator::isRandomAccess() const {
+  return true;
+}
+
+bool HashedIterator::isSequentialAccess() const {
+  return false;
+}
+
+Expr HashedIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr HashedIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr HashedIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr HashedIterator::begin() const {
+  return (long long) 0;
+}
+
+Expr HashedIterator::end() const {
+  return getCapacity();
+}
+
+Stmt HashedIterator::initDerivedVars() const {
+  return Stmt();
+}
+
+Expr HashedIterator::locate(Expr idx, bool insert) const {
+  return Call::make(insert ? "taco_hash_insert" : "taco_hash_find",
+                    {tensor, (long long)level, getParent().getPtrVar(), idx},
+                    Int());
+}
+
+Expr HashedIterator::getCapacity() const {
+  return Call::make("taco_hash_capacity", {tensor, (long long)level}, Int());
+}
+
+ir::Stmt HashedIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt HashedIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+}}
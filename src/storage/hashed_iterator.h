@@ -0,0 +1,57 @@
+#ifndef TACO_STORAGE_HASHED_H
+#define TACO_STORAGE_HASHED_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over a hashed level, which stores the coordinates of all its
+/// segments in one open addressing hash table. The values of the level are
+/// stored in the slots of the table, which coordinates are inserted into and
+/// looked up in through the runtime library. Hashed levels may only be
+/// written to, and only if all levels above them are dense.
+class HashedIterator : public IteratorImpl {
+public:
+  HashedIterator(std::string name, const ir::Expr& tensor, int level,
+                 Iterator previous);
+  virtual ~HashedIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+
+  ir::Expr locate(ir::Expr idx, bool insert) const;
+  ir::Expr getCapacity() const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+};
+
+}}
+#endif
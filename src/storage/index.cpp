@@ -55,11 +55,29 @@ size_t Index::getSize() const {
         size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
         break;
       case ModeType::Sparse:
+      case ModeType::Packed:
         size = modeIndex.getIndexArray(0).get(size).getAsIndex();
         break;
       case ModeType::Fixed:
         size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
         break;
+      case ModeType::Singleton:
+        break;
+      case ModeType::Hashed:
+        // The values of a hashed mode are stored in the slots of its table
+        size = (modeIndex.numIndexArrays() > 0)
+               ? modeIndex.getIndexArray(0).get(0).getAsIndex() : 0;
+        break;
+      case ModeType::Diagonal:
+        // Every stored diagonal has one value per row
+        size *= modeIndex.getIndexArray(0).get(0).getAsIndex();
+        break;
+      case ModeType::Bitmap: {
+        // The last rank is the number of set bits in all the bitmaps
+        const Array& rank = modeIndex.getIndexArray(2);
+        size = rank.get(rank.getSize() - 1).getAsIndex();
+        break;
+      }
     }
   }
   return size;
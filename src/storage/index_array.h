@@ -0,0 +1,71 @@
+#ifndef TACO_STORAGE_INDEX_ARRAY_H
+#define TACO_STORAGE_INDEX_ARRAY_H
+
+#include <cstdint>
+
+#include "taco/error.h"
+#include "taco/type.h"
+#include "taco/storage/array.h"
+
+namespace taco {
+namespace storage {
+
+/// Reads the entries of an index array of any integer type.
+class IndexArrayReader {
+public:
+  IndexArrayReader(const Array& array)
+      : data(array.getData()), kind(array.getType().getKind()) {}
+
+  long long operator[](size_t i) const {
+    switch (kind) {
+      case DataType::UInt8:  return ((const uint8_t*)data)[i];
+      case DataType::UInt16: return ((const uint16_t*)data)[i];
+      case DataType::UInt32: return ((const uint32_t*)data)[i];
+      case DataType::UInt64: return (long long)((const uint64_t*)data)[i];
+      case DataType::Int8:   return ((const int8_t*)data)[i];
+      case DataType::Int16:  return ((const int16_t*)data)[i];
+      case DataType::Int32:  return ((const int32_t*)data)[i];
+      case DataType::Int64:  return ((const int64_t*)data)[i];
+      default:
+        taco_ierror << "Index arrays must have integer types";
+        return 0;
+    }
+  }
+
+private:
+  const void*    data;
+  DataType::Kind kind;
+};
+
+/// Writes the entries of an index array of any integer type.
+class IndexArrayWriter {
+public:
+  IndexArrayWriter(Array array)
+      : data(array.getData()), kind(array.getType().getKind()) {}
+
+  IndexArrayWriter(void* data, DataType type)
+      : data(data), kind(type.getKind()) {}
+
+  void set(size_t i, long long value) {
+    switch (kind) {
+      case DataType::UInt8:  ((uint8_t*)data)[i]  = (uint8_t)value;  break;
+      case DataType::UInt16: ((uint16_t*)data)[i] = (uint16_t)value; break;
+      case DataType::UInt32: ((uint32_t*)data)[i] = (uint32_t)value; break;
+      case DataType::UInt64: ((uint64_t*)data)[i] = (uint64_t)value; break;
+      case DataType::Int8:   ((int8_t*)data)[i]   = (int8_t)value;   break;
+      case DataType::Int16:  ((int16_t*)data)[i]  = (int16_t)value;  break;
+      case DataType::Int32:  ((int32_t*)data)[i]  = (int32_t)value;  break;
+      case DataType::Int64:  ((int64_t*)data)[i]  = (int64_t)value;  break;
+      default:
+        taco_ierror << "Index arrays must have integer types";
+        break;
+    }
+  }
+
+private:
+  void*          data;
+  DataType::Kind kind;
+};
+
+}}
+#endif
@@ -4,6 +4,11 @@
 #include "dense_iterator.h"
 #include "sparse_iterator.h"
 #include "fixed_iterator.h"
+#include "singleton_iterator.h"
+#include "hashed_iterator.h"
+#include "bitmap_iterator.h"
+#include "packed_iterator.h"
+#include "diagonal_iterator.h"
 
 #include "taco/tensor.h"
 #include "taco/index_notation/index_notation.h"
@@ -31,7 +36,7 @@ Iterator Iterator::makeRoot(const ir::Expr& tensor) {
 Iterator Iterator::make(const lower::TensorPath& path,
                         string name, const ir::Expr& tensorVar,
                         size_t mode, ModeType modeType, size_t modeOrdering,
-                        Iterator parent, const Type& type) {
+                        bool unique, Iterator parent, const Type& type) {
   Iterator iterator;
   iterator.path = path;
 
@@ -46,16 +51,44 @@ Iterator Iterator::make(const lower::TensorPath& path,
     }
     case ModeType::Sparse: {
       iterator.iterator =
-          std::make_shared<SparseIterator>(name, tensorVar, mode, parent);
+          std::make_shared<SparseIterator>(name, tensorVar, mode, unique,
+                                           parent);
+      break;
+    }
+    case ModeType::Singleton: {
+      iterator.iterator =
+          std::make_shared<SingletonIterator>(name, tensorVar, mode, parent);
+      break;
+    }
+    case ModeType::Hashed: {
+      iterator.iterator =
+          std::make_shared<HashedIterator>(name, tensorVar, mode, parent);
+      break;
+    }
+    case ModeType::Bitmap: {
+      taco_tassert(type.getShape().getDimension(modeOrdering).isFixed());
+      size_t dimension = type.getShape().getDimension(modeOrdering).getSize();
+      iterator.iterator =
+          std::make_shared<BitmapIterator>(name, tensorVar, mode, dimension,
+                                           parent);
+      break;
+    }
+    case ModeType::Diagonal: {
+      taco_tassert(type.getShape().getDimension(modeOrdering).isFixed());
+      size_t dimension = type.getShape().getDimension(modeOrdering).getSize();
+      iterator.iterator =
+          std::make_shared<DiagonalIterator>(name, tensorVar, mode, dimension,
+                                             parent);
       break;
     }
     case ModeType::Fixed: {
-//      auto modeIndex = tensor.getStorage().getIndex().getModeIndex(mode);
-//      int fixedSize = getValue<int>(modeIndex.getIndexArray(0), 0);
-//      iterator.iterator =
-//          std::make_shared<FixedIterator>(name, tensorVar, mode, fixedSize,
-//                                          parent);
-      taco_not_supported_yet;
+      iterator.iterator =
+          std::make_shared<FixedIterator>(name, tensorVar, mode, parent);
+      break;
+    }
+    case ModeType::Packed: {
+      iterator.iterator =
+          std::make_shared<PackedIterator>(name, tensorVar, mode, parent);
       break;
     }
   }
@@ -103,6 +136,16 @@ bool Iterator::isSequentialAccess() const {
   return iterator->isSequentialAccess();
 }
 
+bool Iterator::isUnique() const {
+  taco_iassert(defined());
+  return iterator->isUnique();
+}
+
+bool Iterator::isLocatable() const {
+  taco_iassert(defined());
+  return iterator->isLocatable();
+}
+
 ir::Expr Iterator::getTensor() const {
   taco_iassert(defined());
   return iterator->getTensor();
@@ -138,6 +181,36 @@ ir::Stmt Iterator::initDerivedVar() const {
   return iterator->initDerivedVars();
 }
 
+ir::Stmt Iterator::initMergeVars() const {
+  taco_iassert(defined());
+  return iterator->initMergeVars();
+}
+
+ir::Stmt Iterator::advance(ir::Expr cond) const {
+  taco_iassert(defined());
+  return iterator->advance(cond);
+}
+
+ir::Stmt Iterator::makeLoop(ir::Stmt body, ir::LoopKind kind) const {
+  taco_iassert(defined());
+  return iterator->makeLoop(body, kind);
+}
+
+ir::Expr Iterator::getIdx(ir::Expr ptr) const {
+  taco_iassert(defined());
+  return iterator->getIdx(ptr);
+}
+
+ir::Expr Iterator::locate(ir::Expr idx, bool insert) const {
+  taco_iassert(defined());
+  return iterator->locate(idx, insert);
+}
+
+ir::Expr Iterator::getCapacity() const {
+  taco_iassert(defined());
+  return iterator->getCapacity();
+}
+
 ir::Stmt Iterator::storePtr() const {
   taco_iassert(defined());
   return iterator->storePtr();
@@ -199,6 +272,43 @@ const Iterator& IteratorImpl::getParent() const {
   return parent;
 }
 
+bool IteratorImpl::isUnique() const {
+  return true;
+}
+
+bool IteratorImpl::isLocatable() const {
+  return false;
+}
+
+ir::Stmt IteratorImpl::initMergeVars() const {
+  return ir::Stmt();
+}
+
+ir::Stmt IteratorImpl::advance(ir::Expr cond) const {
+  ir::Expr ivar = getIteratorVar();
+  const ir::Literal* always = cond.as<ir::Literal>();
+  ir::Expr inc = (always != nullptr && always->bool_value)
+                 ? ir::Expr((long long)1) : ir::Cast::make(cond, ivar.type());
+  return ir::VarAssign::make(ivar, ir::Add::make(ivar, inc));
+}
+
+ir::Stmt IteratorImpl::makeLoop(ir::Stmt body, ir::LoopKind kind) const {
+  return ir::Stmt();
+}
+
+ir::Expr IteratorImpl::getIdx(ir::Expr ptr) const {
+  return ir::Expr();
+}
+
+ir::Expr IteratorImpl::locate(ir::Expr idx, bool insert) const {
+  taco_iassert(isRandomAccess());
+  return ir::Add::make(ir::Mul::make(getParent().getPtrVar(), end()), idx);
+}
+
+ir::Expr IteratorImpl::getCapacity() const {
+  return ir::Expr();
+}
+
 const ir::Expr& IteratorImpl::getTensor() const {
   return tensor;
 }
@@ -30,7 +30,7 @@ public:
   static Iterator make(const lower::TensorPath& path,
                        std::string name, const ir::Expr& tensorVar,
                        size_t mode, ModeType modeType, size_t modeOrdering,
-                       Iterator parent, const Type& type);
+                       bool unique, Iterator parent, const Type& type);
 
   /// Get the parent of this iterator in its iterator list.
   const Iterator& getParent() const;
@@ -55,6 +55,17 @@ public:
   /// Returns true if the iterator supports sequential access
   bool isSequentialAccess() const;
 
+  /// Returns true if the iterator visits each coordinate of its segments at
+  /// most once. Iterators over levels that store duplicate coordinates (e.g.
+  /// the first level of COO) are not unique.
+  bool isUnique() const;
+
+  /// Returns true if the iterator is a sequential access iterator that can
+  /// also locate coordinates (e.g. a bitmap level), so a conjunctive merge
+  /// can test the membership of the coordinates of other iterators instead of
+  /// co-iterating it. Its locate returns -1 for coordinates it does not store.
+  bool isLocatable() const;
+
   /// Returns the tensor this iterator is iterating over.
   ir::Expr getTensor() const;
 
@@ -84,6 +95,34 @@ public:
   /// the iterator variable.
   ir::Stmt initDerivedVar() const;
 
+  /// Returns a statement that initializes the variables a merged iterator
+  /// keeps between loop iterations, after its iterator variable is set to
+  /// begin(), or an undefined statement if it keeps none.
+  ir::Stmt initMergeVars() const;
+
+  /// Returns a statement that moves a merged iterator to its next position if
+  /// `cond` holds.
+  ir::Stmt advance(ir::Expr cond) const;
+
+  /// Returns a loop that runs `body` at every position of an iterator that is
+  /// not merged, or an undefined statement if the iterator is iterated by a
+  /// for loop over [begin, end).
+  ir::Stmt makeLoop(ir::Stmt body, ir::LoopKind kind) const;
+
+  /// Returns an expression that loads the index stored at position `ptr`, or
+  /// an undefined expression if the iterator does not store its indices.
+  ir::Expr getIdx(ir::Expr ptr) const;
+
+  /// Returns an expression that computes the position of index `idx` of a
+  /// random access iterator. If `insert` is true then the index is inserted
+  /// into levels that store their indices (e.g. hashed levels).
+  ir::Expr locate(ir::Expr idx, bool insert) const;
+
+  /// Returns an expression that computes the number of positions of a level
+  /// whose positions do not depend on its parent (e.g. the slots of a hashed
+  /// level), or an undefined expression for other levels.
+  ir::Expr getCapacity() const;
+
   /// Returns a statement that stores the ptr variable to the ptr index array.
   ir::Stmt storePtr() const;
 
@@ -126,6 +165,9 @@ public:
   virtual bool isRandomAccess() const                    = 0;
   virtual bool isSequentialAccess() const                = 0;
 
+  virtual bool isUnique() const;
+  virtual bool isLocatable() const;
+
   virtual ir::Expr getPtrVar() const                     = 0;
   virtual ir::Expr getIdxVar() const                     = 0;
 
@@ -134,6 +176,13 @@ public:
   virtual ir::Expr end() const                           = 0;
 
   virtual ir::Stmt initDerivedVars() const               = 0;
+  virtual ir::Stmt initMergeVars() const;
+  virtual ir::Stmt advance(ir::Expr cond) const;
+  virtual ir::Stmt makeLoop(ir::Stmt body, ir::LoopKind kind) const;
+
+  virtual ir::Expr getIdx(ir::Expr ptr) const;
+  virtual ir::Expr locate(ir::Expr idx, bool insert) const;
+  virtual ir::Expr getCapacity() const;
 
   virtual ir::Stmt storeIdx(ir::Expr idx) const          = 0;
   virtual ir::Stmt storePtr() const                      = 0;
@@ -1,15 +1,25 @@
 #include "taco/storage/pack.h"
 
+#include <algorithm>
+#include <bitset>
 #include <climits>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "taco/format.h"
 #include "taco/error.h"
+#include "taco/error/error_messages.h"
 #include "taco/ir/ir.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/storage/array_util.h"
+#include "taco/storage/allocator.h"
 #include "taco/util/collections.h"
+#include "index_array.h"
 
 using namespace std;
 
@@ -33,7 +43,7 @@ namespace storage {
 
 
 /// Count unique entries (assumes the values are sorted)
-TypedIndexVector getUniqueEntries(TypedIndexVector v, int startIndex, int endIndex) {
+TypedIndexVector getUniqueEntries(const TypedIndexVector& v, int startIndex, int endIndex) {
   TypedIndexVector uniqueEntries(v.getType());
   TypedIndexVal prev;
   TypedIndexVal curr;
@@ -128,13 +138,13 @@ size_t findMaxFixedValue(const vector<int>& dimensions,
 /// Pack tensor coordinates into an index structure and value array.  The
 /// indices consist of one index per tensor mode, and each index contains
 /// [0,2] index arrays.
-int packTensor(const vector<int>& dimensions,
+size_t packTensor(const vector<int>& dimensions,
                 const vector<TypedIndexVector>& coords,
                 char* vals,
                 size_t begin, size_t end,
                 const vector<ModeType>& modeTypes, size_t i,
                 std::vector<std::vector<TypedIndexVector>>* indices,
-                char* values, DataType dataType, int valuesIndex) {
+                char* values, DataType dataType, size_t valuesIndex) {
   auto& modeType    = modeTypes[i];
   auto& levelCoords = coords[i];
   auto& index       = (*indices)[i];
@@ -154,6 +164,16 @@ int packTensor(const vector<int>& dimensions,
       break;
     }
     case Sparse: {
+      // Modes followed by a singleton mode store one coordinate per entry
+      if (i + 1 < modeTypes.size() && modeTypes[i + 1] == Singleton) {
+        index[0].push_back(index[1].size() + (end - begin));
+        for (size_t cbegin = begin; cbegin < end; cbegin++) {
+          index[1].push_back(levelCoords[cbegin]);
+          PACK_NEXT_LEVEL(cbegin + 1);
+        }
+        break;
+      }
+
       auto indexValues = getUniqueEntries(levelCoords, begin, end);
 
       // Store segment end: the size of the stored segment is the number of
@@ -211,10 +231,195 @@ int packTensor(const vector<int>& dimensions,
       }
       break;
     }
+    case Hashed: {
+      taco_ierror << "Hashed modes are packed through sparse modes";
+      break;
+    }
+    case Diagonal: {
+      taco_ierror << "Diagonal modes are packed by packDiagonals";
+      break;
+    }
+    case Packed: {
+      taco_ierror << "Packed modes are packed through sparse modes";
+      break;
+    }
+    case Bitmap: {
+      // Set the bits of the coordinates in the segment and pack their values
+      vector<uint32_t> words((dimensions[i] + 31) / 32, 0);
+      size_t cbegin = begin;
+      while (cbegin < end) {
+        size_t j = levelCoords[cbegin].getAsIndex();
+        size_t cend = cbegin;
+        while (cend < end && levelCoords[cend].getAsIndex() == j) {
+          cend++;
+        }
+        words[j / 32] |= 1u << (j % 32);
+        PACK_NEXT_LEVEL(cend);
+        cbegin = cend;
+      }
+      for (uint32_t word : words) {
+        index[0].push_back((int32_t)word);
+      }
+      break;
+    }
+    case Singleton: {
+      // The segment of a singleton mode is the one entry of its parent
+      taco_iassert(end - begin == 1);
+      size_t cbegin = begin;
+      index[0].push_back(levelCoords[cbegin]);
+      PACK_NEXT_LEVEL(end);
+      break;
+    }
   }
   return valuesIndex;
 }
   
+/// Returns a copy of `format` whose last mode has the given type.
+static Format replaceLastMode(const Format& format, ModeType modeType) {
+  vector<ModeType> modeTypes = format.getModeTypes();
+  taco_iassert(modeTypes.size() > 0);
+  modeTypes.back() = modeType;
+  Format result(modeTypes, format.getModeOrdering());
+  vector<vector<DataType>> levelArrayTypes = format.getLevelArrayTypes();
+  if (levelArrayTypes.size() > 0) {
+    levelArrayTypes.back().resize((modeType == Hashed) ? 3 : 2, Int32);
+  }
+  result.setLevelArrayTypes(levelArrayTypes);
+  return result;
+}
+
+/// Pack the coordinates of a matrix into the DIA format. The values of each
+/// diagonal with a stored coordinate are contiguous, with one value per row.
+static Storage packDiagonals(const std::vector<int>&              dimensions,
+                             const Format&                        format,
+                             const std::vector<TypedIndexVector>& coordinates,
+                             const void*                          values,
+                             const size_t                         numCoordinates,
+                             DataType                             datatype) {
+  taco_uassert(format == DIA) << error::format_diagonal_mode;
+  const size_t numRows = dimensions[0];
+  const size_t numBytes = datatype.getNumBytes();
+
+  set<int> offsetSet;
+  for (size_t c = 0; c < numCoordinates; c++) {
+    offsetSet.insert((int)coordinates[1][c].getAsIndex() -
+                     (int)coordinates[0][c].getAsIndex());
+  }
+  vector<int> offsets(offsetSet.begin(), offsetSet.end());
+
+  Array vals = makeArray(datatype, offsets.size() * numRows);
+  memset(vals.getData(), 0, offsets.size() * numRows * numBytes);
+  for (size_t c = 0; c < numCoordinates; c++) {
+    size_t i = coordinates[0][c].getAsIndex();
+    int offset = (int)coordinates[1][c].getAsIndex() - (int)i;
+    size_t d = lower_bound(offsets.begin(), offsets.end(), offset) -
+               offsets.begin();
+    memcpy((char*)vals.getData() + (d * numRows + i) * numBytes,
+           (const char*)values + c * numBytes, numBytes);
+  }
+
+  Storage storage(format);
+  storage.setIndex(Index(format, {ModeIndex({makeArray({(int)numRows})}),
+                                  ModeIndex({makeArray({(int)offsets.size()}),
+                                             makeArray(offsets)})}));
+  storage.setValues(vals);
+  return storage;
+}
+
+/// Returns a copy of `format` whose packed modes are sparse modes.
+static Format unpackedFormat(const Format& format) {
+  vector<ModeType> modeTypes = format.getModeTypes();
+  vector<vector<DataType>> levelArrayTypes = format.getLevelArrayTypes();
+  for (size_t i = 0; i < modeTypes.size(); i++) {
+    if (modeTypes[i] == Packed) {
+      modeTypes[i] = Sparse;
+      if (i < levelArrayTypes.size()) {
+        levelArrayTypes[i].resize(2, Int32);
+      }
+    }
+  }
+  Format result(modeTypes, format.getModeOrdering());
+  result.setLevelArrayTypes(levelArrayTypes);
+  return result;
+}
+
+/// Convert the sparse modes of a storage that are packed modes in `format` by
+/// bit-packing the coordinates of each segment. A segment stores its first
+/// coordinate, the bit width of the differences between its coordinates and
+/// the first, and the word where the differences start. This *must* match
+/// taco_packed_coordinate in the prelude of the generated C code.
+static Storage packSparseModes(const Storage& storage, const Format& format) {
+  vector<ModeIndex> modeIndices;
+  size_t numPositions = 1;
+  for (size_t i = 0; i < format.getOrder(); i++) {
+    const ModeIndex& modeIndex = storage.getIndex().getModeIndex(i);
+    switch (format.getModeTypes()[i]) {
+      case Dense:
+        numPositions *= modeIndex.getIndexArray(0).get(0).getAsIndex();
+        modeIndices.push_back(modeIndex);
+        break;
+      case Sparse:
+        numPositions = modeIndex.getIndexArray(0).get(numPositions).getAsIndex();
+        modeIndices.push_back(modeIndex);
+        break;
+      case Singleton:
+        modeIndices.push_back(modeIndex);
+        break;
+      case Packed: {
+        const Array& pos = modeIndex.getIndexArray(0);
+        const int* posData = (const int*)pos.getData();
+        const int* idx = (const int*)modeIndex.getIndexArray(1).getData();
+
+        vector<int> segments(3 * numPositions);
+        vector<uint32_t> words;
+        for (size_t s = 0; s < numPositions; s++) {
+          int begin = posData[s];
+          int end = posData[s+1];
+          int base = (begin < end) ? idx[begin] : 0;
+          int range = (begin < end) ? idx[end-1] - base : 0;
+          int width = (range > 0) ? 32 - __builtin_clz((uint32_t)range) : 0;
+          segments[3*s] = base;
+          segments[3*s+1] = width;
+          segments[3*s+2] = (int)words.size();
+
+          size_t firstWord = words.size();
+          words.resize(firstWord + ((size_t)(end - begin) * width + 31) / 32, 0);
+          for (int p = begin; p < end && width > 0; p++) {
+            uint64_t bit = (uint64_t)(p - begin) * width;
+            uint64_t delta = (uint64_t)(idx[p] - base) << (bit % 32);
+            words[firstWord + bit/32] |= (uint32_t)delta;
+            if ((delta >> 32) != 0) {
+              words[firstWord + bit/32 + 1] |= (uint32_t)(delta >> 32);
+            }
+          }
+        }
+        // Decoding reads two words at a time from the word of a position,
+        // which is the last word for a segment of zero-width coordinates, so
+        // the last two words are padding
+        words.push_back(0);
+        words.push_back(0);
+
+        Array bits = makeArray(Int32, words.size());
+        memcpy(bits.getData(), words.data(), words.size() * sizeof(uint32_t));
+        modeIndices.push_back(ModeIndex({pos, makeArray(segments), bits}));
+        numPositions = posData[numPositions];
+        break;
+      }
+      case Fixed:
+      case Hashed:
+      case Bitmap:
+      case Diagonal:
+        taco_uerror << error::format_packed_mode;
+        break;
+    }
+  }
+
+  Storage result(format);
+  result.setIndex(Index(format, modeIndices));
+  result.setValues(storage.getValues());
+  return result;
+}
+
 /// Pack tensor coordinates into a format. The coordinates must be stored as a
 /// structure of arrays, that is one vector per axis coordinate and one vector
 /// for the values. The coordinates must be sorted lexicographically.
@@ -226,6 +431,25 @@ Storage pack(const std::vector<int>&              dimensions,
              DataType datatype) {
   taco_iassert(dimensions.size() == format.getOrder());
 
+  if (util::contains(format.getModeTypes(), Diagonal)) {
+    return packDiagonals(dimensions, format, coordinates, values,
+                         numCoordinates, datatype);
+  }
+
+  // Packed modes are packed as sparse modes whose coordinates are then encoded
+  if (util::contains(format.getModeTypes(), Packed)) {
+    Storage sparse = pack(dimensions, unpackedFormat(format), coordinates,
+                          values, numCoordinates, datatype);
+    return packSparseModes(sparse, format);
+  }
+
+  // Hashed modes are packed as sparse modes and then inserted into a table
+  if (isHashed(format)) {
+    Storage sparse = pack(dimensions, replaceLastMode(format, Sparse),
+                          coordinates, values, numCoordinates, datatype);
+    return hashSparseModes(sparse, format);
+  }
+
   Storage storage(format);
 
   size_t order = dimensions.size();
@@ -260,15 +484,40 @@ Storage pack(const std::vector<int>&              dimensions,
         indices[i][0].push_back(maxSize);
         break;
       }
+      case Hashed: {
+        taco_ierror << "Hashed modes are packed through sparse modes";
+        break;
+      }
+      case Diagonal: {
+        taco_ierror << "Diagonal modes are packed by packDiagonals";
+        break;
+      }
+      case Packed: {
+        taco_ierror << "Packed modes are packed through sparse modes";
+        break;
+      }
+      case Bitmap: {
+        // Bitmap indices are packed into an array of 32-bit words
+        indices.push_back({TypedIndexVector(Int32)});
+        break;
+      }
+      case Singleton: {
+        // Singleton indices have an index array
+        taco_uassert(i > 0 && (format.getModeTypes()[i-1] == Sparse ||
+                               format.getModeTypes()[i-1] == Singleton)) <<
+            "A singleton mode must follow a sparse or singleton mode";
+        indices.push_back({TypedIndexVector(format.getCoordinateTypeIdx(i))});
+        break;
+      }
     }
   }
 
-  int max_size = 1;
+  size_t max_size = 1;
   for (int i : dimensions)
     max_size *= i;
 
   void* vals = malloc(max_size * datatype.getNumBytes()); //has zeroes where dense
-  int actual_size = packTensor(dimensions, coordinates, (char *) values, 0,
+  size_t actual_size = packTensor(dimensions, coordinates, (char *) values, 0,
              numCoordinates, format.getModeTypes(), 0, &indices, (char *) vals, datatype, 0);
 
   vals = realloc(vals, actual_size);
@@ -293,6 +542,41 @@ Storage pack(const std::vector<int>&              dimensions,
         modeIndices.push_back(ModeIndex({pos, idx}));
         break;
       }
+      case ModeType::Hashed: {
+        taco_ierror << "Hashed modes are packed through sparse modes";
+        break;
+      }
+      case ModeType::Diagonal: {
+        taco_ierror << "Diagonal modes are packed by packDiagonals";
+        break;
+      }
+      case ModeType::Packed: {
+        taco_ierror << "Packed modes are packed through sparse modes";
+        break;
+      }
+      case ModeType::Bitmap: {
+        size_t numWords = indices[i][0].size();
+        Array size = makeArray({dimensions[i]});
+        Array bits = makeArray(Int32, numWords);
+        memcpy(bits.getData(), indices[i][0].data(), numWords * sizeof(int32_t));
+
+        // The rank of a word is the number of bits set in the words before it
+        Array rank = makeArray(Int32, numWords + 1);
+        const uint32_t* bitsData = (const uint32_t*)bits.getData();
+        int32_t* rankData = (int32_t*)rank.getData();
+        rankData[0] = 0;
+        for (size_t w = 0; w < numWords; w++) {
+          rankData[w + 1] = rankData[w] + (int32_t)bitset<32>(bitsData[w]).count();
+        }
+        modeIndices.push_back(ModeIndex({size, bits, rank}));
+        break;
+      }
+      case ModeType::Singleton: {
+        Array idx = makeArray(format.getCoordinateTypeIdx(i), indices[i][0].size());
+        memcpy(idx.getData(), indices[i][0].data(), indices[i][0].size() * format.getCoordinateTypeIdx(i).getNumBytes());
+        modeIndices.push_back(ModeIndex({idx}));
+        break;
+      }
     }
   }
   storage.setIndex(Index(format, modeIndices));
@@ -303,6 +587,566 @@ Storage pack(const std::vector<int>&              dimensions,
   return storage;
 }
 
+/// Returns the first level whose coordinates of two entries differ.
+static size_t firstDifference(const int* a, const int* b, size_t order) {
+  size_t i = 0;
+  while (i < order && a[i] == b[i]) {
+    i++;
+  }
+  return i;
+}
+
+/// Release the whole pages of memory in [*begin, end) to the operating system,
+/// losing their contents. Advances `begin` past the released pages and returns
+/// the number of bytes released, which is zero if they could not be released.
+static size_t releasePages(char** begin, char* end) {
+  const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+  const uintptr_t first =
+      ((uintptr_t)*begin + pageSize - 1) / pageSize * pageSize;
+  const uintptr_t last = (uintptr_t)end / pageSize * pageSize;
+  if (first >= last) {
+    return 0;
+  }
+#ifdef MADV_DONTNEED
+  if (madvise((void*)first, last - first, MADV_DONTNEED) == 0) {
+    recordDeallocation(last - first);
+    *begin = (char*)last;
+    return last - first;
+  }
+#endif
+  return 0;
+}
+
+bool canPackEntries(const Format& format) {
+  for (ModeType modeType : format.getModeTypes()) {
+    if (modeType != Dense && modeType != Sparse && modeType != Singleton &&
+        modeType != Packed && modeType != Hashed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Storage packEntries(const std::vector<int>& dimensions, const Format& format,
+                    char* entries, size_t numEntries, size_t entrySize,
+                    DataType datatype, size_t chunkSize) {
+  taco_iassert(dimensions.size() == format.getOrder());
+  taco_iassert(canPackEntries(format));
+
+  // Packed and hashed modes are packed as sparse modes and then encoded
+  if (util::contains(format.getModeTypes(), Packed)) {
+    Storage sparse = packEntries(dimensions, unpackedFormat(format), entries,
+                                 numEntries, entrySize, datatype, chunkSize);
+    return packSparseModes(sparse, format);
+  }
+  if (isHashed(format)) {
+    Storage sparse = packEntries(dimensions, replaceLastMode(format, Sparse),
+                                 entries, numEntries, entrySize, datatype,
+                                 chunkSize);
+    return hashSparseModes(sparse, format);
+  }
+
+  const size_t order = dimensions.size();
+  const vector<ModeType>& modeTypes = format.getModeTypes();
+  const size_t numBytes = datatype.getNumBytes();
+
+  // A sparse mode stores a position per distinct coordinate prefix, except
+  // when followed by a singleton mode, and a singleton mode stores a position
+  // per entry
+  vector<bool> storesEveryEntry(order, false);
+  for (size_t i = 0; i < order; i++) {
+    if (modeTypes[i] == Singleton) {
+      taco_uassert(i > 0 && (modeTypes[i-1] == Sparse ||
+                             modeTypes[i-1] == Singleton)) <<
+          "A singleton mode must follow a sparse or singleton mode";
+      storesEveryEntry[i] = true;
+      storesEveryEntry[i-1] = true;
+    }
+  }
+
+  // Count the positions of every level, which give the sizes of the arrays
+  vector<size_t> counts(order, 0);
+  for (size_t e = 0; e < numEntries; e++) {
+    const int* coords = (const int*)(entries + e * entrySize);
+    const size_t d = (e == 0) ? 0 : firstDifference(
+        (const int*)(entries + (e-1) * entrySize), coords, order);
+    for (size_t i = 0; i < order; i++) {
+      if (modeTypes[i] != Dense && (storesEveryEntry[i] || i >= d)) {
+        counts[i]++;
+      }
+    }
+  }
+  vector<size_t> numParents(order);
+  vector<size_t> numPositions(order);
+  size_t parents = 1;
+  for (size_t i = 0; i < order; i++) {
+    numParents[i] = parents;
+    numPositions[i] = (modeTypes[i] == Dense) ? parents * dimensions[i]
+                                              : counts[i];
+    parents = numPositions[i];
+  }
+
+  // Allocate the arrays at their final sizes
+  vector<ModeIndex> modeIndices;
+  vector<IndexArrayWriter> pos, idx;
+  for (size_t i = 0; i < order; i++) {
+    switch (modeTypes[i]) {
+      case Dense:
+        modeIndices.push_back(ModeIndex({makeArray({dimensions[i]})}));
+        break;
+      case Sparse: {
+        Array posArray = makeArray(format.getCoordinateTypePos(i),
+                                   numParents[i] + 1);
+        Array idxArray = makeArray(format.getCoordinateTypeIdx(i),
+                                   numPositions[i]);
+        modeIndices.push_back(ModeIndex({posArray, idxArray}));
+        break;
+      }
+      case Singleton:
+        modeIndices.push_back(ModeIndex({makeArray(
+            format.getCoordinateTypeIdx(i), numPositions[i])}));
+        break;
+      default:
+        taco_ierror;
+        break;
+    }
+    const ModeIndex& modeIndex = modeIndices.back();
+    pos.push_back(IndexArrayWriter(modeIndex.getIndexArray(0)));
+    idx.push_back(IndexArrayWriter(
+        modeIndex.getIndexArray(modeIndex.numIndexArrays() - 1)));
+  }
+  const size_t numValues = (order > 0) ? numPositions[order-1] : 1;
+  Array values = makeArray(datatype, numValues);
+  char* vals = (char*)values.getData();
+
+  // Fill the arrays in one pass over the entries, whose memory is released
+  // every `chunkSize` bytes once its entries are packed. The arrays of every
+  // level, and the values, are filled in the order of their positions.
+  recordAllocation(numEntries * entrySize);
+  char* released = entries;
+  size_t releasedBytes = 0;
+  vector<int> previous(order);
+  vector<size_t> positions(order, 0);
+  vector<size_t> filledSegments(order, 0);
+  size_t filledValues = 0;
+  counts.assign(order, 0);
+  for (size_t e = 0; e < numEntries; e++) {
+    char* entry = entries + e * entrySize;
+    const int* coords = (const int*)entry;
+    const size_t d = (e == 0) ? 0 : firstDifference(previous.data(), coords,
+                                                    order);
+    size_t parent = 0;
+    for (size_t i = 0; i < order; i++) {
+      if (modeTypes[i] == Dense) {
+        positions[i] = parent * dimensions[i] + coords[i];
+      } else if (storesEveryEntry[i] || i >= d) {
+        if (modeTypes[i] == Sparse) {
+          while (filledSegments[i] <= parent) {
+            pos[i].set(filledSegments[i]++, counts[i]);
+          }
+        }
+        positions[i] = counts[i]++;
+        idx[i].set(positions[i], coords[i]);
+      }
+      parent = positions[i];
+    }
+
+    // Positions without entries below dense levels store zeros
+    memset(vals + filledValues * numBytes, 0,
+           (parent - filledValues) * numBytes);
+    memcpy(vals + parent * numBytes, coords + order, numBytes);
+    filledValues = parent + 1;
+    copy(coords, coords + order, previous.begin());
+
+    char* packed = entry + entrySize;
+    if (chunkSize > 0 && (size_t)(packed - released) >= chunkSize) {
+      releasedBytes += releasePages(&released, packed);
+    }
+  }
+  for (size_t i = 0; i < order; i++) {
+    if (modeTypes[i] == Sparse) {
+      while (filledSegments[i] <= numParents[i]) {
+        pos[i].set(filledSegments[i]++, counts[i]);
+      }
+    }
+  }
+  memset(vals + filledValues * numBytes, 0,
+         (numValues - filledValues) * numBytes);
+  recordDeallocation(numEntries * entrySize - releasedBytes);
+
+  Storage storage(format);
+  storage.setIndex(Index(format, modeIndices));
+  storage.setValues(values);
+  return storage;
+}
+
+bool canBuildStorage(const Format& format) {
+  for (ModeType modeType : format.getModeTypes()) {
+    if (modeType != Dense && modeType != Sparse) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// An array that grows as entries are appended to it, allocated by the storage
+/// allocator so that it can be handed to an Array without a copy.
+class GrowableArray {
+public:
+  GrowableArray(DataType type)
+      : type(type), allocator(getAllocator()), data(nullptr), size(0),
+        capacity(0) {}
+
+  size_t getSize() const {
+    return size;
+  }
+
+  void reserve(size_t newCapacity) {
+    if (newCapacity <= capacity) {
+      return;
+    }
+    const size_t numBytes = newCapacity * type.getNumBytes();
+    data = (char*)((data == nullptr)
+        ? allocator.allocate(allocator.context, numBytes)
+        : allocator.reallocate(allocator.context, data, numBytes));
+    taco_uassert(data != nullptr) << "Out of memory";
+    capacity = newCapacity;
+  }
+
+  /// Grow the array to `newSize` entries, the new entries of which are zero.
+  void resize(size_t newSize) {
+    if (newSize > capacity) {
+      reserve(max(newSize, 2 * capacity));
+    }
+    if (newSize > size) {
+      memset(data + size * type.getNumBytes(), 0,
+             (newSize - size) * type.getNumBytes());
+    }
+    size = newSize;
+  }
+
+  void set(size_t i, long long value) {
+    IndexArrayWriter(data, type).set(i, value);
+  }
+
+  void push(long long value) {
+    resize(size + 1);
+    set(size - 1, value);
+  }
+
+  void push(const void* value) {
+    resize(size + 1);
+    memcpy(data + (size - 1) * type.getNumBytes(), value, type.getNumBytes());
+  }
+
+  /// Returns the entries as an array that owns them.
+  Array release() {
+    if (data == nullptr) {
+      reserve(1);
+    }
+    else if (size < capacity && size > 0) {
+      data = (char*)allocator.reallocate(allocator.context, data,
+                                         size * type.getNumBytes());
+    }
+    Array array(type, data, size, allocator);
+    data = nullptr;
+    return array;
+  }
+
+  void free() {
+    if (data != nullptr) {
+      allocator.deallocate(allocator.context, data);
+      data = nullptr;
+    }
+  }
+
+private:
+  DataType  type;
+  Allocator allocator;
+  char*     data;
+  size_t    size;
+  size_t    capacity;
+};
+
+struct StorageBuilder::Content {
+  vector<int>      dimensions;
+  Format           format;
+  vector<ModeType> modeTypes;
+
+  /// The pos and idx arrays of every sparse level. The pos array of a level
+  /// holds the end of the segment of every parent position appended so far.
+  vector<GrowableArray> pos;
+  vector<GrowableArray> idx;
+  GrowableArray         values;
+
+  /// The coordinates and positions of the previous component
+  vector<int>    previous;
+  vector<size_t> positions;
+  bool           empty;
+  bool           duplicates;
+
+  Content(const vector<int>& dimensions, const Format& format,
+          DataType datatype)
+      : dimensions(dimensions), format(format),
+        modeTypes(format.getModeTypes()), values(datatype),
+        previous(dimensions.size()), positions(dimensions.size()),
+        empty(true), duplicates(false) {}
+
+  ~Content() {
+    for (auto& array : pos) {
+      array.free();
+    }
+    for (auto& array : idx) {
+      array.free();
+    }
+    values.free();
+  }
+
+  /// Append empty segments up to the segment of `parent` of a sparse level.
+  void openSegment(size_t level, size_t parent) {
+    while (pos[level].getSize() < parent + 2) {
+      pos[level].push((long long)idx[level].getSize());
+    }
+  }
+};
+
+StorageBuilder::StorageBuilder(const std::vector<int>& dimensions,
+                               const Format& format, DataType datatype)
+    : content(new Content(dimensions, format, datatype)) {
+  taco_iassert(dimensions.size() == format.getOrder());
+  taco_iassert(canBuildStorage(format));
+  content->pos.reserve(dimensions.size());
+  content->idx.reserve(dimensions.size());
+  for (size_t i = 0; i < dimensions.size(); i++) {
+    content->pos.push_back(GrowableArray(format.getCoordinateTypePos(i)));
+    content->idx.push_back(GrowableArray(format.getCoordinateTypeIdx(i)));
+    if (content->modeTypes[i] == Sparse) {
+      content->pos[i].push(0ll);
+    }
+  }
+}
+
+void StorageBuilder::reserve(size_t numComponents) {
+  const size_t order = content->dimensions.size();
+  if (order > 0 && content->modeTypes[order-1] == Sparse) {
+    content->idx[order-1].reserve(numComponents);
+    content->values.reserve(numComponents);
+  }
+  else if (!util::contains(content->modeTypes, Sparse)) {
+    size_t size = 1;
+    for (int dimension : content->dimensions) {
+      size *= dimension;
+    }
+    content->values.reserve(size);
+  }
+}
+
+bool StorageBuilder::append(const int* coordinates, const void* value) {
+  const size_t order = content->dimensions.size();
+  const size_t d = content->empty ? 0 : firstDifference(
+      content->previous.data(), coordinates, order);
+  if (!content->empty) {
+    if (d == order) {
+      content->duplicates = true;
+      return true;
+    }
+    if (coordinates[d] < content->previous[d]) {
+      return false;
+    }
+  }
+
+  size_t parent = (d == 0) ? 0 : content->positions[d-1];
+  for (size_t i = d; i < order; i++) {
+    taco_uassert(coordinates[i] >= 0 &&
+                 coordinates[i] < content->dimensions[i]) <<
+        "Coordinate exceeds the dimension of the tensor";
+    if (content->modeTypes[i] == Dense) {
+      content->positions[i] = parent * content->dimensions[i] + coordinates[i];
+    } else {
+      content->openSegment(i, parent);
+      content->positions[i] = content->idx[i].getSize();
+      content->idx[i].push((long long)coordinates[i]);
+      content->pos[i].set(parent + 1, (long long)content->idx[i].getSize());
+    }
+    parent = content->positions[i];
+  }
+
+  // Positions without components below dense levels store zeros
+  content->values.resize(parent);
+  content->values.push(value);
+  copy(coordinates + d, coordinates + order, content->previous.begin() + d);
+  content->empty = false;
+  return true;
+}
+
+Storage StorageBuilder::getStorage() {
+  if (content->duplicates) {
+    taco_uwarning << "Duplicate coordinate ignored when inserting into tensor";
+  }
+  vector<ModeIndex> modeIndices;
+  size_t parents = 1;
+  for (size_t i = 0; i < content->dimensions.size(); i++) {
+    if (content->modeTypes[i] == Dense) {
+      modeIndices.push_back(ModeIndex({makeArray({content->dimensions[i]})}));
+      parents *= content->dimensions[i];
+    } else {
+      if (parents > 0) {
+        content->openSegment(i, parents - 1);
+      }
+      parents = content->idx[i].getSize();
+      modeIndices.push_back(ModeIndex({content->pos[i].release(),
+                                       content->idx[i].release()}));
+    }
+  }
+  content->values.resize(parents);
+
+  Storage storage(content->format);
+  storage.setIndex(Index(content->format, modeIndices));
+  storage.setValues(content->values.release());
+  return storage;
+}
+
+/// Hash a (parent position, coordinate) pair to a table slot. This must match
+/// TACO_HASH in the prelude of the generated C code.
+static uint32_t hashSlot(int parent, int coord, int capacity) {
+  uint32_t hash = ((uint32_t)parent*2654435761u + (uint32_t)coord)*2246822519u;
+  return hash & (uint32_t)(capacity - 1);
+}
+
+/// Returns the number of positions in the last mode's parent, which must be
+/// dense, and checks that only the last mode has type `lastModeType`.
+static int numParentPositions(const Storage& storage, ModeType lastModeType) {
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  size_t order = format.getOrder();
+  taco_uassert(order > 0 && format.getModeTypes()[order-1] == lastModeType)
+      << error::format_hashed_mode;
+  int numParents = 1;
+  for (size_t i = 0; i + 1 < order; i++) {
+    taco_uassert(format.getModeTypes()[i] == Dense)
+        << error::format_hashed_mode;
+    numParents *= ((const int*)index.getModeIndex(i).getIndexArray(0).getData())[0];
+  }
+  return numParents;
+}
+
+Storage sortHashedModes(const Storage& storage) {
+  const Format& format = storage.getFormat();
+  int numParents = numParentPositions(storage, Hashed);
+  size_t last = format.getOrder() - 1;
+  const ModeIndex& modeIndex = storage.getIndex().getModeIndex(last);
+  DataType valueType = storage.getValues().getType();
+  size_t valueBytes = valueType.getNumBytes();
+
+  int capacity = 0;
+  const int* crd = nullptr;
+  const int* par = nullptr;
+  if (modeIndex.numIndexArrays() > 0) {
+    capacity = ((const int*)modeIndex.getIndexArray(0).getData())[0];
+    crd = (const int*)modeIndex.getIndexArray(1).getData();
+    par = (const int*)modeIndex.getIndexArray(2).getData();
+  }
+
+  // Bucket the occupied slots by their parent position
+  vector<int> pos(numParents + 1, 0);
+  for (int slot = 0; slot < capacity; slot++) {
+    if (crd[slot] >= 0) {
+      pos[par[slot] + 1]++;
+    }
+  }
+  for (int p = 0; p < numParents; p++) {
+    pos[p + 1] += pos[p];
+  }
+  vector<int> slots(pos[numParents]);
+  vector<int> next(pos.begin(), pos.end() - 1);
+  for (int slot = 0; slot < capacity; slot++) {
+    if (crd[slot] >= 0) {
+      slots[next[par[slot]]++] = slot;
+    }
+  }
+
+  // Sort each segment by coordinate and gather the coordinates and values
+  Array posArray = makeArray(Int32, numParents + 1);
+  Array idxArray = makeArray(Int32, slots.size());
+  Array vals = makeArray(valueType, slots.size());
+  memcpy(posArray.getData(), pos.data(), pos.size() * sizeof(int));
+  const char* hashedVals = (const char*)storage.getValues().getData();
+  for (int p = 0; p < numParents; p++) {
+    sort(slots.begin() + pos[p], slots.begin() + pos[p+1],
+         [crd](int a, int b) { return crd[a] < crd[b]; });
+    for (int k = pos[p]; k < pos[p+1]; k++) {
+      ((int*)idxArray.getData())[k] = crd[slots[k]];
+      memcpy((char*)vals.getData() + k*valueBytes,
+             hashedVals + slots[k]*valueBytes, valueBytes);
+    }
+  }
+
+  Format sparseFormat = replaceLastMode(format, Sparse);
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < last; i++) {
+    modeIndices.push_back(storage.getIndex().getModeIndex(i));
+  }
+  modeIndices.push_back(ModeIndex({posArray, idxArray}));
+
+  Storage result(sparseFormat);
+  result.setIndex(Index(sparseFormat, modeIndices));
+  result.setValues(vals);
+  return result;
+}
+
+Storage hashSparseModes(const Storage& storage, const Format& format) {
+  int numParents = numParentPositions(storage, Sparse);
+  size_t last = format.getOrder() - 1;
+  taco_uassert(format.getModeTypes()[last] == Hashed)
+      << error::format_hashed_mode;
+  const ModeIndex& modeIndex = storage.getIndex().getModeIndex(last);
+  const int* pos = (const int*)modeIndex.getIndexArray(0).getData();
+  const int* idx = (const int*)modeIndex.getIndexArray(1).getData();
+  int nnz = pos[numParents];
+  DataType valueType = storage.getValues().getType();
+  size_t valueBytes = valueType.getNumBytes();
+
+  // Keep the load factor at or below one half, like the generated inserts
+  int capacity = 16;
+  while (2 * nnz > capacity) {
+    capacity *= 2;
+  }
+
+  Array sizeArray = makeArray({capacity, nnz});
+  Array crdArray = makeArray(Int32, capacity);
+  Array parArray = makeArray(Int32, capacity);
+  Array vals = makeArray(valueType, capacity);
+  int* crd = (int*)crdArray.getData();
+  int* par = (int*)parArray.getData();
+  fill(crd, crd + capacity, -1);
+  fill(par, par + capacity, 0);
+  memset(vals.getData(), 0, capacity * valueBytes);
+
+  const char* sparseVals = (const char*)storage.getValues().getData();
+  for (int p = 0; p < numParents; p++) {
+    for (int k = pos[p]; k < pos[p+1]; k++) {
+      uint32_t slot = hashSlot(p, idx[k], capacity);
+      while (crd[slot] >= 0) {
+        slot = (slot + 1) & (uint32_t)(capacity - 1);
+      }
+      crd[slot] = idx[k];
+      par[slot] = p;
+      memcpy((char*)vals.getData() + slot*valueBytes,
+             sparseVals + k*valueBytes, valueBytes);
+    }
+  }
+
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < last; i++) {
+    modeIndices.push_back(storage.getIndex().getModeIndex(i));
+  }
+  modeIndices.push_back(ModeIndex({sizeArray, crdArray, parArray}));
+
+  Storage result(format);
+  result.setIndex(Index(format, modeIndices));
+  result.setValues(vals);
+  return result;
+}
 
 ir::Stmt packCode(const Format& format) {
   using namespace taco::ir;
@@ -334,7 +1178,12 @@ ir::Stmt packCode(const Format& format) {
       case Sparse: {
         break;
       }
-      case Fixed: {
+      case Fixed:
+      case Singleton:
+      case Hashed:
+      case Bitmap:
+      case Diagonal:
+      case Packed: {
         taco_not_supported_yet;
         break;
       }
@@ -0,0 +1,157 @@
+#include "packed_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+/// The number of coordinates that are decoded at a time, which *must* match
+/// TACO_PACKED_BLOCK in the prelude of the generated C code.
+static const long long BLOCK_SIZE = 16;
+
+PackedIterator::PackedIterator(std::string name, const Expr& tensor, int level,
+                               Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  std::string idxVarName = name + util::toString(tensor);
+  std::string levelName = util::toString(tensor) + std::to_string(level + 1);
+  ptrVar = Var::make("p" + levelName, Int());
+  idxVar = Var::make(idxVarName, Int());
+  bufferVar = Var::make("c" + levelName, Int32, true);
+  blockVar = Var::make("q" + levelName, Int());
+  countVar = Var::make("n" + levelName, Int());
+}
+
+bool PackedIterator::isDense() const {
+  return false;
+}
+
+bool PackedIterator::isFixedRange() const {
+  return false;
+}
+
+bool PackedIterator::isRandomAccess() const {
+  return false;
+}
+
+bool PackedIterator::isSequentialAccess() const {
+  return true;
+}
+
+Expr PackedIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr PackedIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr PackedIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr PackedIterator::begin() const {
+  return Load::make(getPtrArr(), getParent().getPtrVar());
+}
+
+Expr PackedIterator::end() const {
+  return Load::make(getPtrArr(),
+                    Add::make(getParent().getPtrVar(), (long long) 1));
+}
+
+Stmt PackedIterator::initDerivedVars() const {
+  return VarAssign::make(getIdxVar(),
+                         Load::make(bufferVar, Sub::make(ptrVar, blockVar)),
+                         true);
+}
+
+Stmt PackedIterator::initMergeVars() const {
+  return Block::make({VarAssign::make(bufferVar,
+                                      Call::make("taco_packed_buffer", {},
+                                                 Int32),
+                                      true),
+                      VarAssign::make(blockVar, ptrVar, true),
+                      decodeBlock(true)});
+}
+
+Stmt PackedIterator::advance(Expr cond) const {
+  Stmt nextBlock = IfThenElse::make(
+      Eq::make(Sub::make(ptrVar, blockVar), BLOCK_SIZE),
+      Block::make({VarAssign::make(blockVar, ptrVar), decodeBlock(false)}));
+  Stmt next = Block::make({VarAssign::make(ptrVar, Add::make(ptrVar, 1ll)),
+                           nextBlock});
+  const Literal* always = cond.as<Literal>();
+  return (always != nullptr && always->bool_value)
+         ? next : IfThenElse::make(cond, next);
+}
+
+Stmt PackedIterator::makeLoop(Stmt body, LoopKind kind) const {
+  // Parallel loops split the segment by blocks, and other loops are annotated
+  // on the loop over the positions of a block
+  bool parallel = (kind == LoopKind::Static || kind == LoopKind::Dynamic);
+  Stmt positionLoop = For::make(ptrVar, blockVar, Add::make(blockVar, countVar),
+                                1ll, body,
+                                parallel ? LoopKind::Serial : kind);
+  return For::make(blockVar, begin(), end(), BLOCK_SIZE,
+                   Block::make({VarAssign::make(bufferVar,
+                                    Call::make("taco_packed_buffer", {}, Int32),
+                                    true),
+                                decodeBlock(true), positionLoop}),
+                   parallel ? kind : LoopKind::Serial);
+}
+
+Stmt PackedIterator::decodeBlock(bool declare) const {
+  return VarAssign::make(countVar,
+      Call::make("taco_packed_decode",
+                 {getSegmentsArr(), getBitsArr(), getPtrArr(),
+                  getParent().getPtrVar(), blockVar, end(), bufferVar}, Int()),
+      declare);
+}
+
+Expr PackedIterator::getIdx(Expr ptr) const {
+  return Call::make("taco_packed_coordinate",
+                    {getSegmentsArr(), getBitsArr(), getPtrArr(),
+                     getParent().getPtrVar(), ptr}, Int());
+}
+
+ir::Stmt PackedIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt PackedIterator::storeIdx(ir::Expr idx) const {
+  return Stmt();
+}
+
+ir::Stmt PackedIterator::initStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt PackedIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt PackedIterator::resizeIdxStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Expr PackedIterator::getPtrArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_pos";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
+}
+
+ir::Expr PackedIterator::getSegmentsArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_seg";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 1, name);
+}
+
+ir::Expr PackedIterator::getBitsArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_bits";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 2, name);
+}
+
+}}
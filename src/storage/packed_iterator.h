@@ -0,0 +1,75 @@
+#ifndef TACO_STORAGE_PACKED_H
+#define TACO_STORAGE_PACKED_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over a packed level, which stores segments like a sparse level but
+/// bit-packs their coordinates. Each segment stores its first coordinate, the
+/// number of bits of the differences between its coordinates and the first,
+/// and the word where the packed differences start. The iterator decodes the
+/// coordinates of a block of positions of a segment at a time into a small
+/// local buffer, and reads the coordinate of its position from the buffer.
+/// Loops over a segment iterate over its blocks, and merges decode the next
+/// block when the position leaves the current one, so packed levels can be
+/// merged like sparse levels.
+class PackedIterator : public IteratorImpl {
+public:
+  PackedIterator(std::string name, const ir::Expr& tensor, int level,
+                 Iterator previous);
+  virtual ~PackedIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+  ir::Stmt initMergeVars() const;
+  ir::Stmt advance(ir::Expr cond) const;
+  ir::Stmt makeLoop(ir::Stmt body, ir::LoopKind kind) const;
+
+  ir::Expr getIdx(ir::Expr ptr) const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+  ir::Expr bufferVar;
+  ir::Expr blockVar;
+  ir::Expr countVar;
+
+  ir::Expr getPtrArr() const;
+  ir::Expr getSegmentsArr() const;
+  ir::Expr getBitsArr() const;
+
+  /// Returns a statement that decodes the block of coordinates that starts at
+  /// the block position into the buffer, and sets (or declares) the number of
+  /// coordinates in the block.
+  ir::Stmt decodeBlock(bool declare) const;
+};
+
+}}
+#endif
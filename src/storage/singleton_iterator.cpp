@@ -0,0 +1,93 @@
+#include "singleton_iterator.h"
+
+#include "taco/util/strings.h"
+
+using namespace std;
+using namespace taco::ir;
+
+namespace taco {
+namespace storage {
+
+SingletonIterator::SingletonIterator(std::string name, const Expr& tensor,
+                                     int level, Iterator previous)
+    : IteratorImpl(previous, tensor) {
+  this->tensor = tensor;
+  this->level = level;
+
+  std::string idxVarName = name + util::toString(tensor);
+  ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
+                     previous.getPtrVar().type());
+  idxVar = Var::make(idxVarName, Int());
+}
+
+bool SingletonIterator::isDense() const {
+  return false;
+}
+
+bool SingletonIterator::isFixedRange() const {
+  return false;
+}
+
+bool SingletonIterator::isRandomAccess() const {
+  return false;
+}
+
+bool SingletonIterator::isSequentialAccess() const {
+  return true;
+}
+
+Expr SingletonIterator::getPtrVar() const {
+  return ptrVar;
+}
+
+Expr SingletonIterator::getIdxVar() const {
+  return idxVar;
+}
+
+Expr SingletonIterator::getIteratorVar() const {
+  return ptrVar;
+}
+
+Expr SingletonIterator::begin() const {
+  return getParent().getPtrVar();
+}
+
+Expr SingletonIterator::end() const {
+  return Add::make(getParent().getPtrVar(), (long long) 1);
+}
+
+Stmt SingletonIterator::initDerivedVars() const {
+  return VarAssign::make(getIdxVar(), Load::make(getIdxArr(), getPtrVar()),
+                         true);
+}
+
+Expr SingletonIterator::getIdx(Expr ptr) const {
+  return Load::make(getIdxArr(), ptr);
+}
+
+ir::Stmt SingletonIterator::storePtr() const {
+  return Stmt();
+}
+
+ir::Stmt SingletonIterator::storeIdx(ir::Expr idx) const {
+  return Store::make(getIdxArr(), getPtrVar(), idx);
+}
+
+ir::Expr SingletonIterator::getIdxArr() const {
+  string name = tensor.as<Var>()->name + to_string(level + 1) + "_idx";
+  return GetProperty::make(tensor, TensorProperty::Indices, level, 0, name);
+}
+
+ir::Stmt SingletonIterator::initStorage(ir::Expr size) const {
+  return Allocate::make(getIdxArr(), size);
+}
+
+ir::Stmt SingletonIterator::resizePtrStorage(ir::Expr size) const {
+  return Stmt();
+}
+
+ir::Stmt SingletonIterator::resizeIdxStorage(ir::Expr size) const {
+  return Allocate::make(getIdxArr(), size, true);
+}
+
+}}
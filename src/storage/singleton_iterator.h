@@ -0,0 +1,55 @@
+#ifndef TACO_STORAGE_SINGLETON_H
+#define TACO_STORAGE_SINGLETON_H
+
+#include <string>
+
+#include "iterator.h"
+#include "taco/ir/ir.h"
+
+namespace taco {
+namespace storage {
+
+/// Iterator over a singleton level, which stores one coordinate for each
+/// position of its parent level (e.g. the second level of COO).
+class SingletonIterator : public IteratorImpl {
+public:
+  SingletonIterator(std::string name, const ir::Expr& tensor, int level,
+                    Iterator previous);
+  virtual ~SingletonIterator() {};
+
+  bool isDense() const;
+  bool isFixedRange() const;
+
+  bool isRandomAccess() const;
+  bool isSequentialAccess() const;
+
+  ir::Expr getPtrVar() const;
+  ir::Expr getIdxVar() const;
+
+  ir::Expr getIteratorVar() const;
+  ir::Expr begin() const;
+  ir::Expr end() const;
+
+  ir::Stmt initDerivedVars() const;
+
+  ir::Expr getIdx(ir::Expr ptr) const;
+
+  ir::Stmt storePtr() const;
+  ir::Stmt storeIdx(ir::Expr idx) const;
+
+  ir::Stmt initStorage(ir::Expr size) const;
+  ir::Stmt resizePtrStorage(ir::Expr size) const;
+  ir::Stmt resizeIdxStorage(ir::Expr size) const;
+
+private:
+  ir::Expr tensor;
+  int level;
+
+  ir::Expr ptrVar;
+  ir::Expr idxVar;
+
+  ir::Expr getIdxArr() const;
+};
+
+}}
+#endif
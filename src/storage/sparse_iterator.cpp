@@ -9,14 +9,18 @@ namespace taco {
 namespace storage {
 
 SparseIterator::SparseIterator(std::string name, const Expr& tensor, int level,
-                               Iterator previous)
+                               bool unique, Iterator previous)
     : IteratorImpl(previous, tensor) {
   this->tensor = tensor;
   this->level = level;
+  this->unique = unique;
 
+  // Positions are 64-bit when the segment array of the level is 64-bit
   std::string idxVarName = name + util::toString(tensor);
+  DataType ptrType = (getPtrArr().type().getNumBits() > Int().getNumBits())
+                     ? Int(64) : Int();
   ptrVar = Var::make("p" + util::toString(tensor) + std::to_string(level + 1),
-                     Int());
+                     ptrType);
   idxVar = Var::make(idxVarName, Int());
 }
 
@@ -36,6 +40,10 @@ bool SparseIterator::isSequentialAccess() const {
   return true;
 }
 
+bool SparseIterator::isUnique() const {
+  return unique;
+}
+
 Expr SparseIterator::getPtrVar() const {
   return ptrVar;
 }
@@ -61,6 +69,10 @@ Stmt SparseIterator::initDerivedVars() const {
                          true);
 }
 
+Expr SparseIterator::getIdx(Expr ptr) const {
+  return Load::make(getIdxArr(), ptr);
+}
+
 ir::Stmt SparseIterator::storePtr() const {
   return Store::make(getPtrArr(),
                      Add::make(getParent().getPtrVar(), (long long) 1), getPtrVar());
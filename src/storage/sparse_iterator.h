@@ -12,7 +12,7 @@ namespace storage {
 class SparseIterator : public IteratorImpl {
 public:
   SparseIterator(std::string name, const ir::Expr& tensor, int level,
-                 Iterator previous);
+                 bool unique, Iterator previous);
   virtual ~SparseIterator() {};
 
   bool isDense() const;
@@ -21,6 +21,8 @@ public:
   bool isRandomAccess() const;
   bool isSequentialAccess() const;
 
+  bool isUnique() const;
+
   ir::Expr getPtrVar() const;
   ir::Expr getIdxVar() const;
 
@@ -30,6 +32,8 @@ public:
 
   ir::Stmt initDerivedVars() const;
 
+  ir::Expr getIdx(ir::Expr ptr) const;
+
   ir::Stmt storePtr() const;
   ir::Stmt storeIdx(ir::Expr idx) const;
 
@@ -40,6 +44,7 @@ public:
 private:
   ir::Expr tensor;
   int level;
+  bool unique;
 
   ir::Expr ptrVar;
   ir::Expr idxVar;
@@ -58,19 +58,34 @@ Array Storage::getValues() {
   return content->values;
 }
 
-size_t Storage::getSizeInBytes() {
+size_t Storage::getSizeInBytes() const {
   size_t indexSizeInBytes = 0;
+  for (auto& modeSizes : getIndexSizesInBytes()) {
+    for (size_t size : modeSizes) {
+      indexSizeInBytes += size;
+    }
+  }
+  return indexSizeInBytes + getValuesSizeInBytes();
+}
+
+vector<vector<size_t>> Storage::getIndexSizesInBytes() const {
+  vector<vector<size_t>> sizes;
   const auto& index = getIndex();
   for (size_t i = 0; i < index.numModeIndices(); i++) {
     const auto& modeIndex = index.getModeIndex(i);
+    sizes.push_back({});
     for (size_t j = 0; j < modeIndex.numIndexArrays(); j++) {
       const auto& indexArray = modeIndex.getIndexArray(j);
-      indexSizeInBytes += indexArray.getSize() *
-                          indexArray.getType().getNumBytes();
+      sizes.back().push_back(indexArray.getSize() *
+                             indexArray.getType().getNumBytes());
     }
   }
+  return sizes;
+}
+
+size_t Storage::getValuesSizeInBytes() const {
   const auto& values = getValues();
-  return indexSizeInBytes + values.getSize() * values.getType().getNumBytes();
+  return values.getSize() * values.getType().getNumBytes();
 }
 
 std::ostream& operator<<(std::ostream& os, const Storage& storage) {
@@ -0,0 +1,421 @@
+#include "text_parser.h"
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "taco/error.h"
+#include "taco/storage/pack.h"
+#include "taco/util/files.h"
+#include "taco/util/parallel.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+/// The smallest number of bytes of a file worth handing to a separate thread.
+static const size_t MIN_CHUNK_BYTES = (1 << 20);
+
+static const char* MALFORMED_LINE = "Malformed coordinate line in file, "
+    "coordinates must be positive integers no larger than INT_MAX followed by "
+    "a value";
+
+/// The powers of ten that are exactly representable as doubles.
+static const double powersOf10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const size_t FileContents::BLOCK_BYTES = (1 << 26);
+
+FileContents::FileContents(std::string filename, size_t blockBytes)
+    : filename(filename), blockBytes(blockBytes), data(nullptr), size(0) {
+  if (util::getCompression(filename) != util::Compression::None) {
+    open();
+    return;
+  }
+
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  taco_uassert(fd >= 0) << "Error opening file: " << filename;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      close(fd);
+      taco_uerror << "Error mapping file: " << filename;
+    }
+    data = (char*)mapped;
+  }
+  close(fd);
+}
+
+FileContents::~FileContents() {
+  if (stream != nullptr) {
+    finishReading();
+  }
+  else if (data != nullptr) {
+    munmap(data, size);
+  }
+}
+
+const char* FileContents::begin() const {
+  return data;
+}
+
+const char* FileContents::end() const {
+  return data + size;
+}
+
+bool FileContents::next() {
+  if (stream == nullptr) {
+    return false;
+  }
+  if (reader.joinable()) {
+    reader.join();
+  }
+  if (following.empty()) {
+    taco_uassert(stream->eof()) << "Error reading file: " << filename;
+    stream->close();
+    return false;
+  }
+  current.swap(following);
+  following.clear();
+  data = current.data();
+  size = current.size();
+  if (*stream) {
+    reader = std::thread([this]() { readFollowing(); });
+  }
+  return true;
+}
+
+void FileContents::rewind() {
+  if (stream != nullptr) {
+    finishReading();
+    open();
+  }
+}
+
+void FileContents::open() {
+  stream.reset(new util::FileStream(filename, ios_base::in));
+  partialLine.clear();
+  following.clear();
+  readFollowing();
+  data = nullptr;
+  size = 0;
+  if (!following.empty()) {
+    next();
+  }
+}
+
+/// Decompress the next block of whole lines into `following`. The block
+/// starts with the partial line that ended the previous block, and the
+/// partial line that ends it is kept for the block after it.
+void FileContents::readFollowing() {
+  following.assign(partialLine.begin(), partialLine.end());
+  partialLine.clear();
+  size_t blockEnd = 0;
+  while (*stream) {
+    const size_t previousSize = following.size();
+    following.resize(previousSize + blockBytes);
+    stream->read(following.data() + previousSize, blockBytes);
+    following.resize(previousSize + stream->gcount());
+    for (size_t i = following.size(); i > previousSize; i--) {
+      if (following[i-1] == '\n') {
+        blockEnd = i;
+        break;
+      }
+    }
+    if (blockEnd > 0) {
+      break;
+    }
+  }
+  if (*stream) {
+    partialLine.assign(following.begin() + blockEnd, following.end());
+    following.resize(blockEnd);
+  }
+}
+
+/// Wait for the block being decompressed, and stop the decompressor.
+void FileContents::finishReading() {
+  if (reader.joinable()) {
+    reader.join();
+  }
+  stream.reset();
+}
+
+const char* nextLine(const char* pos, const char* end) {
+  const char* newline = (const char*)memchr(pos, '\n', end - pos);
+  return (newline == nullptr) ? end : newline + 1;
+}
+
+/// Returns the start of the first line that starts at or after `pos`.
+static const char* lineStart(const char* pos, const char* begin,
+                             const char* end) {
+  return (pos == begin || pos[-1] == '\n') ? pos : nextLine(pos, end);
+}
+
+static const char* skipBlanks(const char* p, const char* end) {
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+    p++;
+  }
+  return p;
+}
+
+static bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static bool isDataLine(const char* p, const char* end) {
+  p = skipBlanks(p, end);
+  return p < end && *p != '\n' && *p != '%' && *p != '#';
+}
+
+/// Parse a real number with strtod, which needs a terminated copy since the
+/// mapped file need not end in a delimiter.
+static const char* parseDoubleSlow(const char* p, const char* end,
+                                   double* value) {
+  const char* tokenEnd = p;
+  while (tokenEnd < end && *tokenEnd != ' ' && *tokenEnd != '\t' &&
+         *tokenEnd != '\r' && *tokenEnd != '\n') {
+    tokenEnd++;
+  }
+  string token(p, tokenEnd);
+  char* parsedEnd;
+  *value = strtod(token.c_str(), &parsedEnd);
+  return (parsedEnd == token.c_str()) ? nullptr
+                                      : p + (parsedEnd - token.c_str());
+}
+
+/// Parse a real number. Numbers whose significant digits fit in the 53-bit
+/// mantissa of a double and whose decimal exponent is at most 22 are exactly
+/// the product or quotient of two doubles, so they are computed directly and
+/// correctly rounded. Other numbers fall back to strtod. Returns the end of
+/// the number, or nullptr if there is none.
+static const char* parseDouble(const char* p, const char* end, double* value) {
+  const char* start = p;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    p++;
+  }
+
+  const uint64_t maxMantissa = (uint64_t)1 << 53;
+  uint64_t mantissa = 0;
+  int exponent = 0;
+  bool exact = true;
+  bool hasDigits = false;
+  auto addDigit = [&](char c) {
+    hasDigits = true;
+    if (mantissa > (maxMantissa - 9) / 10) {
+      exact = false;
+    }
+    else {
+      mantissa = mantissa * 10 + (c - '0');
+    }
+  };
+  while (p < end && isDigit(*p)) {
+    addDigit(*p++);
+    if (!exact) {
+      exponent++;
+    }
+  }
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && isDigit(*p)) {
+      addDigit(*p++);
+      if (exact) {
+        exponent--;
+      }
+    }
+  }
+  if (!hasDigits) {
+    return parseDoubleSlow(start, end, value);
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negativeExponent = (*p == '-');
+      p++;
+    }
+    if (p == end || !isDigit(*p)) {
+      return parseDoubleSlow(start, end, value);
+    }
+    int e = 0;
+    while (p < end && isDigit(*p)) {
+      e = std::min(e * 10 + (*p++ - '0'), 100000);
+    }
+    exponent += negativeExponent ? -e : e;
+  }
+
+  if (!exact || exponent < -22 || exponent > 22) {
+    return parseDoubleSlow(start, end, value);
+  }
+  double result = (double)mantissa;
+  result = (exponent < 0) ? result / powersOf10[-exponent]
+                          : result * powersOf10[exponent];
+  *value = negative ? -result : result;
+  return p;
+}
+
+/// Parse a positive integer coordinate. Returns the end of the coordinate, or
+/// nullptr if there is none or it is out of range.
+static const char* parseCoordinate(const char* p, const char* end,
+                                   long long* coordinate) {
+  if (p == end || !isDigit(*p)) {
+    return nullptr;
+  }
+  long long result = 0;
+  while (p < end && isDigit(*p)) {
+    result = result * 10 + (*p++ - '0');
+    if (result > INT_MAX) {
+      return nullptr;
+    }
+  }
+  *coordinate = result;
+  return (result > 0) ? p : nullptr;
+}
+
+/// Parse a coordinate line into 0-based coordinates and a value. Returns false
+/// if the line is malformed.
+static bool parseLine(const char* p, const char* end, size_t order,
+                      int* coordinates, double* value) {
+  for (size_t i = 0; i < order; i++) {
+    long long coordinate;
+    p = parseCoordinate(skipBlanks(p, end), end, &coordinate);
+    if (p == nullptr) {
+      return false;
+    }
+    coordinates[i] = (int)coordinate - 1;
+  }
+  return parseDouble(skipBlanks(p, end), end, value) != nullptr;
+}
+
+std::vector<int> parseEntries(const char* begin, const char* end, size_t order,
+                              std::vector<char>* entries) {
+  const size_t numBytes = end - begin;
+  const size_t numThreads = util::getNumThreads(numBytes, MIN_CHUNK_BYTES);
+  const size_t entrySize = order * sizeof(int) + sizeof(double);
+  auto chunkStart = [&](size_t offset) {
+    return lineStart(begin + offset, begin, end);
+  };
+
+  // Count the lines of every chunk to find where its entries go
+  vector<size_t> offsets(numThreads + 1, 0);
+  util::parallelChunks(numBytes, numThreads,
+                       [&](size_t t, size_t first, size_t last) {
+    size_t count = 0;
+    const char* chunkEnd = chunkStart(last);
+    for (const char* p = chunkStart(first); p < chunkEnd;
+         p = nextLine(p, chunkEnd)) {
+      count += isDataLine(p, chunkEnd);
+    }
+    offsets[t + 1] = count;
+  });
+  for (size_t t = 0; t < numThreads; t++) {
+    offsets[t + 1] += offsets[t];
+  }
+  const size_t previousSize = entries->size();
+  entries->resize(previousSize + offsets[numThreads] * entrySize);
+
+  // Parse every chunk into its entries
+  vector<vector<int>> maxCoordinates(numThreads, vector<int>(order, 0));
+  atomic<bool> valid(true);
+  char* data = entries->data() + previousSize;
+  util::parallelChunks(numBytes, numThreads,
+                       [&](size_t t, size_t first, size_t last) {
+    vector<int>& maxCoordinate = maxCoordinates[t];
+    char* entry = data + offsets[t] * entrySize;
+    const char* chunkEnd = chunkStart(last);
+    for (const char* p = chunkStart(first); p < chunkEnd;
+         p = nextLine(p, chunkEnd)) {
+      if (!isDataLine(p, chunkEnd)) {
+        continue;
+      }
+      int* coordinates = (int*)entry;
+      double value;
+      if (!parseLine(p, chunkEnd, order, coordinates, &value)) {
+        valid = false;
+        return;
+      }
+      for (size_t i = 0; i < order; i++) {
+        maxCoordinate[i] = std::max(maxCoordinate[i], coordinates[i] + 1);
+      }
+      memcpy(entry + order * sizeof(int), &value, sizeof(double));
+      entry += entrySize;
+    }
+  });
+  taco_uassert(valid) << MALFORMED_LINE;
+
+  vector<int> dimensions(order, 0);
+  for (auto& maxCoordinate : maxCoordinates) {
+    for (size_t i = 0; i < order; i++) {
+      dimensions[i] = std::max(dimensions[i], maxCoordinate[i]);
+    }
+  }
+  return dimensions;
+}
+
+bool parseSortedEntries(const char* begin, const char* end,
+                        const std::vector<size_t>& modeOrdering,
+                        StorageBuilder* builder) {
+  const size_t order = modeOrdering.size();
+  const size_t entrySize = order * sizeof(int) + sizeof(double);
+  const size_t numThreads = util::getNumThreads(end - begin, MIN_CHUNK_BYTES);
+  const size_t roundBytes = numThreads * MIN_CHUNK_BYTES;
+
+  // Every round parses a chunk on each thread into entries whose coordinates
+  // are in the order of the levels, and then appends the chunks in order
+  vector<vector<char>> chunks(numThreads);
+  for (const char* round = begin; round < end;) {
+    const char* roundEnd = ((size_t)(end - round) > roundBytes)
+                           ? lineStart(round + roundBytes, round, end) : end;
+    atomic<bool> valid(true);
+    util::parallelChunks(roundEnd - round, numThreads,
+                         [&](size_t t, size_t first, size_t last) {
+      vector<char>& entries = chunks[t];
+      entries.clear();
+      vector<int> coordinates(order);
+      double value;
+      const char* chunkEnd = lineStart(round + last, round, roundEnd);
+      for (const char* p = lineStart(round + first, round, roundEnd);
+           p < chunkEnd; p = nextLine(p, chunkEnd)) {
+        if (!isDataLine(p, chunkEnd)) {
+          continue;
+        }
+        if (!parseLine(p, chunkEnd, order, coordinates.data(), &value)) {
+          valid = false;
+          return;
+        }
+        entries.resize(entries.size() + entrySize);
+        char* entry = &entries[entries.size() - entrySize];
+        for (size_t i = 0; i < order; i++) {
+          ((int*)entry)[i] = coordinates[modeOrdering[i]];
+        }
+        memcpy(entry + order * sizeof(int), &value, sizeof(double));
+      }
+    });
+    taco_uassert(valid) << MALFORMED_LINE;
+
+    for (const vector<char>& entries : chunks) {
+      for (size_t e = 0; e < entries.size(); e += entrySize) {
+        if (!builder->append((const int*)&entries[e],
+                             &entries[e + order * sizeof(int)])) {
+          return false;
+        }
+      }
+    }
+    round = roundEnd;
+  }
+  return true;
+}
+
+}}
@@ -0,0 +1,84 @@
+#ifndef TACO_STORAGE_TEXT_PARSER_H
+#define TACO_STORAGE_TEXT_PARSER_H
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "taco/util/uncopyable.h"
+
+namespace taco {
+namespace util {
+class FileStream;
+}
+namespace storage {
+class StorageBuilder;
+
+/// The contents of a file, in blocks of whole lines. Uncompressed files are
+/// mapped read-only as a single block. Compressed files are decompressed by a
+/// gzip, pigz or zstd process (see util::FileStream) into blocks of about
+/// `blockBytes`, and the block after the current one is decompressed on
+/// another thread while the current one is parsed, so at most two blocks of
+/// text are held at once. A line longer than a block makes a larger block.
+class FileContents : util::Uncopyable {
+public:
+  /// The default size of the blocks of compressed files.
+  static const size_t BLOCK_BYTES;
+
+  FileContents(std::string filename, size_t blockBytes=BLOCK_BYTES);
+  ~FileContents();
+
+  /// The current block, which is the first block after construction.
+  const char* begin() const;
+  const char* end() const;
+
+  /// Move to the next block. Returns false, and keeps the current block, if
+  /// the file has no more blocks.
+  bool next();
+
+  /// Move back to the first block, which decompresses the file again.
+  void rewind();
+
+private:
+  std::string filename;
+  size_t      blockBytes;
+  char*       data;
+  size_t      size;
+
+  std::unique_ptr<util::FileStream> stream;
+  std::vector<char>                 current;
+  std::vector<char>                 following;
+  std::vector<char>                 partialLine;
+  std::thread                       reader;
+
+  void open();
+  void readFollowing();
+  void finishReading();
+};
+
+/// Returns the start of the line after the one that contains `pos`, or `end`.
+const char* nextLine(const char* pos, const char* end);
+
+/// Parse the coordinate lines in [begin, end) of a text file in parallel. Each
+/// line holds `order` 1-based integer coordinates followed by a real value,
+/// separated by spaces or tabs, and blank lines and lines that start with '%'
+/// or '#' are skipped. The file is split into newline-aligned chunks that are
+/// counted, and then parsed straight into entries of TensorBase::getEntrySize()
+/// bytes with double values, which are appended to `entries`. Returns the
+/// largest 1-based coordinate of each mode, which are zero without entries.
+std::vector<int> parseEntries(const char* begin, const char* end, size_t order,
+                              std::vector<char>* entries);
+
+/// Parse the coordinate lines in [begin, end), like parseEntries, and append
+/// them to `builder` in order, with level i holding mode `modeOrdering[i]`.
+/// The text is parsed in rounds of a newline-aligned chunk of about a
+/// megabyte per thread, which are parsed in parallel and then appended on one
+/// thread, so only a round of entries is held besides the builder. Returns
+/// false as soon as a component is out of order.
+bool parseSortedEntries(const char* begin, const char* end,
+                        const std::vector<size_t>& modeOrdering,
+                        StorageBuilder* builder);
+
+}}
+#endif
@@ -0,0 +1,261 @@
+#include "text_writer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "taco/tensor.h"
+#include "taco/format.h"
+#include "taco/error.h"
+#include "taco/storage/storage.h"
+#include "taco/storage/index.h"
+#include "taco/storage/array.h"
+#include "taco/util/parallel.h"
+#include "index_array.h"
+
+using namespace std;
+
+namespace taco {
+namespace storage {
+
+/// The number of components a thread formats at a time.
+static const size_t BLOCK_SIZE = (1 << 16);
+
+/// The number of bytes of text buffered before it is written.
+static const size_t FLUSH_SIZE = (1 << 20);
+
+TextBuffer::TextBuffer(int precision)
+    : precision(precision),
+      maxInteger(std::min(1e15, std::pow(10.0, std::max(precision, 1)))) {
+}
+
+void TextBuffer::append(long long value) {
+  char digits[24];
+  char* end = digits + sizeof(digits);
+  char* begin = end;
+  unsigned long long magnitude = (value < 0) ? -(unsigned long long)value
+                                             : (unsigned long long)value;
+  do {
+    *--begin = '0' + (magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude > 0);
+  if (value < 0) {
+    *--begin = '-';
+  }
+  buffer.append(begin, end - begin);
+}
+
+void TextBuffer::append(double value) {
+  // Integers with at most `precision` digits are formatted like %g formats
+  // them, without the cost of printf
+  if (std::fabs(value) < maxInteger && value == (double)(long long)value &&
+      !(value == 0 && std::signbit(value))) {
+    append((long long)value);
+    return;
+  }
+  char text[64];
+  int size = snprintf(text, sizeof(text), "%.*g", precision, value);
+  buffer.append(text, std::min((size_t)size, sizeof(text) - 1));
+}
+
+size_t TextBuffer::size() const {
+  return buffer.size();
+}
+
+void TextBuffer::flush(std::ostream& stream) {
+  stream.write(buffer.data(), buffer.size());
+  buffer.clear();
+}
+
+/// Returns true if the levels of `format` can be walked by a ComponentWalker.
+static bool canWalk(const Format& format) {
+  for (ModeType modeType : format.getModeTypes()) {
+    if (modeType != Dense && modeType != Sparse && modeType != Singleton) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Walks the stored components of a tensor whose levels are dense, sparse or
+/// singleton levels in the order of their value positions, starting at any
+/// position. The positions of the levels above a component are found by
+/// binary searches when seeking, and kept up to date as the walker advances.
+class ComponentWalker {
+public:
+  ComponentWalker(const TensorBase& tensor)
+      : order(tensor.getOrder()),
+        modeTypes(tensor.getFormat().getModeTypes()),
+        modeOrdering(tensor.getFormat().getModeOrdering()),
+        positions(order), coordinates(order) {
+    const Index& index = tensor.getStorage().getIndex();
+    for (size_t l = 0; l < order; l++) {
+      const ModeIndex modeIndex = index.getModeIndex(l);
+      const Array& first = modeIndex.getIndexArray(0);
+      const Array& last =
+          modeIndex.getIndexArray(modeIndex.numIndexArrays() - 1);
+      pos.push_back(IndexArrayReader(first));
+      idx.push_back(IndexArrayReader(last));
+      sizes.push_back(first.getSize());
+      dimensions.push_back((modeTypes[l] == Dense) ? (size_t)pos[l][0] : 0);
+    }
+  }
+
+  /// Move to the component at value position `position`.
+  void seek(size_t position) {
+    if (order == 0) {
+      return;
+    }
+    positions[order-1] = position;
+    for (size_t l = order-1; l > 0; l--) {
+      positions[l-1] = findParent(l, positions[l]);
+    }
+    for (size_t l = 0; l < order; l++) {
+      setCoordinate(l);
+    }
+  }
+
+  /// Move to the component at the next value position.
+  void next() {
+    if (order == 0) {
+      return;
+    }
+    positions[order-1]++;
+    for (size_t l = order-1; ; l--) {
+      setCoordinate(l);
+      if (l == 0) {
+        break;
+      }
+      size_t parent = positions[l-1];
+      switch (modeTypes[l]) {
+        case Dense:
+          parent = positions[l] / dimensions[l];
+          break;
+        case Sparse:
+          while ((size_t)pos[l][parent + 1] <= positions[l]) {
+            parent++;
+          }
+          break;
+        default:
+          parent = positions[l];
+          break;
+      }
+      if (parent == positions[l-1]) {
+        break;
+      }
+      positions[l-1] = parent;
+    }
+  }
+
+  /// The coordinates of the component, in the order of the modes.
+  const vector<long long>& getCoordinates() const {
+    return coordinates;
+  }
+
+private:
+  size_t           order;
+  vector<ModeType> modeTypes;
+  vector<size_t>   modeOrdering;
+
+  vector<IndexArrayReader> pos;
+  vector<IndexArrayReader> idx;
+  vector<size_t>           sizes;
+  vector<size_t>           dimensions;
+
+  vector<size_t>    positions;
+  vector<long long> coordinates;
+
+  size_t findParent(size_t level, size_t position) const {
+    switch (modeTypes[level]) {
+      case Dense:
+        return position / dimensions[level];
+      case Sparse: {
+        // The last segment whose start is at most the position
+        size_t low = 0;
+        size_t high = sizes[level] - 1;
+        while (high - low > 1) {
+          size_t middle = low + (high - low) / 2;
+          if ((size_t)pos[level][middle] <= position) {
+            low = middle;
+          }
+          else {
+            high = middle;
+          }
+        }
+        return low;
+      }
+      default:
+        return position;
+    }
+  }
+
+  void setCoordinate(size_t level) {
+    coordinates[modeOrdering[level]] = (modeTypes[level] == Dense)
+        ? (long long)(positions[level] % dimensions[level])
+        : idx[level][positions[level]];
+  }
+};
+
+static void appendLine(TextBuffer* text, const vector<long long>& coordinates,
+                       double value, bool writeCoordinates) {
+  if (writeCoordinates) {
+    for (long long coordinate : coordinates) {
+      text->append(coordinate + 1);
+      text->append(' ');
+    }
+  }
+  text->append(value);
+  text->append('\n');
+}
+
+void writeComponents(std::ostream& stream, const TensorBase& tensor,
+                     bool writeCoordinates) {
+  const int precision = (int)stream.precision();
+  const Storage& storage = tensor.getStorage();
+  if (!canWalk(tensor.getFormat())) {
+    TextBuffer text(precision);
+    vector<long long> coordinates(tensor.getOrder());
+    for (auto& component : iterate<double>(tensor)) {
+      copy(component.first.begin(), component.first.end(),
+           coordinates.begin());
+      appendLine(&text, coordinates, component.second, writeCoordinates);
+      if (text.size() >= FLUSH_SIZE) {
+        text.flush(stream);
+      }
+    }
+    text.flush(stream);
+    return;
+  }
+
+  // Every round formats a block of positions on each thread, and then writes
+  // the blocks in order
+  const double* values = (const double*)storage.getValues().getData();
+  const size_t numValues = storage.getValues().getSize();
+  const size_t numThreads = util::getNumThreads(numValues, BLOCK_SIZE);
+  vector<TextBuffer> blocks(numThreads, TextBuffer(precision));
+  for (size_t round = 0; round < numValues;
+       round += numThreads * BLOCK_SIZE) {
+    const size_t roundSize = min(numThreads * BLOCK_SIZE, numValues - round);
+    util::parallelChunks(roundSize, numThreads,
+                         [&](size_t t, size_t begin, size_t end) {
+      if (begin == end) {
+        return;
+      }
+      ComponentWalker walker(tensor);
+      walker.seek(round + begin);
+      for (size_t p = round + begin; p < round + end; p++) {
+        if (p > round + begin) {
+          walker.next();
+        }
+        appendLine(&blocks[t], walker.getCoordinates(), values[p],
+                   writeCoordinates);
+      }
+    });
+    for (auto& block : blocks) {
+      block.flush(stream);
+    }
+  }
+}
+
+}}
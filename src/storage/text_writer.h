@@ -0,0 +1,51 @@
+#ifndef TACO_STORAGE_TEXT_WRITER_H
+#define TACO_STORAGE_TEXT_WRITER_H
+
+#include <ostream>
+#include <string>
+
+namespace taco {
+class TensorBase;
+namespace storage {
+
+/// A buffer that numbers are formatted into without going through a stream.
+/// Reals are formatted like a stream with the given precision and default
+/// flags formats them.
+class TextBuffer {
+public:
+  TextBuffer(int precision);
+
+  void append(char c) {
+    buffer.push_back(c);
+  }
+
+  void append(const char* text, size_t size) {
+    buffer.append(text, size);
+  }
+
+  void append(long long value);
+  void append(double value);
+
+  size_t size() const;
+
+  /// Write the buffer to `stream` and clear it.
+  void flush(std::ostream& stream);
+
+private:
+  std::string buffer;
+  int         precision;
+  double      maxInteger;
+};
+
+/// Write the components of `tensor` to `stream` one per line, as the 1-based
+/// coordinates of the component followed by its value if `writeCoordinates`
+/// is set, and as its value otherwise. The components are written in the
+/// order of the tensor iterator. Tensors whose levels are dense, sparse or
+/// singleton levels are read straight from their index arrays and formatted
+/// in parallel, in rounds of blocks of positions whose text is written in
+/// order.
+void writeComponents(std::ostream& stream, const TensorBase& tensor,
+                     bool writeCoordinates);
+
+}}
+#endif
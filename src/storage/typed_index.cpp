@@ -52,7 +52,7 @@ void TypedIndex::set(IndexTypeUnion& mem, const IndexTypeUnion& value) {
     case DataType::Undefined: taco_ierror; return;  }
 }
 
-void TypedIndex::setInt(IndexTypeUnion& mem, const int value) {
+void TypedIndex::setInt(IndexTypeUnion& mem, const long long value) {
   switch (dType.getKind()) {
     case DataType::UInt8: mem.uint8Value = value; break;
     case DataType::UInt16: mem.uint16Value = value; break;
@@ -188,7 +188,7 @@ void TypedIndexVal::set(TypedIndexRef value) {
   TypedIndex::set(val, value.get());
 }
 
-void TypedIndexVal::set(int constant) {
+void TypedIndexVal::set(long long constant) {
   TypedIndex::setInt(val, constant);
 }
 
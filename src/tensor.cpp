@@ -5,17 +5,23 @@
 #include <fstream>
 #include <sstream>
 #include <limits.h>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
 
 #include "taco/tensor.h"
 #include "taco/format.h"
 #include "taco/index_notation/index_notation.h"
 #include "taco/index_notation/index_notation_nodes.h"
 #include "taco/index_notation/index_notation_visitor.h"
+#include "taco/index_notation/index_notation_rewriter.h"
 #include "taco/storage/storage.h"
 #include "taco/storage/index.h"
 #include "taco/storage/array.h"
 #include "taco/storage/array_util.h"
 #include "taco/storage/pack.h"
+#include "taco/storage/convert.h"
+#include "taco/storage/allocator.h"
 #include "taco/ir/ir.h"
 #include "taco/lower/lower.h"
 #include "lower/iteration_graph.h"
@@ -24,9 +30,11 @@
 #include "taco/storage/file_io_tns.h"
 #include "taco/storage/file_io_mtx.h"
 #include "taco/storage/file_io_rb.h"
+#include "taco/storage/file_io_taco.h"
 #include "taco/util/strings.h"
 #include "taco/util/timers.h"
 #include "taco/util/name_generator.h"
+#include "taco/util/files.h"
 #include "taco/error/error_messages.h"
 #include "error/error_checks.h"
 #include "taco/storage/typed_vector.h"
@@ -55,6 +63,52 @@ struct TensorBase::Content {
   Stmt                  computeFunc;
   bool                  assembleWhileCompute;
   shared_ptr<Module>    module;
+
+  /// True if the compiled compute kernel assembles the tensor as well, which
+  /// it does not while a fixed structure is kept even if it was compiled to
+  bool                  computeAssembles = false;
+
+  /// True if the kernels compute other tensors as well
+  bool                  computedTogether = false;
+
+  /// The assignment the kernels compute the tensor with, if they compute other
+  /// tensors as well, which reads the operands of temporaries inlined into it
+  Assignment            compiledAssignment;
+
+  /// True if the assignment has not been computed since it was set
+  bool                  needsCompute = false;
+
+  /// True if pack narrows the index types of the tensor
+  bool                  narrowIndices = false;
+
+  /// The format the tensor was declared with, before narrowing
+  Format                declaredFormat;
+
+  /// The index types of the operands the kernels were compiled for
+  vector<vector<vector<DataType>>> compiledIndexTypes;
+
+  /// True if the kernels assume the arrays of the tensors are aligned
+  bool                  compiledAligned = false;
+
+  /// True if the structure of the tensor is kept once it has been assembled
+  bool                  fixedStructure = false;
+
+  /// True if the tensor has been assembled since it was last packed
+  bool                  assembled = false;
+
+  /// The number of bytes of inserted coordinates pack releases at a time
+  size_t                packBudget = (1 << 24);
+
+  /// The tensor the assignment copies into the format or mode order of this
+  /// tensor, and the mode of it that each mode of this tensor is. Such copies
+  /// are computed by converting the storage of the tensor instead of kernels.
+  shared_ptr<TensorBase> conversionSource;
+  vector<int>           conversionModeOrdering;
+  bool                  conversionCompiled = false;
+
+  /// True if the conversion was computed by assembling the tensors it is
+  /// compiled together with, and not since
+  bool                  conversionAssembled = false;
 };
 
 TensorBase::TensorBase() : TensorBase(Float()) {
@@ -106,6 +160,17 @@ TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
           arrayTypes.push_back(Int32);
           break;
         case ModeType::Fixed:
+        case ModeType::Diagonal:
+          arrayTypes.push_back(Int32);
+          arrayTypes.push_back(Int32);
+          break;
+        case ModeType::Singleton:
+          arrayTypes.push_back(Int32);
+          break;
+        case ModeType::Hashed:
+        case ModeType::Bitmap:
+        case ModeType::Packed:
+          arrayTypes.push_back(Int32);
           arrayTypes.push_back(Int32);
           arrayTypes.push_back(Int32);
           break;
@@ -115,8 +180,31 @@ TensorBase::TensorBase(string name, DataType ctype, vector<int> dimensions,
     format.setLevelArrayTypes(levelArrayTypes);
   }
 
+  // Sparse and singleton modes may store their index arrays with narrower or
+  // wider integers, as long as the coordinates of the mode fit
+  for (size_t i = 0; i < format.getOrder(); ++i) {
+    const ModeType modeType = format.getModeTypes()[i];
+    const bool isConfigurable = (modeType == ModeType::Sparse ||
+                                 modeType == ModeType::Singleton);
+    for (DataType arrayType : format.getLevelArrayTypes()[i]) {
+      taco_uassert(isConfigurable ? ((arrayType.isInt() || arrayType.isUInt()) &&
+                                     arrayType.getNumBits() <= 64)
+                                  : arrayType == Int32)
+          << error::format_index_type;
+    }
+    if (isConfigurable) {
+      const DataType idxType = format.getCoordinateTypeIdx(i);
+      const size_t maxCoordinate = idxType.isInt()
+          ? (size_t)INT64_MAX >> (64 - idxType.getNumBits())
+          : (size_t)UINT64_MAX >> (64 - idxType.getNumBits());
+      const size_t dimension = dimensions[format.getModeOrdering()[i]];
+      taco_uassert(dimension <= maxCoordinate + 1) << error::format_index_width;
+    }
+  }
+
   content->name = name;
   content->dimensions = dimensions;
+  content->declaredFormat = format;
   content->storage = Storage(format);
   content->ctype = ctype;
   this->setAllocSize(DEFAULT_ALLOC_SIZE);
@@ -190,6 +278,24 @@ void TensorBase::reserve(size_t numCoordinates) {
   this->coordinateBuffer->resize(newSize);
 }
 
+size_t TensorBase::getEntrySize() const {
+  return this->coordinateSize;
+}
+
+void TensorBase::insertEntries(std::vector<char>&& entries) {
+  taco_uassert(entries.size() % this->coordinateSize == 0) <<
+      "The entry buffer does not hold a whole number of entries";
+  if (this->coordinateBufferUsed == 0) {
+    this->coordinateBuffer->swap(entries);
+    this->coordinateBufferUsed = this->coordinateBuffer->size();
+    return;
+  }
+  this->coordinateBuffer->resize(this->coordinateBufferUsed);
+  this->coordinateBuffer->insert(this->coordinateBuffer->end(),
+                                 entries.begin(), entries.end());
+  this->coordinateBufferUsed = this->coordinateBuffer->size();
+}
+
 const DataType& TensorBase::getComponentType() const {
   return content->ctype;
 }
@@ -216,6 +322,71 @@ size_t TensorBase::getAllocSize() const {
   return content->allocSize;
 }
 
+void TensorBase::setIndexNarrowing(bool narrow) {
+  content->narrowIndices = narrow;
+}
+
+bool TensorBase::getIndexNarrowing() const {
+  return content->narrowIndices;
+}
+
+void TensorBase::setPackBudget(size_t budget) {
+  content->packBudget = budget;
+}
+
+size_t TensorBase::getPackBudget() const {
+  return content->packBudget;
+}
+
+void TensorBase::setFixedStructure(bool fixed) {
+  content->fixedStructure = fixed;
+}
+
+bool TensorBase::getFixedStructure() const {
+  return content->fixedStructure;
+}
+
+/// Returns the narrowest index type that can store values up to `maxValue`.
+static DataType narrowestIndexType(size_t maxValue) {
+  if (maxValue <= UINT8_MAX) {
+    return UInt8;
+  }
+  if (maxValue <= UINT16_MAX) {
+    return UInt16;
+  }
+  return (maxValue <= INT32_MAX) ? Int32 : Int64;
+}
+
+/// Returns `format` with the index arrays of its sparse and singleton modes
+/// narrowed to fit the dimensions of the modes and `numCoordinates` entries.
+static Format narrowIndexTypes(const Format& format,
+                               const vector<int>& dimensions,
+                               size_t numCoordinates) {
+  vector<vector<DataType>> levelArrayTypes = format.getLevelArrayTypes();
+  for (size_t i = 0; i < format.getOrder(); ++i) {
+    const size_t dimension = dimensions[format.getModeOrdering()[i]];
+    const DataType idxType = narrowestIndexType(max(dimension, (size_t)1) - 1);
+    switch (format.getModeTypes()[i]) {
+      case ModeType::Sparse:
+        levelArrayTypes[i] = {narrowestIndexType(numCoordinates), idxType};
+        break;
+      case ModeType::Singleton:
+        levelArrayTypes[i] = {idxType};
+        break;
+      case ModeType::Dense:
+      case ModeType::Fixed:
+      case ModeType::Hashed:
+      case ModeType::Bitmap:
+      case ModeType::Diagonal:
+      case ModeType::Packed:
+        break;
+    }
+  }
+  Format narrowed = format;
+  narrowed.setLevelArrayTypes(levelArrayTypes);
+  return narrowed;
+}
+
 static size_t numIntegersToCompare = 0;
 static int lexicographicalCmp(const void* a, const void* b) {
   for (size_t i = 0; i < numIntegersToCompare; i++) {
@@ -227,6 +398,38 @@ static int lexicographicalCmp(const void* a, const void* b) {
   return 0;
 }
 
+/// Sort entries of `entrySize` bytes lexicographically by their first
+/// numIntegersToCompare ints, keeping entries with the same coordinates in
+/// the order they were inserted. The order of the entries is sorted stably,
+/// and the entries are then moved in place along the cycles of that order.
+static void stableSortEntries(char* entries, size_t numEntries,
+                              size_t entrySize) {
+  vector<size_t> sorted(numEntries);
+  for (size_t i = 0; i < numEntries; ++i) {
+    sorted[i] = i;
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [&](size_t a, size_t b) {
+    return lexicographicalCmp(&entries[a*entrySize], &entries[b*entrySize]) < 0;
+  });
+
+  vector<char> entry(entrySize);
+  for (size_t i = 0; i < numEntries; ++i) {
+    if (sorted[i] == i) {
+      continue;
+    }
+    memcpy(entry.data(), &entries[i*entrySize], entrySize);
+    size_t j = i;
+    while (sorted[j] != i) {
+      memcpy(&entries[j*entrySize], &entries[sorted[j]*entrySize], entrySize);
+      size_t next = sorted[j];
+      sorted[j] = j;
+      j = next;
+    }
+    memcpy(&entries[j*entrySize], entry.data(), entrySize);
+    sorted[j] = j;
+  }
+}
+
 /// Pack coordinates into a data structure given by the tensor format.
 void TensorBase::pack() {
   const size_t order = getOrder();
@@ -272,20 +475,56 @@ void TensorBase::pack() {
   }
   coordinatesPtr = coordinateBuffer->data();  
   
-  // The pack code expects the coordinates to be sorted
+  // The pack code expects the coordinates to be sorted, and duplicates stay
+  // in the order they were inserted
   numIntegersToCompare = order;
-  qsort(coordinatesPtr, numCoordinates, coordSize, lexicographicalCmp);
+  stableSortEntries(coordinatesPtr, numCoordinates, coordSize);
+
+  // Remove duplicates in place, keeping the first inserted of each coordinate
+  size_t numUnique = 0;
+  for (size_t i = 0; i < numCoordinates; ++i) {
+    char* entry = &coordinatesPtr[i*coordSize];
+    if (numUnique > 0 && memcmp(entry, &coordinatesPtr[(numUnique-1)*coordSize],
+                                order*sizeof(int)) == 0) {
+      continue;
+    }
+    if (numUnique != i) {
+      memcpy(&coordinatesPtr[numUnique*coordSize], entry, coordSize);
+    }
+    numUnique++;
+  }
+  if (numUnique < numCoordinates) {
+    taco_uwarning << "Duplicate coordinate ignored when inserting into tensor";
+  }
+  numCoordinates = numUnique;
   
+  Format format = content->narrowIndices
+      ? narrowIndexTypes(content->declaredFormat, dimensions, numCoordinates)
+      : getFormat();
+
+  // Pack the entries straight from the coordinate buffer, which is released
+  // as it is packed
+  if (storage::canPackEntries(format)) {
+    content->storage = storage::packEntries(permutedDimensions, format,
+                                            coordinatesPtr, numCoordinates,
+                                            coordSize, getComponentType(),
+                                            content->packBudget);
+    content->tensorVar.setFormat(format);
+    vector<char>().swap(*this->coordinateBuffer);
+    this->coordinateBufferUsed = 0;
+    content->assembled = false;
+    return;
+  }
 
   // Move coords into separate arrays and remove duplicates
   std::vector<TypedIndexVector> coordinates(order);
   for (size_t i=0; i < order; ++i) {
-    coordinates[i] = TypedIndexVector(getFormat().getCoordinateTypeIdx(i), numCoordinates);
+    coordinates[i] = TypedIndexVector(format.getCoordinateTypeIdx(i), numCoordinates);
   }
   char* values = (char*) malloc(numCoordinates * getComponentType().getNumBytes());
   // Copy first coordinate-value pair
   int* lastCoord = (int*)malloc(order * sizeof(int));
-  int j = 1;
+  size_t j = 1;
   if (numCoordinates >= 1) {
     int* coordComponent = (int*)coordinatesPtr;
     for (size_t d=0; d < order; ++d) {
@@ -329,16 +568,61 @@ void TensorBase::pack() {
     values = (char *) realloc(values, (j) * getComponentType().getNumBytes());
   }
   taco_iassert(coordinates.size() > 0);
-  this->coordinateBuffer->clear();
-  this->coordinateBufferUsed = 0;
+  content->assembled = false;
+
+  // The coordinate buffer and the coordinates and values being packed are
+  // live alongside the packed storage
+  size_t packingBytes = coordinateBuffer->capacity() +
+                        j * getComponentType().getNumBytes();
+  for (auto& modeCoordinates : coordinates) {
+    packingBytes += modeCoordinates.size() *
+                    modeCoordinates.getType().getNumBytes();
+  }
+  recordAllocation(packingBytes);
 
   // Pack indices and values
-  content->storage = storage::pack(permutedDimensions, getFormat(),
+  content->storage = storage::pack(permutedDimensions, format,
                                    coordinates, (void *) values, j, getComponentType());
+  content->tensorVar.setFormat(format);
+  recordDeallocation(packingBytes);
 
+  vector<char>().swap(*this->coordinateBuffer);
+  this->coordinateBufferUsed = 0;
   free(values);
 }
 
+void TensorBase::pack(const TensorBase& source,
+                      const std::vector<int>& modeOrdering) {
+  taco_uassert(source.getComponentType() == getComponentType())
+      << error::convert_component_type;
+  taco_uassert(source.getOrder() == getOrder() &&
+               modeOrdering.size() == getOrder())
+      << error::convert_mode_ordering;
+  vector<bool> isConverted(getOrder(), false);
+  for (size_t i = 0; i < getOrder(); ++i) {
+    const int mode = modeOrdering[i];
+    taco_uassert(mode >= 0 && mode < (int)getOrder() && !isConverted[mode] &&
+                 source.getDimension(mode) == getDimension(i))
+        << error::convert_mode_ordering;
+    isConverted[mode] = true;
+  }
+  const Storage& storage = source.getStorage();
+  taco_uassert(storage.getValues().getType().getKind() != DataType::Undefined)
+      << error::convert_unpacked_source;
+
+  // The stored components of the source bound the number of coordinates
+  Format format = content->narrowIndices
+      ? narrowIndexTypes(content->declaredFormat, getDimensions(),
+                         storage.getValues().getSize())
+      : getFormat();
+  content->storage = storage::convert(storage, source.getDimensions(),
+                                      modeOrdering, format);
+  content->tensorVar.setFormat(format);
+  vector<char>().swap(*this->coordinateBuffer);
+  this->coordinateBufferUsed = 0;
+  content->assembled = false;
+}
+
 void TensorBase::zero() {
   getStorage().getValues().zero();
 }
@@ -368,12 +652,40 @@ Access TensorBase::operator()(const std::vector<IndexVar>& indices) {
   return Access(new AccessTensorNode(*this, indices));
 }
 
+static vector<vector<vector<DataType>>> getIndexTypes(const TensorBase& tensor);
+static bool canAssumeAlignment(const TensorBase& tensor);
+static void getPendingOperands(const TensorBase& tensor,
+                               set<TensorBase>* visited,
+                               vector<TensorBase>* pending);
+
 void TensorBase::compile(bool assembleWhileCompute) {
+  if (content->conversionSource) {
+    content->conversionCompiled = true;
+    return;
+  }
+
   TensorVar tensorVar = getTensorVar();
 
   taco_uassert(tensorVar.getAssignment().defined())
       << error::compile_without_expr;
 
+  // Results are assembled with the index types they were declared with, since
+  // the types narrowed for a previous pack may not fit the computed result
+  if (content->narrowIndices && getFormat().getLevelArrayTypes() !=
+                                content->declaredFormat.getLevelArrayTypes()) {
+    const Format& format = content->declaredFormat;
+    vector<ModeIndex> modeIndices(format.getOrder());
+    for (size_t i = 0; i < format.getOrder(); ++i) {
+      if (format.getModeTypes()[i] == ModeType::Dense) {
+        const size_t idx = format.getModeOrdering()[i];
+        modeIndices[i] = ModeIndex({makeArray({getDimension(idx)})});
+      }
+    }
+    content->storage = Storage(format);
+    content->storage.setIndex(Index(format, modeIndices));
+    tensorVar.setFormat(format);
+  }
+
   std::set<lower::Property> assembleProperties, computeProperties;
   assembleProperties.insert(lower::Assemble);
   computeProperties.insert(lower::Compute);
@@ -382,13 +694,33 @@ void TensorBase::compile(bool assembleWhileCompute) {
   }
 
   content->assembleWhileCompute = assembleWhileCompute;
+  content->computeAssembles = assembleWhileCompute;
+  content->computedTogether = false;
   content->assembleFunc = lower::lower(tensorVar, "assemble",
                                        assembleProperties, getAllocSize());
   content->computeFunc  = lower::lower(tensorVar, "compute",
                                        computeProperties, getAllocSize());
+  content->compiledAligned = canAssumeAlignment(*this);
+  content->module = make_shared<Module>();
+  content->module->setArrayAlignment(content->compiledAligned
+                                     ? ARRAY_ALIGNMENT : 0);
   content->module->addFunction(content->assembleFunc);
   content->module->addFunction(content->computeFunc);
   content->module->compile();
+  content->compiledIndexTypes = getIndexTypes(*this);
+}
+
+TensorBase TensorBase::sortHashedModes() const {
+  if (!isHashed(getFormat())) {
+    return *this;
+  }
+  Storage storage = storage::sortHashedModes(getStorage());
+  TensorBase tensor(getName() + "_sorted", getComponentType(), getDimensions(),
+                    storage.getFormat());
+  tensor.content->storage.setIndex(storage.getIndex());
+  tensor.content->storage.setValues(storage.getValues());
+  tensor.content->valuesSize = storage.getValues().getSize();
+  return tensor;
 }
 
 /// Pack the tensor's indices and values into a taco_tensor_t object.
@@ -440,9 +772,67 @@ static taco_tensor_t* packTensorData(const TensorBase& tensor) {
         tensorData->indices[i][1] = (uint8_t*)idx.getData();
       }
         break;
-      case ModeType::Fixed:
-        taco_not_supported_yet;
+      case ModeType::Singleton: {
+        tensorData->mode_types[i] = taco_mode_singleton;
+        tensorData->indices[i]    = (uint8_t**)malloc(1 * sizeof(uint8_t**));
+
+        if (modeIndex.numIndexArrays() == 0) {
+          continue;
+        }
+
+        const Array& idx = modeIndex.getIndexArray(0);
+        tensorData->indices[i][0] = (uint8_t*)idx.getData();
+        break;
+      }
+      case ModeType::Hashed: {
+        tensorData->mode_types[i] = taco_mode_hashed;
+        tensorData->indices[i]    = (uint8_t**)malloc(3 * sizeof(uint8_t**));
+
+        // Results that are being assembled start out without a hash table
+        if (modeIndex.numIndexArrays() == 0) {
+          tensorData->indices[i][0] = NULL;
+          tensorData->indices[i][1] = NULL;
+          tensorData->indices[i][2] = NULL;
+          continue;
+        }
+
+        for (size_t j = 0; j < 3; j++) {
+          tensorData->indices[i][j] =
+              (uint8_t*)modeIndex.getIndexArray(j).getData();
+        }
+        break;
+      }
+      case ModeType::Bitmap:
+      case ModeType::Packed: {
+        tensorData->mode_types[i] = (modeType == ModeType::Bitmap)
+                                    ? taco_mode_bitmap : taco_mode_packed;
+        tensorData->indices[i]    = (uint8_t**)malloc(3 * sizeof(uint8_t**));
+        for (size_t j = 0; j < 3; j++) {
+          tensorData->indices[i][j] =
+              (uint8_t*)modeIndex.getIndexArray(j).getData();
+        }
         break;
+      }
+      case ModeType::Fixed: {
+        tensorData->mode_types[i] = taco_mode_fixed;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+
+        const Array& size = modeIndex.getIndexArray(0);
+        const Array& idx = modeIndex.getIndexArray(1);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        tensorData->indices[i][1] = (uint8_t*)idx.getData();
+        break;
+      }
+      case ModeType::Diagonal: {
+        tensorData->mode_types[i] = taco_mode_diagonal;
+        tensorData->indices[i]    = (uint8_t**)malloc(2 * sizeof(uint8_t**));
+
+        const Array& size = modeIndex.getIndexArray(0);
+        const Array& offsets = modeIndex.getIndexArray(1);
+        tensorData->indices[i][0] = (uint8_t*)size.getData();
+        tensorData->indices[i][1] = (uint8_t*)offsets.getData();
+        break;
+      }
     }
   }
 
@@ -474,6 +864,9 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
   auto storage = tensor.getStorage();
   auto format = storage.getFormat();
 
+  // The kernels allocated the arrays with the current allocator
+  const Allocator allocator = getAllocator();
+
   vector<ModeIndex> modeIndices;
   size_t numVals = 1;
   for (size_t i = 0; i < tensor.getOrder(); i++) {
@@ -486,20 +879,63 @@ static size_t unpackTensorData(const taco_tensor_t& tensorData,
         break;
       }
       case ModeType::Sparse: {
-        auto size = ((int*)tensorData.indices[i][0])[numVals];
-        Array pos = Array(type<int>(), tensorData.indices[i][0], numVals+1);
-        Array idx = Array(type<int>(), tensorData.indices[i][1], size);
+        DataType posType = format.getCoordinateTypePos(i);
+        DataType idxType = format.getCoordinateTypeIdx(i);
+        auto size = TypedIndexVal(posType, tensorData.indices[i][0] +
+                                  numVals * posType.getNumBytes()).getAsIndex();
+        Array pos = Array(posType, tensorData.indices[i][0], numVals+1,
+                          allocator);
+        Array idx = Array(idxType, tensorData.indices[i][1], size, allocator);
         modeIndices.push_back(ModeIndex({pos, idx}));
         numVals = size;
         break;
       }
-      case ModeType::Fixed:
+      case ModeType::Singleton: {
+        Array idx = Array(format.getCoordinateTypeIdx(i),
+                          tensorData.indices[i][0], numVals, allocator);
+        modeIndices.push_back(ModeIndex({idx}));
+        break;
+      }
+      case ModeType::Hashed: {
+        // Nothing was inserted if the assembly never created a hash table
+        if (tensorData.indices[i][0] == NULL) {
+          Array size = makeArray({0, 0});
+          Array crd = makeArray(type<int>(), 0);
+          Array par = makeArray(type<int>(), 0);
+          modeIndices.push_back(ModeIndex({size, crd, par}));
+          numVals = 0;
+          break;
+        }
+        auto capacity = ((int*)tensorData.indices[i][0])[0];
+        Array size = Array(type<int>(), tensorData.indices[i][0], 2, allocator);
+        Array crd = Array(type<int>(), tensorData.indices[i][1], capacity,
+                          allocator);
+        Array par = Array(type<int>(), tensorData.indices[i][2], capacity,
+                          allocator);
+        modeIndices.push_back(ModeIndex({size, crd, par}));
+        numVals = capacity;
+        break;
+      }
+      case ModeType::Fixed: {
+        // Every parent position has the same number of (padded) coordinates
+        auto size = ((int*)tensorData.indices[i][0])[0];
+        Array fixedSize = makeArray({size});
+        Array idx = Array(type<int>(), tensorData.indices[i][1], numVals*size,
+                          allocator);
+        modeIndices.push_back(ModeIndex({fixedSize, idx}));
+        numVals *= size;
+        break;
+      }
+      case ModeType::Bitmap:
+      case ModeType::Diagonal:
+      case ModeType::Packed:
         taco_not_supported_yet;
         break;
     }
   }
   storage.setIndex(Index(format, modeIndices));
-  storage.setValues(Array(tensor.getComponentType(), tensorData.vals, numVals));
+  storage.setValues(Array(tensor.getComponentType(), tensorData.vals, numVals,
+                          allocator));
   return numVals;
 }
 
@@ -522,6 +958,82 @@ static inline vector<TensorBase> getTensors(const IndexExpr& expr) {
   return getOperands.operands;
 }
 
+/// Returns the index types of the operands of the tensor's assignment.
+static vector<vector<vector<DataType>>> getIndexTypes(const TensorBase& tensor) {
+  vector<vector<vector<DataType>>> indexTypes;
+  for (auto& operand : getTensors(tensor.getTensorVar().getAssignment().getRhs())) {
+    indexTypes.push_back(operand.getFormat().getLevelArrayTypes());
+  }
+  return indexTypes;
+}
+
+/// Returns true if the arrays of the tensor that kernels access through
+/// pointers, which are all arrays except the sizes of dense, fixed and
+/// diagonal levels, are aligned.
+static bool hasAlignedArrays(const TensorBase& tensor) {
+  auto isAligned = [](const Array& array) {
+    return (uintptr_t)array.getData() % ARRAY_ALIGNMENT == 0;
+  };
+  const Storage& storage = tensor.getStorage();
+  const Format& format = storage.getFormat();
+  const Index& index = storage.getIndex();
+  for (size_t i = 0; i < index.numModeIndices(); ++i) {
+    const ModeType modeType = format.getModeTypes()[i];
+    const bool hasSize = (modeType == ModeType::Dense ||
+                          modeType == ModeType::Fixed ||
+                          modeType == ModeType::Diagonal);
+    const ModeIndex& modeIndex = index.getModeIndex(i);
+    for (size_t j = hasSize ? 1 : 0; j < modeIndex.numIndexArrays(); ++j) {
+      if (!isAligned(modeIndex.getIndexArray(j))) {
+        return false;
+      }
+    }
+  }
+  return isAligned(storage.getValues());
+}
+
+/// Returns true if kernels computing the tensor may assume the arrays of the
+/// tensor and its operands are aligned, which they are if they and the arrays
+/// the kernels allocate come from an aligned allocator.
+static bool canAssumeAlignment(const TensorBase& tensor) {
+  if (!isAligned(getAllocator()) || !hasAlignedArrays(tensor)) {
+    return false;
+  }
+  for (auto& operand : getTensors(tensor.getTensorVar().getAssignment().getRhs())) {
+    if (!hasAlignedArrays(operand)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Discard the hash tables of a result, so that assembling it inserts into new
+/// tables instead of the tables of a previous assembly.
+static void clearHashedModes(const TensorBase& tensor) {
+  Storage storage = tensor.getStorage();
+  Format format = storage.getFormat();
+  if (!isHashed(format)) {
+    return;
+  }
+  vector<ModeIndex> modeIndices;
+  for (size_t i = 0; i < format.getOrder(); i++) {
+    modeIndices.push_back(format.getModeTypes()[i] == ModeType::Hashed
+                          ? ModeIndex()
+                          : storage.getIndex().getModeIndex(i));
+  }
+  storage.setIndex(Index(format, modeIndices));
+}
+
+/// Asserts that the tensors the assignment of `tensor` reads, other than the
+/// tensor itself, have been computed since their assignments were set.
+static void checkOperandsComputed(const TensorBase& tensor) {
+  for (auto& operand :
+           getTensors(tensor.getTensorVar().getAssignment().getRhs())) {
+    taco_uassert(operand == tensor || !operand.needsCompute())
+        << error::compute_pending_operand;
+  }
+}
+
 static inline
 vector<void*> packArguments(const TensorBase& tensor) {
   vector<void*> arguments;
@@ -539,41 +1051,801 @@ vector<void*> packArguments(const TensorBase& tensor) {
 }
 
 void TensorBase::assemble() {
+  // Conversions assemble and compute the tensor together in compute
+  if (content->conversionSource) {
+    taco_uassert(content->conversionCompiled)
+        << error::assemble_without_compile;
+    return;
+  }
+
   taco_uassert(this->content->assembleFunc.defined())
       << error::assemble_without_compile;
+  taco_uassert(!content->computedTogether) << error::compute_without_others;
+  checkOperandsComputed(*this);
 
+  // Tensors with fixed structure keep the index and value arrays they have
+  if (content->fixedStructure && content->assembled) {
+    return;
+  }
+
+  // Operands whose index types were narrowed, or whose arrays may no longer be
+  // aligned, since compiling need new kernels
+  if (getIndexTypes(*this) != content->compiledIndexTypes ||
+      (content->compiledAligned && !canAssumeAlignment(*this))) {
+    compile(content->assembleWhileCompute);
+  }
+
+  clearHashedModes(*this);
   auto arguments = packArguments(*this);
   content->module->callFuncPacked("assemble", arguments.data());
 
   if (!content->assembleWhileCompute) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
+    content->assembled = true;
   }
   for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
 }
 
 void TensorBase::compute() {
+  if (content->conversionSource) {
+    taco_uassert(content->conversionCompiled)
+        << error::compute_without_compile;
+    taco_uassert(!content->conversionSource->needsCompute())
+        << error::compute_pending_operand;
+    pack(*content->conversionSource, content->conversionModeOrdering);
+    content->needsCompute = false;
+    return;
+  }
+
   taco_uassert(this->content->computeFunc.defined())
       << error::compute_without_compile;
+  taco_uassert(!content->computedTogether) << error::compute_without_others;
+  checkOperandsComputed(*this);
+
+  // Operands whose index types were narrowed, or whose arrays may no longer be
+  // aligned, since compiling need new kernels. Tensors with fixed structure
+  // that have been assembled are computed into their value arrays by kernels
+  // that do not assemble, and go back to kernels that do once it is not kept.
+  const bool keepStructure = content->fixedStructure && content->assembled;
+  const bool assembles = content->assembleWhileCompute && !keepStructure;
+  if (getIndexTypes(*this) != content->compiledIndexTypes ||
+      (content->compiledAligned && !canAssumeAlignment(*this)) ||
+      assembles != content->computeAssembles) {
+    const bool assembleWhileCompute = content->assembleWhileCompute;
+    compile(assembles);
+    content->assembleWhileCompute = assembleWhileCompute;
+  }
 
   auto arguments = packArguments(*this);
   this->content->module->callFuncPacked("compute", arguments.data());
+  content->needsCompute = false;
 
-  if (content->assembleWhileCompute) {
+  if (content->computeAssembles) {
     taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[0]);
     content->valuesSize = unpackTensorData(*tensorData, *this);
+    content->assembled = true;
   }
   for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
 }
 
 void TensorBase::evaluate() {
+  if (getTensorVar().getAssignment().defined()) {
+    set<TensorBase> visited;
+    vector<TensorBase> pending;
+    getPendingOperands(*this, &visited, &pending);
+    for (auto& operand : pending) {
+      operand.evaluate();
+    }
+  }
+
   this->compile();
-  if (!getTensorVar().getAssignment().getOp().defined()) {
+  if (content->conversionSource ||
+      !getTensorVar().getAssignment().getOp().defined()) {
     this->assemble();
   }
   this->compute();
 }
 
+void compile(const vector<TensorBase>& tensors, bool assembleWhileCompute) {
+  vector<Assignment> assignments;
+  for (auto& tensor : tensors) {
+    assignments.push_back(tensor.getTensorVar().getAssignment());
+  }
+  compile(tensors, assignments, assembleWhileCompute);
+}
+
+/// Returns the tensor that a conversion copies.
+static TensorBase getCopiedTensor(const TensorBase& conversion) {
+  IndexExpr rhs = conversion.getTensorVar().getAssignment().getRhs();
+  return to<AccessTensorNode>(rhs.ptr)->tensor;
+}
+
+/// Returns the tensors among `tensors` that are computed by their kernels.
+static vector<TensorBase> getKernelTensors(const vector<TensorBase>& tensors) {
+  vector<TensorBase> kernelTensors;
+  for (auto& tensor : tensors) {
+    if (!tensor.isConversion()) {
+      kernelTensors.push_back(tensor);
+    }
+  }
+  return kernelTensors;
+}
+
+/// Returns the copies among `tensors` of tensors that their kernels compute,
+/// directly or through other such copies, which are converted after the
+/// kernels run. The other copies are converted before.
+static set<TensorBase> getCopiesOfResults(const vector<TensorBase>& tensors) {
+  vector<TensorBase> kernelTensors = getKernelTensors(tensors);
+  set<TensorBase> results(kernelTensors.begin(), kernelTensors.end());
+  set<TensorBase> copies;
+  for (auto& tensor : tensors) {
+    if (tensor.isConversion() &&
+        util::contains(results, getCopiedTensor(tensor))) {
+      results.insert(tensor);
+      copies.insert(tensor);
+    }
+  }
+  return copies;
+}
+
+void compile(const vector<TensorBase>& tensors,
+             const vector<Assignment>& assignments,
+             bool assembleWhileCompute) {
+  taco_uassert(!tensors.empty()) << "No tensors to compile";
+  taco_iassert(tensors.size() == assignments.size());
+
+  // Copies into a different format or mode order are converted before or
+  // after the kernels run instead of being computed by them
+  const set<TensorBase> copiesOfResults = getCopiesOfResults(tensors);
+  IndexStmt stmt;
+  set<TensorBase> inserted;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const TensorBase& tensor = tensors[i];
+    taco_uassert(assignments[i].defined()) << error::compile_without_expr;
+    taco_uassert(!util::contains(inserted, tensor))
+        << "Tensor " << tensor.getName() << " is compiled more than once";
+    inserted.insert(tensor);
+    if (tensor.isConversion()) {
+      continue;
+    }
+    for (auto& operand : getTensors(assignments[i].getRhs())) {
+      taco_uassert(!util::contains(copiesOfResults, operand))
+          << "Tensor " << tensor.getName() << " reads " << operand.getName()
+          << ", a copy of a tensor it is computed together with";
+    }
+    stmt = stmt.defined() ? multi(stmt, assignments[i])
+                          : IndexStmt(assignments[i]);
+  }
+
+  std::set<lower::Property> assembleProperties, computeProperties;
+  assembleProperties.insert(lower::Assemble);
+  computeProperties.insert(lower::Compute);
+  if (assembleWhileCompute) {
+    computeProperties.insert(lower::Assemble);
+  }
+
+  Stmt assembleFunc, computeFunc;
+  shared_ptr<Module> module = make_shared<Module>();
+  if (stmt.defined()) {
+    size_t allocSize = tensors[0].getAllocSize();
+    assembleFunc = lower::lower(stmt, "assemble", assembleProperties,
+                                allocSize);
+    computeFunc = lower::lower(stmt, "compute", computeProperties, allocSize);
+    module->addFunction(assembleFunc);
+    module->addFunction(computeFunc);
+    module->compile();
+  }
+
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const TensorBase& tensor = tensors[i];
+    tensor.content->assembleWhileCompute = assembleWhileCompute;
+    tensor.content->computeAssembles = assembleWhileCompute;
+    tensor.content->assembleFunc = assembleFunc;
+    tensor.content->computeFunc = computeFunc;
+    tensor.content->compiledAssignment = assignments[i];
+    tensor.content->module = module;
+    tensor.content->computedTogether = true;
+    tensor.content->conversionCompiled = true;
+    tensor.content->conversionAssembled = false;
+  }
+}
+
+/// Asserts that the tensors that `tensors` read, other than each other, have
+/// been computed since their assignments were set.
+static void checkOperandsComputed(const vector<TensorBase>& tensors,
+                                  const vector<Assignment>& assignments) {
+  set<TensorBase> computed(tensors.begin(), tensors.end());
+  for (auto& assignment : assignments) {
+    for (auto& operand : getTensors(assignment.getRhs())) {
+      taco_uassert(util::contains(computed, operand) ||
+                   !operand.needsCompute())
+          << error::compute_pending_operand;
+    }
+  }
+}
+
+/// Pack the tensors the kernels compute, followed by the operands of their
+/// compiled assignments that they do not compute.
+static inline
+vector<void*> packArguments(const vector<TensorBase>& tensors,
+                            const vector<Assignment>& assignments) {
+  vector<void*> arguments;
+  set<TensorBase> inserted;
+  for (auto& tensor : tensors) {
+    arguments.push_back(packTensorData(tensor));
+    inserted.insert(tensor);
+  }
+  for (auto& assignment : assignments) {
+    for (auto& operand : getTensors(assignment.getRhs())) {
+      if (!util::contains(inserted, operand)) {
+        arguments.push_back(packTensorData(operand));
+        inserted.insert(operand);
+      }
+    }
+  }
+  return arguments;
+}
+
+void assemble(const vector<TensorBase>& tensors) {
+  taco_uassert(!tensors.empty()) << "No tensors to assemble";
+  shared_ptr<Module> module = tensors[0].content->module;
+  vector<Assignment> assignments;
+  for (auto& tensor : tensors) {
+    taco_uassert(tensor.content->compiledAssignment.defined())
+        << error::assemble_without_compile;
+    taco_uassert(tensor.content->computedTogether &&
+                 tensor.content->module == module)
+        << error::compute_without_others;
+    assignments.push_back(tensor.content->compiledAssignment);
+  }
+  checkOperandsComputed(tensors, assignments);
+
+  // Copies that the kernels read are converted first, since their structure
+  // is assembled from
+  const set<TensorBase> copiesOfResults = getCopiesOfResults(tensors);
+  for (TensorBase tensor : tensors) {
+    if (tensor.isConversion() && !util::contains(copiesOfResults, tensor)) {
+      tensor.compute();
+      tensor.content->conversionAssembled = true;
+    }
+  }
+
+  vector<TensorBase> kernelTensors = getKernelTensors(tensors);
+  if (kernelTensors.empty()) {
+    return;
+  }
+  vector<Assignment> kernelAssignments;
+  for (auto& tensor : kernelTensors) {
+    clearHashedModes(tensor);
+    kernelAssignments.push_back(tensor.content->compiledAssignment);
+  }
+  auto arguments = packArguments(kernelTensors, kernelAssignments);
+  module->callFuncPacked("assemble", arguments.data());
+
+  for (size_t i = 0; i < kernelTensors.size(); ++i) {
+    TensorBase tensor = kernelTensors[i];
+    if (!tensor.content->assembleWhileCompute) {
+      taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[i]);
+      tensor.content->valuesSize = unpackTensorData(*tensorData, tensor);
+    }
+  }
+  for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
+}
+
+void compute(const vector<TensorBase>& tensors) {
+  taco_uassert(!tensors.empty()) << "No tensors to compute";
+  shared_ptr<Module> module = tensors[0].content->module;
+  vector<Assignment> assignments;
+  for (auto& tensor : tensors) {
+    taco_uassert(tensor.content->compiledAssignment.defined())
+        << error::compute_without_compile;
+    taco_uassert(tensor.content->computedTogether &&
+                 tensor.content->module == module)
+        << error::compute_without_others;
+    assignments.push_back(tensor.content->compiledAssignment);
+  }
+  checkOperandsComputed(tensors, assignments);
+
+  // Copies the kernels read are converted before they run, unless they were
+  // converted by assemble, and copies of their results after
+  const set<TensorBase> copiesOfResults = getCopiesOfResults(tensors);
+  for (TensorBase tensor : tensors) {
+    if (tensor.isConversion() && !util::contains(copiesOfResults, tensor) &&
+        !tensor.content->conversionAssembled) {
+      tensor.compute();
+    }
+    tensor.content->conversionAssembled = false;
+  }
+
+  vector<TensorBase> kernelTensors = getKernelTensors(tensors);
+  if (!kernelTensors.empty()) {
+    vector<Assignment> kernelAssignments;
+    for (auto& tensor : kernelTensors) {
+      kernelAssignments.push_back(tensor.content->compiledAssignment);
+    }
+    auto arguments = packArguments(kernelTensors, kernelAssignments);
+    module->callFuncPacked("compute", arguments.data());
+
+    for (size_t i = 0; i < kernelTensors.size(); ++i) {
+      TensorBase tensor = kernelTensors[i];
+      tensor.content->needsCompute = false;
+      if (tensor.content->computeAssembles) {
+        taco_tensor_t* tensorData = ((taco_tensor_t*)arguments[i]);
+        tensor.content->valuesSize = unpackTensorData(*tensorData, tensor);
+      }
+    }
+    for (auto& argument : arguments) freeTensorData((taco_tensor_t*)argument);
+  }
+
+  for (TensorBase tensor : tensors) {
+    if (util::contains(copiesOfResults, tensor)) {
+      tensor.compute();
+    }
+  }
+}
+
+/// Assemble and compute tensors that are compiled together as needed.
+static void assembleAndCompute(const vector<TensorBase>& tensors) {
+  size_t compound = 0;
+  vector<TensorBase> kernelTensors = getKernelTensors(tensors);
+  for (auto& tensor : kernelTensors) {
+    if (tensor.getTensorVar().getAssignment().getOp().defined()) {
+      compound++;
+    }
+  }
+  taco_uassert(compound == 0 || compound == kernelTensors.size())
+      << "Tensors with compound assignments must be evaluated separately from "
+      << "tensors with plain assignments";
+  if (compound == 0) {
+    assemble(tensors);
+  }
+  compute(tensors);
+}
+
+void evaluate(const vector<TensorBase>& tensors) {
+  compile(tensors);
+  assembleAndCompute(tensors);
+}
+
+/// Returns the terms of the top-level sum of an expression.
+static vector<IndexExpr> getTerms(const IndexExpr& expr) {
+  if (isa<AddNode>(expr.ptr)) {
+    return util::combine(getTerms(to<AddNode>(expr.ptr)->a),
+                         getTerms(to<AddNode>(expr.ptr)->b));
+  }
+  else if (isa<SubNode>(expr.ptr)) {
+    return util::combine(getTerms(to<SubNode>(expr.ptr)->a),
+                         getTerms(to<SubNode>(expr.ptr)->b));
+  }
+  return {expr};
+}
+
+/// Returns the accesses of tensors in an expression.
+static vector<const AccessTensorNode*> getAccesses(const IndexExpr& expr) {
+  vector<const AccessTensorNode*> accesses;
+  match(expr,
+    function<void(const AccessNode*)>([&](const AccessNode* op) {
+      accesses.push_back(to<AccessTensorNode>(op));
+    })
+  );
+  return accesses;
+}
+
+/// Returns the right-hand side of a tensor's assignment rewritten to compute
+/// the values read by `access`: the free variables of the assignment are
+/// replaced by the index variables of the access and the reduction variables
+/// by new index variables.
+static IndexExpr inlineAssignment(const Assignment& assignment,
+                                  const AccessTensorNode* access) {
+  struct Inliner : public IndexNotationRewriter {
+    using IndexNotationRewriter::visit;
+    map<IndexVar,IndexVar> vars;
+
+    void visit(const AccessNode* op) {
+      vector<IndexVar> indexVars;
+      for (auto& indexVar : op->indexVars) {
+        indexVars.push_back(vars.at(indexVar));
+      }
+      expr = to<AccessTensorNode>(op)->tensor(indexVars);
+    }
+
+    void visit(const ReductionNode* op) {
+      IndexVar var;
+      vars.insert({op->var, var});
+      expr = new ReductionNode(op->op, var, rewrite(op->a));
+    }
+  };
+
+  Inliner inliner;
+  auto& freeVars = assignment.getFreeVars();
+  for (size_t i = 0; i < freeVars.size(); ++i) {
+    inliner.vars.insert({freeVars[i], access->indexVars[i]});
+  }
+  return inliner.rewrite(assignment.getRhs());
+}
+
+/// Returns the right-hand side of the consumer's assignment with the access
+/// replaced by the right-hand side of the accessed temporary's assignment, or
+/// an undefined expression if the access pattern does not allow it.
+/// Temporaries with reductions are only inlined into the top-level sum (e.g.
+/// `t(i) = B(i,j)*c(j); a(i) = t(i) + d(i)`), and temporaries without
+/// reductions are inlined outside of reductions.
+static IndexExpr inlineTemporary(const TensorBase& consumer,
+                                 const Assignment& assignment,
+                                 const Assignment& temporaryAssignment,
+                                 const AccessTensorNode* access) {
+  IndexExpr rhs = assignment.getRhs();
+  if (temporaryAssignment.getOp().defined() ||
+      set<IndexVar>(access->indexVars.begin(), access->indexVars.end()).size()
+          != access->indexVars.size()) {
+    return IndexExpr();
+  }
+
+  bool hasReductions = false;
+  match(temporaryAssignment.getRhs(),
+    function<void(const ReductionNode*)>([&](const ReductionNode* op) {
+      hasReductions = true;
+    })
+  );
+  if (hasReductions) {
+    if (!util::contains(getTerms(rhs), IndexExpr(access))) {
+      return IndexExpr();
+    }
+  }
+  else {
+    bool inReduction = false;
+    match(rhs,
+      function<void(const ReductionNode*)>([&](const ReductionNode* op) {
+        for (auto& reducedAccess : getAccesses(op->a)) {
+          inReduction = inReduction || (reducedAccess == access);
+        }
+      })
+    );
+    if (inReduction) {
+      return IndexExpr();
+    }
+  }
+
+  IndexExpr inlined = replace(rhs, {{access,
+                                     inlineAssignment(temporaryAssignment,
+                                                      access)}});
+  if (error::containsTranspose(consumer.getFormat(),
+                               assignment.getFreeVars(), inlined)) {
+    return IndexExpr();
+  }
+  return inlined;
+}
+
+/// Collects the tensors with assignments that have not been computed that
+/// `tensor` (transitively) reads, such that they precede their readers.
+static void getPendingOperands(const TensorBase& tensor,
+                               set<TensorBase>* visited,
+                               vector<TensorBase>* pending) {
+  visited->insert(tensor);
+  for (auto& operand : getTensors(tensor.getTensorVar().getAssignment().getRhs())) {
+    if (!util::contains(*visited, operand) &&
+        operand.getTensorVar().getAssignment().defined() &&
+        operand.needsCompute()) {
+      getPendingOperands(operand, visited, pending);
+      pending->push_back(operand);
+    }
+  }
+}
+
+vector<TensorBase> TensorBase::evaluateLazily() {
+  taco_uassert(getTensorVar().getAssignment().defined())
+      << error::compile_without_expr;
+
+  set<TensorBase> visited;
+  vector<TensorBase> pending;
+  getPendingOperands(*this, &visited, &pending);
+
+  // Inline temporaries that are read once into copies of the assignments that
+  // read them, starting with the temporaries read by this tensor. Conversions
+  // are neither inlined nor inlined into, since they are not kernels.
+  vector<TensorBase> readers = {*this};
+  readers.insert(readers.end(), pending.rbegin(), pending.rend());
+  map<TensorBase,Assignment> assignments;
+  for (auto& reader : readers) {
+    assignments.insert({reader, reader.getTensorVar().getAssignment()});
+  }
+  vector<TensorBase> eliminated;
+  for (size_t i = 0; i < readers.size(); ++i) {
+    TensorBase reader = readers[i];
+    if (util::contains(eliminated, reader) || reader.isConversion()) {
+      continue;
+    }
+    bool inlined = true;
+    while (inlined) {
+      inlined = false;
+      Assignment assignment = assignments.at(reader);
+      for (auto& access : getAccesses(assignment.getRhs())) {
+        TensorBase temporary = access->tensor;
+        if (!util::contains(pending, temporary) ||
+            util::contains(eliminated, temporary) ||
+            temporary.isConversion()) {
+          continue;
+        }
+        size_t numReads = 0;
+        for (auto& other : readers) {
+          if (util::contains(eliminated, other)) continue;
+          for (auto& otherAccess :
+               getAccesses(assignments.at(other).getRhs())) {
+            numReads += (otherAccess->tensor == temporary);
+          }
+        }
+        if (numReads != 1) {
+          continue;
+        }
+        IndexExpr rhs = inlineTemporary(reader, assignment,
+                                        assignments.at(temporary), access);
+        if (rhs.defined()) {
+          assignments.at(reader) =
+              makeReductionNotation(Assignment(assignment.getLhs(), rhs,
+                                               assignment.getOp()));
+          eliminated.push_back(temporary);
+          inlined = true;
+          break;
+        }
+      }
+    }
+  }
+
+  // Compute the remaining temporaries together with this tensor. Copies of
+  // tensors that are computed together are converted after the kernels, so
+  // the tensors before a copy of one of them are evaluated first.
+  vector<TensorBase> tensors;
+  vector<Assignment> tensorAssignments;
+  for (auto& tensor : util::combine(pending, vector<TensorBase>({*this}))) {
+    if (util::contains(eliminated, tensor)) {
+      continue;
+    }
+    if (tensor.isConversion() &&
+        util::contains(tensors, *tensor.content->conversionSource)) {
+      taco::compile(tensors, tensorAssignments);
+      assembleAndCompute(tensors);
+      tensors.clear();
+      tensorAssignments.clear();
+    }
+    tensors.push_back(tensor);
+    tensorAssignments.push_back(assignments.at(tensor));
+  }
+  taco::compile(tensors, tensorAssignments);
+  assembleAndCompute(tensors);
+  return eliminated;
+}
+
+/// Returns the fraction of the tensor components that are stored, which is one
+/// for tensors that have not been computed.
+static double getDensity(const TensorBase& tensor) {
+  double size = 1.0;
+  for (int dimension : tensor.getDimensions()) {
+    size *= dimension;
+  }
+  if (tensor.needsCompute() || size == 0.0) {
+    return 1.0;
+  }
+  double nnz = (double)tensor.getStorage().getIndex().getSize();
+  return std::max(nnz, 1.0) / size;
+}
+
+vector<TensorBase> TensorBase::optimizeContractionOrder() {
+  Assignment assignment = getTensorVar().getAssignment();
+  taco_uassert(assignment.defined()) << error::compile_without_expr;
+  if (assignment.getOp().defined()) {
+    return {};
+  }
+
+  // Match a sum of a product of three or more tensors
+  IndexExpr expr = assignment.getRhs();
+  while (isa<ReductionNode>(expr.ptr) &&
+         isa<AddNode>(to<ReductionNode>(expr.ptr)->op.ptr)) {
+    expr = to<ReductionNode>(expr.ptr)->a;
+  }
+  vector<const AccessTensorNode*> operands;
+  function<bool(const IndexExpr&)> getFactors = [&](const IndexExpr& factor) {
+    if (isa<MulNode>(factor.ptr)) {
+      return getFactors(to<MulNode>(factor.ptr)->a) &&
+             getFactors(to<MulNode>(factor.ptr)->b);
+    }
+    else if (isa<AccessNode>(factor.ptr)) {
+      operands.push_back(to<AccessTensorNode>(factor.ptr));
+      return true;
+    }
+    return false;
+  };
+  const size_t maxOperands = 8;
+  if (!getFactors(expr) || operands.size() < 3 ||
+      operands.size() > maxOperands) {
+    return {};
+  }
+
+  const size_t n = operands.size();
+  const size_t all = (1u << n) - 1;
+  const vector<IndexVar>& resultVars = assignment.getFreeVars();
+  map<IndexVar,double> dimensions;
+  for (auto& operand : operands) {
+    for (size_t i = 0; i < operand->indexVars.size(); ++i) {
+      dimensions[operand->indexVars[i]] = operand->tensor.getDimension(i);
+    }
+  }
+  auto getSize = [&](const set<IndexVar>& vars) {
+    double size = 1.0;
+    for (auto& var : vars) {
+      size *= dimensions.at(var);
+    }
+    return size;
+  };
+
+  // The index variables of the result of contracting a subset of the operands
+  // are the variables the other operands or the tensor are indexed by
+  vector<set<IndexVar>> vars(all + 1);
+  for (size_t subset = 1; subset <= all; ++subset) {
+    set<IndexVar> subsetVars, otherVars(resultVars.begin(), resultVars.end());
+    for (size_t k = 0; k < n; ++k) {
+      auto& indexVars = operands[k]->indexVars;
+      (((subset >> k) & 1) ? subsetVars : otherVars).insert(indexVars.begin(),
+                                                           indexVars.end());
+    }
+    for (auto& var : subsetVars) {
+      if ((subset & (subset - 1)) == 0 || util::contains(otherVars, var)) {
+        vars[subset].insert(var);
+      }
+    }
+  }
+
+  // Find the cheapest pairwise contraction order by dynamic programming over
+  // operand subsets. Contracting two sub-results costs an estimated number of
+  // multiplications given by their nonzeros and the variables they share,
+  // assuming their nonzeros are uniformly distributed.
+  vector<double> cost(all + 1, 0.0), nnz(all + 1, 0.0);
+  vector<size_t> split(all + 1, 0);
+  for (size_t subset = 1; subset <= all; ++subset) {
+    if ((subset & (subset - 1)) == 0) {
+      size_t k = 0;
+      while (((subset >> k) & 1) == 0) k++;
+      nnz[subset] = getDensity(operands[k]->tensor) * getSize(vars[subset]);
+      continue;
+    }
+    cost[subset] = INFINITY;
+    size_t lowest = subset & (~subset + 1);
+    for (size_t left = (subset - 1) & subset; left > 0;
+         left = (left - 1) & subset) {
+      if ((left & lowest) == 0) {
+        continue;
+      }
+      size_t right = subset ^ left;
+      set<IndexVar> shared;
+      for (auto& var : vars[left]) {
+        if (util::contains(vars[right], var)) {
+          shared.insert(var);
+        }
+      }
+      double work = nnz[left] * nnz[right] / getSize(shared);
+      double subsetCost = cost[left] + cost[right] + work;
+      if (subsetCost < cost[subset]) {
+        double size = getSize(vars[subset]);
+        cost[subset] = subsetCost;
+        nnz[subset] = size * (1.0 - std::exp(-work / size));
+        split[subset] = left;
+      }
+    }
+  }
+
+  // The single loop nest iterates over the joint iteration space of all the
+  // operands. Only rewrite the expression if contracting pairwise is cheaper
+  // by a margin that covers the cost of materializing temporaries.
+  double fusedCost = 1.0;
+  map<IndexVar,int> occurrences;
+  for (size_t k = 0; k < n; ++k) {
+    fusedCost *= nnz[1u << k];
+    for (auto& var : operands[k]->indexVars) {
+      if (occurrences[var]++ > 0) {
+        fusedCost /= dimensions.at(var);
+      }
+    }
+  }
+  const double margin = 2.0;
+  if (cost[all] * margin >= fusedCost) {
+    return {};
+  }
+
+  // Build the pairwise contractions, storing each intermediate result in a
+  // temporary. Temporaries are dense, except for sparse joins (contractions
+  // without reductions) that are estimated to be sparse.
+  const double maxSparseDensity = 0.05;
+  vector<TensorBase> temporaries;
+  vector<Assignment> temporaryAssignments;
+  function<IndexExpr(size_t)> contract = [&](size_t subset) -> IndexExpr {
+    if ((subset & (subset - 1)) == 0) {
+      size_t k = 0;
+      while (((subset >> k) & 1) == 0) k++;
+      return operands[k];
+    }
+    size_t left = split[subset];
+    size_t right = subset ^ left;
+    IndexExpr a = contract(left);
+    IndexExpr b = contract(right);
+    if (!a.defined() || !b.defined()) {
+      return IndexExpr();
+    }
+    IndexExpr product = a * b;
+    if (subset == all) {
+      return product;
+    }
+
+    // Order the temporary modes like the operands they are computed from
+    vector<IndexVar> temporaryVars;
+    for (size_t k = 0; k < n; ++k) {
+      if ((subset >> k) & 1) {
+        for (auto& var : operands[k]->indexVars) {
+          if (util::contains(vars[subset], var) &&
+              !util::contains(temporaryVars, var)) {
+            temporaryVars.push_back(var);
+          }
+        }
+      }
+    }
+
+    set<IndexVar> joinedVars = vars[left];
+    joinedVars.insert(vars[right].begin(), vars[right].end());
+    bool sparse = (joinedVars.size() == vars[subset].size() &&
+                   nnz[subset] < maxSparseDensity * getSize(vars[subset]));
+    vector<ModeType> modeTypes;
+    for (size_t i = 0; i < temporaryVars.size(); ++i) {
+      modeTypes.push_back((sparse && (i > 0 || temporaryVars.size() == 1))
+                          ? Sparse : Dense);
+    }
+    Format format(modeTypes);
+
+    // Reorder the modes if the temporary would otherwise be transposed
+    if (error::containsTranspose(format, temporaryVars, product)) {
+      vector<IndexVar> permutation = temporaryVars;
+      std::sort(permutation.begin(), permutation.end());
+      bool found = false;
+      do {
+        found = !error::containsTranspose(format, permutation, product);
+      } while (!found &&
+               std::next_permutation(permutation.begin(), permutation.end()));
+      if (!found) {
+        return IndexExpr();
+      }
+      temporaryVars = permutation;
+    }
+
+    vector<int> temporaryDimensions;
+    for (auto& var : temporaryVars) {
+      temporaryDimensions.push_back((int)dimensions.at(var));
+    }
+    TensorBase temporary(util::uniqueName('t'), getComponentType(),
+                         temporaryDimensions, format);
+    temporaries.push_back(temporary);
+    temporaryAssignments.push_back(Assignment(temporary(temporaryVars),
+                                              product));
+    return temporary(temporaryVars);
+  };
+
+  IndexExpr product = contract(all);
+  if (!product.defined() ||
+      error::containsTranspose(getFormat(), resultVars, product)) {
+    return {};
+  }
+  for (size_t i = 0; i < temporaries.size(); ++i) {
+    temporaries[i].setAssignment(temporaryAssignments[i]);
+  }
+  setAssignment(Assignment(assignment.getLhs(), product));
+  return temporaries;
+}
+
+bool TensorBase::needsCompute() const {
+  return content->needsCompute;
+}
+
+bool TensorBase::isConversion() const {
+  return content->conversionSource != nullptr;
+}
+
 void TensorBase::operator=(const IndexExpr& expr) {
   taco_uassert(getOrder() == 0)
       << "Must use index variable on the left-hand-side when assigning an "
@@ -581,8 +1853,72 @@ void TensorBase::operator=(const IndexExpr& expr) {
   setAssignment(Assignment(getTensorVar(), {}, expr));
 }
 
+/// Returns the tensor that `assignment` copies, if it only copies a tensor
+/// into the different format or mode order of `result`, and sets
+/// `modeOrdering` to the mode of the copied tensor that each result mode is.
+static shared_ptr<TensorBase> getConversionSource(const TensorBase& result,
+                                                  const Assignment& assignment,
+                                                  vector<int>* modeOrdering) {
+  // Like kernels, conversions only assign to dense, sparse and singleton modes
+  for (ModeType modeType : result.getFormat().getModeTypes()) {
+    if (modeType != ModeType::Dense && modeType != ModeType::Sparse &&
+        modeType != ModeType::Singleton) {
+      return nullptr;
+    }
+  }
+  if (assignment.getOp().defined() ||
+      !isa<AccessTensorNode>(assignment.getRhs().ptr)) {
+    return nullptr;
+  }
+  const AccessTensorNode* access = to<AccessTensorNode>(assignment.getRhs().ptr);
+  const TensorBase& source = access->tensor;
+  if (source == result ||
+      source.getComponentType() != result.getComponentType()) {
+    return nullptr;
+  }
+
+  const vector<IndexVar>& resultVars = assignment.getLhs().getIndexVars();
+  const vector<IndexVar>& sourceVars = access->indexVars;
+  if (resultVars.size() != sourceVars.size() ||
+      set<IndexVar>(sourceVars.begin(), sourceVars.end()).size() !=
+      sourceVars.size()) {
+    return nullptr;
+  }
+  vector<int> ordering;
+  bool isPermuted = false;
+  for (size_t i = 0; i < resultVars.size(); ++i) {
+    auto var = find(sourceVars.begin(), sourceVars.end(), resultVars[i]);
+    if (var == sourceVars.end() ||
+        source.getDimension(var - sourceVars.begin()) !=
+        result.getDimension(i)) {
+      return nullptr;
+    }
+    ordering.push_back((int)(var - sourceVars.begin()));
+    isPermuted = isPermuted || ordering[i] != (int)i;
+  }
+  if (!isPermuted &&
+      source.getFormat().getModeTypes() == result.getFormat().getModeTypes() &&
+      source.getFormat().getModeOrdering() ==
+      result.getFormat().getModeOrdering()) {
+    return nullptr;
+  }
+  *modeOrdering = ordering;
+  return make_shared<TensorBase>(source);
+}
+
 void TensorBase::setAssignment(Assignment assignment) {
+  // Copies into a different format or mode order are computed by converting
+  // the storage of the copied tensor, which also lets them transpose
+  content->conversionSource =
+      getConversionSource(*this, assignment, &content->conversionModeOrdering);
+  content->conversionCompiled = false;
+  taco_uassert(content->conversionSource ||
+               !error::containsTranspose(getFormat(),
+                                         assignment.getLhs().getIndexVars(),
+                                         assignment.getRhs()))
+      << error::expr_transposition;
   content->tensorVar.setAssignment(makeReductionNotation(assignment));
+  content->needsCompute = true;
 }
 
 void TensorBase::printComputeIR(ostream& os, bool color, bool simplify) const {
@@ -619,6 +1955,8 @@ void TensorBase::compileSource(std::string source) {
   CodeGen_C::generateShim(content->computeFunc, ss);
   content->module->setSource(source + "\n" + ss.str());
   content->module->compile();
+  content->compiledIndexTypes = getIndexTypes(*this);
+  content->compiledAligned = false;
 }
 
 template<typename T>
@@ -761,7 +2099,10 @@ ostream& operator<<(ostream& os, const TensorBase& tensor) {
   return os;
 }
 
+/// Returns the extension of the file type of a file, which precedes the
+/// extension of its compression if it is compressed.
 static string getExtension(string filename) {
+  filename = util::stripCompression(filename);
   return filename.substr(filename.find_last_of(".") + 1);
 }
 
@@ -779,6 +2120,9 @@ TensorBase dispatchRead(T& file, FileType filetype, Format format, bool pack) {
     case FileType::rb:
       tensor = readRB(file, format, pack);
       break;
+    case FileType::taco:
+      tensor = readTaco(file, format, pack);
+      break;
   }
   return tensor;
 }
@@ -799,6 +2143,9 @@ TensorBase read(std::string filename, Format format, bool pack) {
   else if (extension == "rb") {
     tensor = dispatchRead(filename, FileType::rb, format, pack);
   }
+  else if (extension == "taco") {
+    tensor = dispatchRead(filename, FileType::taco, format, pack);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
@@ -832,6 +2179,9 @@ void dispatchWrite(T& file, const TensorBase& tensor, FileType filetype) {
     case FileType::rb:
       writeRB(file, tensor);
       break;
+    case FileType::taco:
+      writeTaco(file, tensor);
+      break;
   }
 }
 
@@ -852,6 +2202,9 @@ void write(string filename, const TensorBase& tensor) {
   else if (extension == "rb") {
     dispatchWrite(filename, tensor, FileType::rb);
   }
+  else if (extension == "taco") {
+    dispatchWrite(filename, tensor, FileType::taco);
+  }
   else {
     taco_uerror << "File extension not recognized: " << filename << std::endl;
   }
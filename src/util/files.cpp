@@ -4,7 +4,9 @@
 
 #include <iostream>
 #include <fstream>
+#include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 using namespace std;
 
@@ -24,4 +26,165 @@ void openStream(std::fstream& stream, std::string path, fstream::openmode mode)
   taco_uassert(stream.is_open()) << "Error opening file: " << path;
 }
 
+Compression getCompression(std::string path) {
+  string extension = path.substr(path.find_last_of(".") + 1);
+  if (extension == "gz") {
+    return Compression::Gzip;
+  }
+  if (extension == "zst" || extension == "zstd") {
+    return Compression::Zstd;
+  }
+  return Compression::None;
+}
+
+std::string stripCompression(std::string path) {
+  return (getCompression(path) == Compression::None)
+      ? path : path.substr(0, path.find_last_of("."));
+}
+
+/// Returns true if `command` is installed.
+static bool hasCommand(string command) {
+  return system(("command -v " + command + " >/dev/null 2>&1").c_str()) == 0;
+}
+
+/// Returns the command that compresses, or decompresses, stdin or a file.
+static string getCommand(Compression compression, bool decompress) {
+  switch (compression) {
+    case Compression::Gzip: {
+      static const bool hasPigz = hasCommand("pigz");
+      return string(hasPigz ? "pigz" : "gzip") + (decompress ? " -dc" : " -c");
+    }
+    case Compression::Zstd:
+      return decompress ? "zstd -dcq" : "zstd -cq -T0";
+    case Compression::None:
+      break;
+  }
+  taco_ierror;
+  return "";
+}
+
+/// Quote `path` for the shell.
+static string quote(string path) {
+  string quoted = "'";
+  for (char c : path) {
+    quoted += (c == '\'') ? string("'\\''") : string(1, c);
+  }
+  return quoted + "'";
+}
+
+/// A stream buffer that reads from or writes to a process.
+class PipeBuffer : public std::streambuf {
+public:
+  PipeBuffer(FILE* pipe, bool input)
+      : pipe(pipe), input(input), buffer(1 << 16) {
+    char* begin = buffer.data();
+    if (input) {
+      setg(begin, begin, begin);
+    }
+    else {
+      setp(begin, begin + buffer.size());
+    }
+  }
+
+  ~PipeBuffer() {
+    close();
+  }
+
+  /// Flush the buffer and wait for the process, returning whether it
+  /// succeeded.
+  bool close() {
+    if (pipe == nullptr) {
+      return true;
+    }
+    // Drain the rest of the input, so the process does not fail writing it
+    bool flushed = (sync() == 0);
+    while (input && fread(buffer.data(), 1, buffer.size(), pipe) > 0) {
+    }
+    int status = pclose(pipe);
+    pipe = nullptr;
+    return flushed && status == 0;
+  }
+
+protected:
+  int_type underflow() {
+    size_t size = fread(buffer.data(), 1, buffer.size(), pipe);
+    if (size == 0) {
+      return traits_type::eof();
+    }
+    setg(buffer.data(), buffer.data(), buffer.data() + size);
+    return traits_type::to_int_type(*gptr());
+  }
+
+  int_type overflow(int_type c) {
+    if (sync() != 0) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() {
+    if (pbase() == nullptr) {
+      return 0;
+    }
+    size_t size = pptr() - pbase();
+    if (size > 0 && fwrite(pbase(), 1, size, pipe) != size) {
+      return -1;
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return 0;
+  }
+
+private:
+  FILE*        pipe;
+  bool         input;
+  vector<char> buffer;
+};
+
+FileStream::FileStream(std::string path, std::ios_base::openmode mode)
+    : std::iostream(nullptr), path(path),
+      compressed(getCompression(path) != Compression::None) {
+  const string filename = sanitizePath(path);
+  if (!compressed) {
+    std::filebuf* file = new std::filebuf();
+    buffer.reset(file);
+    taco_uassert(file->open(filename, mode) != nullptr) <<
+        "Error opening file: " << path;
+  }
+  else {
+    const bool input = (mode & ios_base::in);
+    if (input) {
+      FILE* file = fopen(filename.c_str(), "r");
+      taco_uassert(file != nullptr) << "Error opening file: " << path;
+      fclose(file);
+    }
+    string command = getCommand(getCompression(path), input) +
+                     (input ? " " : " > ") + quote(filename);
+    FILE* pipe = popen(command.c_str(), input ? "r" : "w");
+    taco_uassert(pipe != nullptr) << "Error opening file: " << path;
+    buffer.reset(new PipeBuffer(pipe, input));
+  }
+  rdbuf(buffer.get());
+}
+
+FileStream::~FileStream() {
+  if (buffer != nullptr) {
+    flush();
+  }
+}
+
+void FileStream::close() {
+  flush();
+  if (compressed) {
+    taco_uassert(((PipeBuffer*)buffer.get())->close()) <<
+        "Error compressing or decompressing file: " << path;
+  }
+  else {
+    ((std::filebuf*)buffer.get())->close();
+  }
+}
+
 }}
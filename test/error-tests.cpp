@@ -60,3 +60,90 @@ TEST(error, compute_without_compile) {
   a(i) = b(i);
   ASSERT_DEATH(a.compute(), error::compute_without_compile);
 }
+
+TEST(error, compute_pending_operand) {
+  Tensor<double> a({5}, Sparse);
+  Tensor<double> b({5}, Sparse);
+  Tensor<double> c({5}, Sparse);
+  b.pack();
+  a(i) = b(i);
+  c(i) = a(i);
+  c.compile();
+  ASSERT_DEATH(c.assemble(), error::compute_pending_operand);
+}
+
+TEST(error, compile_merge_duplicates) {
+  Tensor<double> A({5,5}, Format({Dense,Dense}));
+  Tensor<double> B({5,5}, COO);
+  Tensor<double> C({5,5}, CSR);
+  A(i,j) = B(i,j) + C(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_merge_duplicates);
+}
+
+TEST(error, compile_duplicates_sparse_result) {
+  Tensor<double> a({5}, Sparse);
+  Tensor<double> B({5,5}, COO);
+  Tensor<double> c({5}, Dense);
+  a(i) = B(i,j) * c(j);
+  ASSERT_DEATH(a.compile(), error::compile_duplicates_sparse_result);
+}
+
+TEST(error, compile_hashed_operand) {
+  Tensor<double> a({5}, Dense);
+  Tensor<double> B({5,5}, Format({Dense,Hashed}));
+  Tensor<double> c({5}, Dense);
+  a(i) = B(i,j) * c(j);
+  ASSERT_DEATH(a.compile(), error::compile_hashed_operand);
+}
+
+TEST(error, compile_hashed_result) {
+  Tensor<double> A({5,5}, Format({Hashed,Dense}));
+  Tensor<double> B({5,5}, Dense);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_hashed_result);
+}
+
+TEST(error, compile_bitmap_result) {
+  Tensor<double> A({5,5}, Format({Dense,Bitmap}));
+  Tensor<double> B({5,5}, Dense);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_bitmap_result);
+}
+
+TEST(error, compile_fixed_result) {
+  Tensor<double> A({5,5}, Format({Dense,Fixed}));
+  Tensor<double> B({5,5}, Dense);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_fixed_result);
+}
+
+TEST(error, format_index_width) {
+  Format csr = CSR;
+  csr.setLevelArrayTypes({{Int32}, {Int32, UInt8}});
+  ASSERT_DEATH(Tensor<double>({5,300}, csr), error::format_index_width);
+
+  Format bitmap({Dense,Bitmap});
+  bitmap.setLevelArrayTypes({{Int32}, {Int64, Int32, Int32}});
+  ASSERT_DEATH(Tensor<double>({5,5}, bitmap), error::format_index_type);
+}
+
+TEST(error, convert_mode_ordering) {
+  Tensor<double> A({5,5}, CSR);
+  Tensor<double> B({5,5}, CSR);
+  B.pack();
+  ASSERT_DEATH(A.pack(B, {0,0}), error::convert_mode_ordering);
+}
+
+TEST(error, compile_packed_result) {
+  Tensor<double> A({5,5}, Format({Dense,Packed}));
+  Tensor<double> B({5,5}, Dense);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_packed_result);
+}
+
+TEST(error, compile_diagonal_result) {
+  Tensor<double> A({5,5}, DIA);
+  Tensor<double> B({5,5}, Dense);
+  A(i,j) = B(i,j);
+  ASSERT_DEATH(A.compile(), error::compile_diagonal_result);
+}
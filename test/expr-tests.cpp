@@ -1,6 +1,8 @@
 #include "test.h"
 #include "test_tensors.h"
 #include "taco/tensor.h"
+#include "taco/index_notation/schedule.h"
+#include "taco/index_notation/index_notation_nodes.h"
 
 using namespace taco;
 
@@ -128,3 +130,708 @@ TEST(expr, scalarops) {
   b * c;
   b / c;
 }
+
+TEST(expr, unroll_small_dimensions) {
+  Tensor<double> y("y", {3}, Format({Dense}));
+  Tensor<double> B("B", {3,4}, Format({Sparse,Dense}));
+  Tensor<double> x("x", {4}, Format({Dense}));
+  B.insert({0,1}, 2.0);
+  B.insert({2,0}, 3.0);
+  B.insert({2,3}, 4.0);
+  B.pack();
+  for (int j = 0; j < 4; ++j) {
+    x.insert({j}, (double)(j+1));
+  }
+  x.pack();
+
+  y(i) = B(i,j) * x(j);
+  Schedule schedule = y.getTensorVar().getSchedule();
+  schedule.setMaxSpecializedDimension(4);
+  y.evaluate();
+  ASSERT_NE(string::npos, y.getSource().find("#pragma GCC unroll 4"));
+
+  Tensor<double> expected("y", {3}, Format({Dense}));
+  expected.insert({0}, 4.0);
+  expected.insert({2}, 19.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+
+  schedule.setMaxSpecializedDimension(3);
+  y.compile();
+  ASSERT_EQ(string::npos, y.getSource().find("#pragma GCC unroll"));
+}
+
+TEST(expr, blocked_spmv) {
+  Tensor<double> A("A", {12,17}, CSR);
+  Tensor<double> x("x", {17}, Format({Dense}));
+  for (int k = 0; k < 40; ++k) {
+    A.insert({(5*k) % 12, (3*k) % 17}, (double)(k+1));
+  }
+  for (int j = 0; j < 17; ++j) {
+    x.insert({j}, (double)(j+1));
+  }
+  A.pack();
+  x.pack();
+
+  Tensor<double> expected("expected", {12}, Format({Dense}));
+  expected(i) = A(i,j) * x(j);
+  expected.evaluate();
+
+  // Multiply a matrix with 3x3 blocks by a vector with blocks of 3
+  Tensor<double> Ab = A.block({3,3});
+  Tensor<double> xb = x.block({3}, Format({Dense,Dense}));
+  ASSERT_EQ(vector<int>({4,6,3,3}), Ab.getDimensions());
+  ASSERT_TRUE(equals(A, Ab.unblock({12,17}, CSR)));
+
+  IndexVar bi("bi"), bj("bj");
+  Tensor<double> yb("yb", {4,3}, Format({Dense,Dense}));
+  yb(i,bi) = Ab(i,j,bi,bj) * xb(j,bj);
+  Schedule schedule = yb.getTensorVar().getSchedule();
+  schedule.setMaxSpecializedDimension(3);
+  yb.evaluate();
+  ASSERT_NE(string::npos, yb.getSource().find("#pragma GCC unroll 3"));
+  ASSERT_TRUE(equals(expected, yb.unblock({12}, Format({Dense}))));
+}
+
+TEST(expr, prefetch_indirect_accesses) {
+  Tensor<double> y("y", {3}, Format({Dense}));
+  Tensor<double> B("B", {3,20}, CSR);
+  Tensor<double> x("x", {20}, Format({Dense}));
+  for (int j = 0; j < 20; ++j) {
+    B.insert({j % 3, j}, 1.0);
+    x.insert({j}, (double)j);
+  }
+  B.pack();
+  x.pack();
+
+  y(i) = B(i,j) * x(j);
+  Schedule schedule = y.getTensorVar().getSchedule();
+  schedule.setPrefetchDistance(2);
+  y.evaluate();
+  ASSERT_NE(string::npos, y.getSource().find("__builtin_prefetch"));
+
+  Tensor<double> expected("y", {3}, Format({Dense}));
+  expected.insert({0}, 63.0);
+  expected.insert({1}, 70.0);
+  expected.insert({2}, 57.0);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, y));
+}
+
+TEST(expr, multi_fused_traversal) {
+  Tensor<double> A("A", {20,30}, CSR);
+  Tensor<double> x("x", {30}, Format({Dense}));
+  Tensor<double> w("w", {20}, Format({Dense}));
+  for (int k = 0; k < 60; ++k) {
+    A.insert({k % 20, (7*k) % 30}, (double)k);
+  }
+  for (int k = 0; k < 30; ++k) {
+    x.insert({k}, (double)k);
+  }
+  for (int k = 0; k < 20; ++k) {
+    w.insert({k}, (double)(k+1));
+  }
+  A.pack();
+  x.pack();
+  w.pack();
+
+  Tensor<double> y("y", {20}, Format({Dense}));
+  Tensor<double> z("z", {30}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  z(j) = A(i,j) * w(i);
+  evaluate({y, z});
+
+  // A is traversed once
+  string source = y.getSource();
+  size_t loop = source.find("for (int32_t pA2");
+  ASSERT_NE(string::npos, loop);
+  ASSERT_EQ(string::npos, source.find("for (int32_t pA2", loop + 1));
+
+  Tensor<double> expectedY("expectedY", {20}, Format({Dense}));
+  Tensor<double> expectedZ("expectedZ", {30}, Format({Dense}));
+  expectedY(i) = A(i,j) * x(j);
+  expectedZ(j) = A(i,j) * w(i);
+  expectedY.evaluate();
+  expectedZ.evaluate();
+  ASSERT_TRUE(equals(expectedY, y));
+  ASSERT_TRUE(equals(expectedZ, z));
+}
+
+TEST(expr, multi_dependent) {
+  Tensor<double> A("A", {20,30}, CSR);
+  Tensor<double> x("x", {30}, Format({Dense}));
+  Tensor<double> b("b", {20}, Format({Dense}));
+  for (int k = 0; k < 60; ++k) {
+    A.insert({k % 20, (7*k) % 30}, (double)k);
+  }
+  for (int k = 0; k < 30; ++k) {
+    x.insert({k}, (double)k);
+  }
+  for (int k = 0; k < 20; ++k) {
+    b.insert({k}, (double)(k+1));
+  }
+  A.pack();
+  x.pack();
+  b.pack();
+
+  Tensor<double> y("y", {20}, Format({Dense}));
+  Tensor<double> r("r", {20}, Format({Dense}));
+  y(i) = A(i,j) * x(j);
+  r(i) = b(i) - y(i);
+  evaluate({y, r});
+
+  // r is computed in the loop over the rows of A that computes y
+  string source = y.getSource();
+  size_t loop = source.find("for (int32_t iA");
+  ASSERT_NE(string::npos, loop);
+  size_t yStore = source.find("y_vals[iA] = tj", loop);
+  ASSERT_NE(string::npos, yStore);
+  size_t rStore = source.find("r_vals[iA] = ", yStore);
+  ASSERT_NE(string::npos, rStore);
+  ASSERT_EQ(string::npos, source.find("for (", yStore));
+  ASSERT_EQ(source.find("\n  }", loop), source.find("\n  }", rStore));
+
+  Tensor<double> expectedY("expectedY", {20}, Format({Dense}));
+  Tensor<double> expectedR("expectedR", {20}, Format({Dense}));
+  expectedY(i) = A(i,j) * x(j);
+  expectedY.evaluate();
+  expectedR(i) = b(i) - expectedY(i);
+  expectedR.evaluate();
+  ASSERT_TRUE(equals(expectedY, y));
+  ASSERT_TRUE(equals(expectedR, r));
+}
+
+TEST(expr, lazy_eliminate_temporaries) {
+  Tensor<double> B("B", {20,30}, CSR);
+  Tensor<double> c("c", {30}, Format({Dense}));
+  Tensor<double> d("d", {20}, Format({Dense}));
+  for (int k = 0; k < 60; ++k) {
+    B.insert({k % 20, (7*k) % 30}, (double)k);
+  }
+  for (int k = 0; k < 30; ++k) {
+    c.insert({k}, (double)k);
+  }
+  for (int k = 0; k < 20; ++k) {
+    d.insert({k}, (double)(k+1));
+  }
+  B.pack();
+  c.pack();
+  d.pack();
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  Tensor<double> expectedT("expectedT", {20}, Format({Dense}));
+  expectedT(i) = B(i,j) * c(j);
+  expectedT.evaluate();
+
+  // t is inlined into a and never computed
+  Tensor<double> t("t", {20}, Format({Dense}));
+  Tensor<double> a("a", {20}, Format({Dense}));
+  t(i) = B(i,j) * c(j);
+  a(i) = t(i) + d(i);
+  std::vector<TensorBase> eliminated = a.evaluateLazily();
+  ASSERT_EQ(1u, eliminated.size());
+  ASSERT_EQ(t, eliminated[0]);
+  ASSERT_TRUE(t.needsCompute());
+  ASSERT_EQ(t.getTensorVar(),
+            getOperands(a.getTensorVar().getAssignment().getRhs())[0]);
+  expected(i) = expectedT(i) + d(i);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+
+  // Tensors that read t afterwards evaluate it first
+  Tensor<double> f("f", {20}, Format({Dense}));
+  f(i) = t(i) * d(i);
+  f.evaluate();
+  ASSERT_FALSE(t.needsCompute());
+  ASSERT_TRUE(equals(expectedT, t));
+  expected(i) = expectedT(i) * d(i);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, f));
+
+  // t is reduced before it is multiplied, so it is computed with a
+  Tensor<double> u("u", {20}, Format({Dense}));
+  Tensor<double> e("e", {20}, Format({Dense}));
+  u(i) = B(i,j) * c(j);
+  e(i) = u(i) * d(i);
+  ASSERT_TRUE(e.evaluateLazily().empty());
+  ASSERT_FALSE(u.needsCompute());
+  ASSERT_TRUE(equals(expectedT, u));
+  expected(i) = expectedT(i) * d(i);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, e));
+}
+
+TEST(expr, contraction_order) {
+  IndexVar l("l");
+  Format dense({Dense,Dense});
+  Tensor<double> B("B", {20,20}, dense);
+  Tensor<double> C("C", {20,20}, dense);
+  Tensor<double> D("D", {20,20}, dense);
+  for (int r = 0; r < 20; ++r) {
+    for (int s = 0; s < 20; ++s) {
+      B.insert({r,s}, (double)((r+s) % 7));
+      C.insert({r,s}, (double)((r*s) % 5));
+      D.insert({r,s}, (double)((r+2*s) % 3));
+    }
+  }
+  B.pack();
+  C.pack();
+  D.pack();
+
+  Tensor<double> expected("expected", {20,20}, dense);
+  expected(i,l) = B(i,j) * C(j,k) * D(k,l);
+  expected.evaluate();
+
+  // The chain is computed as two matrix products instead of one loop nest
+  Tensor<double> A("A", {20,20}, dense);
+  A(i,l) = B(i,j) * C(j,k) * D(k,l);
+  std::vector<TensorBase> temporaries = A.optimizeContractionOrder();
+  ASSERT_EQ(1u, temporaries.size());
+  ASSERT_EQ(2u, temporaries[0].getOrder());
+  A.evaluateLazily();
+  ASSERT_TRUE(equals(expected, A));
+
+  // Products of two operands are left alone
+  Tensor<double> E("E", {20,20}, dense);
+  E(i,k) = B(i,j) * C(j,k);
+  ASSERT_TRUE(E.optimizeContractionOrder().empty());
+}
+
+TEST(expr, coo_operand) {
+  Tensor<double> Bcsr("Bcsr", {20,30}, CSR);
+  Tensor<double> Bcoo("Bcoo", {20,30}, COO);
+  Tensor<double> C("C", {30,10}, Format({Dense,Dense}));
+  Tensor<double> c("c", {30}, Format({Dense}));
+  for (int k = 0; k < 60; ++k) {
+    Bcsr.insert({(3*k) % 20, (7*k) % 30}, (double)k);
+    Bcoo.insert({(3*k) % 20, (7*k) % 30}, (double)k);
+  }
+  for (int k = 0; k < 30; ++k) {
+    c.insert({k}, (double)k);
+    for (int l = 0; l < 10; ++l) {
+      C.insert({k,l}, (double)(k+l));
+    }
+  }
+  Bcsr.pack();
+  Bcoo.pack();
+  C.pack();
+  c.pack();
+
+  // Rows of the COO matrix are visited once per stored entry
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Bcsr(i,j) * c(j);
+  expected.evaluate();
+  Tensor<double> a("a", {20}, Format({Dense}));
+  a(i) = Bcoo(i,j) * c(j);
+  a.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+
+  Tensor<double> Expected("Expected", {20,10}, Format({Dense,Dense}));
+  Expected(i,k) = Bcsr(i,j) * C(j,k);
+  Expected.evaluate();
+  Tensor<double> A("A", {20,10}, Format({Dense,Dense}));
+  A(i,k) = Bcoo(i,j) * C(j,k);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+}
+
+TEST(expr, hashed_result) {
+  Tensor<double> B("B", {20,30}, CSR);
+  Tensor<double> C("C", {30,25}, CSR);
+  for (int k = 0; k < 60; ++k) {
+    B.insert({(3*k) % 20, (7*k) % 30}, (double)k);
+    C.insert({(11*k) % 30, (5*k) % 25}, (double)(k+1));
+  }
+  B.pack();
+  C.pack();
+
+  Tensor<double> expected("expected", {20,25}, Format({Dense,Dense}));
+  expected(i,k) = B(i,j) * C(j,k);
+  expected.evaluate();
+
+  // Rows of the result are inserted into a hash table in any order
+  Tensor<double> A("A", {20,25}, Format({Dense,Hashed}));
+  A(i,k) = B(i,j) * C(j,k);
+  A.evaluate();
+  Tensor<double> sorted = A.sortHashedModes();
+  ASSERT_TRUE(sorted.getFormat() == CSR);
+  Tensor<double> actual("actual", {20,25}, Format({Dense,Dense}));
+  actual(i,k) = sorted(i,k);
+  actual.evaluate();
+  ASSERT_TRUE(equals(expected, actual));
+
+  // Reassembling starts from an empty hash table
+  A.assemble();
+  A.compute();
+  ASSERT_EQ(sorted.getStorage().getIndex().getSize(),
+            A.sortHashedModes().getStorage().getIndex().getSize());
+}
+
+TEST(expr, bitmap_operand) {
+  Tensor<double> Bcsr("Bcsr", {20,70}, CSR);
+  Tensor<double> Bbitmap("Bbitmap", {20,70}, Format({Dense,Bitmap}));
+  Tensor<double> C("C", {20,70}, CSR);
+  Tensor<double> c("c", {70}, Format({Dense}));
+  Tensor<double> d("d", {70}, Format({Sparse}));
+  for (int k = 0; k < 300; ++k) {
+    Bcsr.insert({(3*k) % 20, (7*k) % 70}, (double)k);
+    Bbitmap.insert({(3*k) % 20, (7*k) % 70}, (double)k);
+    C.insert({(7*k) % 20, (3*k) % 70}, (double)(k+1));
+  }
+  for (int k = 0; k < 70; ++k) {
+    c.insert({k}, (double)k);
+    if (k % 3 == 0) {
+      d.insert({k}, (double)(k+1));
+    }
+  }
+  Bcsr.pack();
+  Bbitmap.pack();
+  C.pack();
+  c.pack();
+  d.pack();
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Bcsr(i,j) * c(j);
+  expected.evaluate();
+  Tensor<double> a("a", {20}, Format({Dense}));
+  a(i) = Bbitmap(i,j) * c(j);
+  a.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+
+  // The coordinates of sparse operands are located in bitmap rows when they
+  // are multiplied, and bitmap rows are merged with them when they are added
+  expected(i) = Bcsr(i,j) * d(j);
+  expected.evaluate();
+  a(i) = Bbitmap(i,j) * d(j);
+  a.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+  ASSERT_NE(std::string::npos, a.getSource().find("taco_bitmap_locate"));
+
+  Tensor<double> Expected("Expected", {20,70}, Format({Dense,Dense}));
+  Expected(i,j) = Bcsr(i,j) + C(i,j);
+  Expected.evaluate();
+  Tensor<double> A("A", {20,70}, Format({Dense,Dense}));
+  A(i,j) = Bbitmap(i,j) + C(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+
+  Expected(i,j) = Bcsr(i,j) * C(i,j);
+  Expected.evaluate();
+  A(i,j) = Bbitmap(i,j) * C(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+
+  Expected(i,j) = Bcsr(i,j) * C(i,j) + Bcsr(i,j);
+  Expected.evaluate();
+  A(i,j) = Bbitmap(i,j) * C(i,j) + Bcsr(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+
+  Expected(i,j) = Bcsr(i,j) * Bcsr(i,j);
+  Expected.evaluate();
+  A(i,j) = Bbitmap(i,j) * Bbitmap(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+}
+
+TEST(expr, packed_operand) {
+  Tensor<double> Bcsr("Bcsr", {20,70}, CSR);
+  Tensor<double> Bpacked("Bpacked", {20,70}, Format({Dense,Packed}));
+  Tensor<double> C("C", {20,70}, CSR);
+  Tensor<double> c("c", {70}, Format({Dense}));
+  Tensor<double> d("d", {70}, Format({Sparse}));
+  // Full rows span several blocks of decoded coordinates, and the last row
+  // has a single coordinate, whose difference is packed in no bits
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 70; ++j) {
+      bool present = (i % 4 == 0) ? true
+                   : (i == 19)    ? (j == 9)
+                   : (i + 2*j) % 5 == 0;
+      if (present) {
+        Bcsr.insert({i, j}, (double)(i*70 + j));
+        Bpacked.insert({i, j}, (double)(i*70 + j));
+      }
+    }
+  }
+  for (int k = 0; k < 300; ++k) {
+    C.insert({(7*k) % 20, (3*k) % 70}, (double)(k+1));
+  }
+  for (int k = 0; k < 70; ++k) {
+    c.insert({k}, (double)k);
+    if (k % 3 == 0) {
+      d.insert({k}, (double)(k+1));
+    }
+  }
+  Bcsr.pack();
+  Bpacked.pack();
+  C.pack();
+  c.pack();
+  d.pack();
+  ASSERT_LT(Bpacked.getStorage().getSizeInBytes(),
+            Bcsr.getStorage().getSizeInBytes());
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Bcsr(i,j) * c(j);
+  expected.evaluate();
+  Tensor<double> a("a", {20}, Format({Dense}));
+  a(i) = Bpacked(i,j) * c(j);
+  a.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+  ASSERT_NE(std::string::npos, a.getSource().find("taco_packed_decode"));
+
+  // Packed rows are merged with sparse operands like compressed rows
+  expected(i) = Bcsr(i,j) * d(j);
+  expected.evaluate();
+  a(i) = Bpacked(i,j) * d(j);
+  a.evaluate();
+  ASSERT_TRUE(equals(expected, a));
+
+  Tensor<double> Expected("Expected", {20,70}, Format({Dense,Dense}));
+  Expected(i,j) = Bcsr(i,j) + C(i,j);
+  Expected.evaluate();
+  Tensor<double> A("A", {20,70}, Format({Dense,Dense}));
+  A(i,j) = Bpacked(i,j) + C(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(Expected, A));
+}
+
+TEST(expr, ell_operand) {
+  Tensor<double> Acsr("Acsr", {20,30}, CSR);
+  Tensor<double> Aell("Aell", {20,30}, Format({Dense,Fixed}));
+  Tensor<double> x("x", {30}, Format({Dense}));
+  for (int k = 0; k < 50; ++k) {
+    Acsr.insert({(3*k) % 20, (7*k) % 30}, (double)(k+1));
+    Aell.insert({(3*k) % 20, (7*k) % 30}, (double)(k+1));
+  }
+  for (int j = 0; j < 30; ++j) {
+    x.insert({j}, (double)j);
+  }
+  Acsr.pack();
+  Aell.pack();
+  x.pack();
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Acsr(i,j) * x(j);
+  expected.evaluate();
+  Tensor<double> y("y", {20}, Format({Dense}));
+  y(i) = Aell(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  // The padding of the rows is accumulated into the result as zeros
+  Tensor<double> Expected("Expected", {20,30}, Format({Dense,Dense}));
+  Expected(i,j) = Acsr(i,j);
+  Expected.evaluate();
+  Tensor<double> B("B", {20,30}, Format({Dense,Dense}));
+  B(i,j) = Aell(i,j);
+  B.evaluate();
+  ASSERT_TRUE(equals(Expected, B));
+}
+
+TEST(expr, convert) {
+  Tensor<double> B("B", {20,30}, CSR);
+  Tensor<double> expected("expected", {20,30}, CSC);
+  Tensor<double> expectedT("expectedT", {30,20}, CSR);
+  for (int k = 0; k < 100; ++k) {
+    B.insert({(3*k) % 20, (7*k) % 30}, (double)(k+1));
+    expected.insert({(3*k) % 20, (7*k) % 30}, (double)(k+1));
+    expectedT.insert({(7*k) % 30, (3*k) % 20}, (double)(k+1));
+  }
+  B.pack();
+  expected.pack();
+  expectedT.pack();
+
+  // Copies that change the format or transpose are converted without kernels
+  Tensor<double> A("A", {20,30}, CSC);
+  A(i,j) = B(i,j);
+  A.evaluate();
+  ASSERT_TRUE(equals(expected, A));
+
+  Tensor<double> At("At", {30,20}, CSR);
+  At(j,i) = B(i,j);
+  At.evaluate();
+  ASSERT_TRUE(equals(expectedT, At));
+
+  Tensor<double> x("x", {20}, Format({Dense}));
+  for (int k = 0; k < 20; ++k) {
+    x.insert({k}, (double)k);
+  }
+  x.pack();
+  Tensor<double> y("y", {30}, Format({Dense}));
+  y(j) = At(j,i) * x(i);
+  y.evaluate();
+  Tensor<double> yExpected("yExpected", {30}, Format({Dense}));
+  yExpected(j) = expectedT(j,i) * x(i);
+  yExpected.evaluate();
+  ASSERT_TRUE(equals(yExpected, y));
+
+  // Lazily evaluated tensors convert the copies they read first, and copies
+  // of temporaries after the temporaries are computed
+  Tensor<double> Bt("Bt", {30,20}, CSR);
+  Tensor<double> z("z", {30}, Format({Dense}));
+  Bt(j,i) = B(i,j);
+  z(j) = Bt(j,i) * x(i);
+  z.evaluateLazily();
+  ASSERT_FALSE(Bt.needsCompute());
+  ASSERT_TRUE(equals(expectedT, Bt));
+  ASSERT_TRUE(equals(yExpected, z));
+
+  Tensor<double> S("S", {20,30}, CSR);
+  Tensor<double> St("St", {30,20}, CSR);
+  S(i,j) = B(i,j) + B(i,j);
+  St(j,i) = S(i,j);
+  z(j) = St(j,i) * x(i);
+  z.evaluateLazily();
+  yExpected(j) = expectedT(j,i) * x(i) + expectedT(j,i) * x(i);
+  yExpected.evaluate();
+  ASSERT_TRUE(equals(yExpected, z));
+}
+
+TEST(expr, index_types) {
+  Format wide = CSR;
+  wide.setLevelArrayTypes({{Int32}, {Int64, UInt16}});
+  Format narrow = CSR;
+  narrow.setLevelArrayTypes({{Int32}, {Int32, UInt8}});
+
+  Tensor<double> Bcsr("Bcsr", {20,40}, CSR);
+  Tensor<double> B("B", {20,40}, wide);
+  Tensor<double> C("C", {20,40}, narrow);
+  Tensor<double> x("x", {40}, Format({Dense}));
+  for (int k = 0; k < 100; ++k) {
+    Bcsr.insert({(3*k) % 20, (7*k) % 40}, (double)(k+1));
+    B.insert({(3*k) % 20, (7*k) % 40}, (double)(k+1));
+    C.insert({(7*k) % 20, (3*k) % 40}, (double)k);
+  }
+  for (int j = 0; j < 40; ++j) {
+    x.insert({j}, (double)j);
+  }
+  Bcsr.pack();
+  B.pack();
+  C.pack();
+  x.pack();
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Bcsr(i,j) * x(j);
+  expected.evaluate();
+  Tensor<double> y("y", {20}, Format({Dense}));
+  y(i) = B(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+  ASSERT_NE(string::npos, y.getSource().find("int64_t pB2"));
+  ASSERT_NE(string::npos, y.getSource().find("uint16_t* restrict B2_idx"));
+
+  // Results are assembled with the index types of their format
+  Tensor<double> A("A", {20,40}, wide);
+  A(i,j) = B(i,j) + C(i,j);
+  A.evaluate();
+  auto modeIndex = A.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(Int64, modeIndex.getIndexArray(0).getType());
+  ASSERT_EQ(UInt16, modeIndex.getIndexArray(1).getType());
+
+  Tensor<double> Expected("Expected", {20,40}, Format({Dense,Dense}));
+  Expected(i,j) = Bcsr(i,j) + C(i,j);
+  Expected.evaluate();
+  Tensor<double> Actual("Actual", {20,40}, Format({Dense,Dense}));
+  Actual(i,j) = A(i,j);
+  Actual.evaluate();
+  ASSERT_TRUE(equals(Expected, Actual));
+}
+
+TEST(expr, narrow_indices) {
+  Tensor<double> Bcsr("Bcsr", {20,300}, CSR);
+  Tensor<double> B("B", {20,300}, CSR);
+  Tensor<double> x("x", {300}, Format({Dense}));
+  B.setIndexNarrowing(true);
+  for (int k = 0; k < 100; ++k) {
+    Bcsr.insert({(3*k) % 20, (7*k) % 300}, (double)(k+1));
+    B.insert({(3*k) % 20, (7*k) % 300}, (double)(k+1));
+  }
+  for (int j = 0; j < 300; ++j) {
+    x.insert({j}, (double)j);
+  }
+  Bcsr.pack();
+  B.pack();
+  x.pack();
+
+  auto modeIndex = B.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(UInt8, modeIndex.getIndexArray(0).getType());
+  ASSERT_EQ(UInt16, modeIndex.getIndexArray(1).getType());
+
+  Tensor<double> expected("expected", {20}, Format({Dense}));
+  expected(i) = Bcsr(i,j) * x(j);
+  expected.evaluate();
+  Tensor<double> y("y", {20}, Format({Dense}));
+  y(i) = B(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Packing more entries widens the positions and recompiles the kernel
+  for (int k = 0; k < 1000; ++k) {
+    B.insert({k % 20, (11*k) % 300}, 1.0);
+  }
+  B.pack();
+  modeIndex = B.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(UInt16, modeIndex.getIndexArray(0).getType());
+  y.compute();
+  Tensor<double> Bdense("Bdense", {20,300}, Format({Dense,Dense}));
+  Bdense(i,j) = B(i,j);
+  Bdense.evaluate();
+  expected(i) = Bdense(i,j) * x(j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Results are assembled with the index types they were declared with
+  B(i,j) = Bcsr(i,j);
+  B.evaluate();
+  modeIndex = B.getStorage().getIndex().getModeIndex(1);
+  ASSERT_EQ(Int32, modeIndex.getIndexArray(0).getType());
+  ASSERT_EQ(Int32, modeIndex.getIndexArray(1).getType());
+}
+
+TEST(expr, dia_operand) {
+  Tensor<double> Acsr("Acsr", {25,20}, CSR);
+  Tensor<double> Adia("Adia", {25,20}, DIA);
+  Tensor<double> x("x", {20}, Format({Dense}));
+  Tensor<double> s("s", {20}, Format({Sparse}));
+  for (int i = 0; i < 25; ++i) {
+    for (int offset : {-3, 0, 2}) {
+      if (i + offset >= 0 && i + offset < 20) {
+        Acsr.insert({i, i + offset}, (double)(i + offset + 1));
+        Adia.insert({i, i + offset}, (double)(i + offset + 1));
+      }
+    }
+  }
+  for (int j = 0; j < 20; ++j) {
+    x.insert({j}, (double)j);
+    if (j % 4 == 1) {
+      s.insert({j}, (double)(j+1));
+    }
+  }
+  Acsr.pack();
+  Adia.pack();
+  x.pack();
+  s.pack();
+
+  Tensor<double> expected("expected", {25}, Format({Dense}));
+  expected(i) = Acsr(i,j) * x(j);
+  expected.evaluate();
+  Tensor<double> y("y", {25}, Format({Dense}));
+  y(i) = Adia(i,j) * x(j);
+  y.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  // Diagonals are merged with sparse operands like compressed rows
+  expected(i) = Acsr(i,j) * s(j);
+  expected.evaluate();
+  y(i) = Adia(i,j) * s(j);
+  y.evaluate();
+  ASSERT_TRUE(equals(expected, y));
+
+  Tensor<double> Expected("Expected", {25,20}, Format({Dense,Dense}));
+  Expected(i,j) = Acsr(i,j) + Acsr(i,j);
+  Expected.evaluate();
+  Tensor<double> B("B", {25,20}, Format({Dense,Dense}));
+  B(i,j) = Adia(i,j) + Acsr(i,j);
+  B.evaluate();
+  ASSERT_TRUE(equals(Expected, B));
+}
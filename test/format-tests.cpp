@@ -72,3 +72,76 @@ TEST(format, dense) {
   A.pack();
   ASSERT_STORAGE_EQUALS({{{3}}, {{3}}}, {0,2,0, 0,0,0, 3,0,4}, A);
 }
+
+TEST(format, coo) {
+  Tensor<double> A = d33a("A", COO);
+  A.pack();
+  ASSERT_STORAGE_EQUALS({{{0,3}, {0,2,2}}, {{1,0,2}}}, {2,3,4}, A);
+
+  Tensor<double> B = d233a("B", Format({Sparse,Singleton,Singleton}));
+  B.pack();
+  Tensor<double> expected = d233a("expected", Format({Sparse,Sparse,Sparse}));
+  expected.pack();
+  ASSERT_TRUE(equals(expected, B));
+}
+
+TEST(format, hashed) {
+  Tensor<double> A = d33a("A", Format({Dense,Hashed}));
+  A.pack();
+  ASSERT_EQ(16u, A.getStorage().getIndex().getSize());
+
+  Tensor<double> expected = d33a("expected", CSR);
+  expected.pack();
+  TensorBase B = A.sortHashedModes();
+  ASSERT_TRUE(B.getFormat() == CSR);
+  ASSERT_TRUE(equals(expected, B));
+}
+
+TEST(format, bitmap) {
+  Tensor<double> A = d33a("A", Format({Dense,Bitmap}));
+  A.pack();
+  ASSERT_STORAGE_EQUALS({{{3}}, {{3}, {2,0,5}, {0,1,1,3}}}, {2,3,4}, A);
+
+  Tensor<double> B = d233a("B", Format({Sparse,Bitmap,Dense}));
+  B.pack();
+  Tensor<double> expected = d233a("expected", Format({Sparse,Sparse,Dense}));
+  expected.pack();
+  ASSERT_TRUE(equals(expected, B));
+}
+
+TEST(format, dia) {
+  Tensor<double> A = d33a("A", DIA);
+  A.pack();
+  ASSERT_STORAGE_EQUALS({{{3}}, {{3}, {-2,0,1}}},
+                        {0,0,3, 0,0,4, 2,0,0}, A);
+}
+
+TEST(format, packed) {
+  Tensor<double> A = d33a("A", Format({Dense,Packed}));
+  A.pack();
+  ASSERT_STORAGE_EQUALS({{{3}}, {{0,1,1,3}, {1,0,0, 0,0,0, 0,2,0}, {8,0,0}}},
+                        {2,3,4}, A);
+
+  Tensor<double> B = d233a("B", Format({Sparse,Packed,Dense}));
+  B.pack();
+  Tensor<double> expected = d233a("expected", Format({Sparse,Sparse,Dense}));
+  expected.pack();
+  ASSERT_TRUE(equals(expected, B));
+}
+
+TEST(format, index_types) {
+  Format csr = CSR;
+  csr.setLevelArrayTypes({{Int32}, {Int64, UInt16}});
+  Tensor<double> A = d33a("A", csr);
+  A.pack();
+
+  auto modeIndex = A.getStorage().getIndex().getModeIndex(1);
+  auto pos = modeIndex.getIndexArray(0);
+  auto idx = modeIndex.getIndexArray(1);
+  ASSERT_EQ(Int64, pos.getType());
+  ASSERT_EQ(UInt16, idx.getType());
+  ASSERT_ARRAY_EQ(vector<int64_t>({0,1,1,3}),
+                  {(int64_t*)pos.getData(), pos.getSize()});
+  ASSERT_ARRAY_EQ(vector<uint16_t>({1,0,2}),
+                  {(uint16_t*)idx.getData(), idx.getSize()});
+}
@@ -1,6 +1,17 @@
 #include "test.h"
 
 #include "taco/tensor.h"
+#include "taco/storage/file_io_mtx.h"
+#include "taco/storage/file_io_taco.h"
+#include "taco/storage/file_io_tns.h"
+#include "taco/storage/allocator.h"
+#include "taco/util/env.h"
+#include "taco/util/files.h"
+#include "storage/text_parser.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 using namespace taco;
 
@@ -127,3 +138,249 @@ TEST(io, mtxsymmetric) {
 
   ASSERT_TRUE(equals(expected, tensor));
 }
+
+TEST(io, taco) {
+  TensorBase tensor = read(testDataDirectory()+"2tensor.mtx", CSR);
+  tensor.setIndexNarrowing(true);
+  tensor.pack(tensor, {0,1});
+
+  // Files are memory mapped, and streams read
+  std::string filename = util::getTmpdir() + "2tensor.taco";
+  write(filename, tensor);
+  TensorBase mapped = read(filename, CSR);
+  ASSERT_EQ(tensor.getFormat(), mapped.getFormat());
+  ASSERT_EQ(tensor.getFormat().getLevelArrayTypes(),
+            mapped.getFormat().getLevelArrayTypes());
+  ASSERT_TRUE(equals(tensor, mapped));
+
+  std::stringstream stream;
+  writeTaco(stream, tensor);
+  TensorBase streamed = read(stream, FileType::taco, CSR);
+  ASSERT_TRUE(equals(tensor, streamed));
+
+  // Tensors are converted to the format they are read with
+  TensorBase dense = read(filename, Format({Dense,Dense}));
+
+  // Truncated and corrupt files are reported instead of read out of bounds
+  std::string contents = stream.str();
+  std::string damagedname = util::getTmpdir() + "damaged.taco";
+  std::ofstream(damagedname).write(contents.data(), contents.size() - 8);
+  ASSERT_DEATH(read(damagedname, CSR), "truncated");
+  contents[8 + 5*sizeof(uint64_t)] = 100;
+  std::ofstream(damagedname).write(contents.data(), contents.size());
+  ASSERT_DEATH(read(damagedname, CSR), "corrupt");
+  std::remove(damagedname.c_str());
+  std::remove(filename.c_str());
+  ASSERT_EQ(Format({Dense,Dense}), dense.getFormat());
+  TensorBase expected(Float64, {32,32}, Format({Dense,Dense}));
+  expected.insert({0, 0}, 101.0);
+  expected.insert({1, 0}, 102.0);
+  expected.insert({5, 2}, 307.1);
+  expected.pack();
+  ASSERT_TRUE(equals(expected, dense));
+}
+
+TEST(io, mapped) {
+  // Mapped files parse to the same tensors as streams
+  for (std::string name : {"2tensor.mtx", "ds33.mtx", "rua_32.mtx"}) {
+    std::fstream file(testDataDirectory()+name, std::fstream::in);
+    TensorBase streamed = readMTX(file, CSR);
+    TensorBase mapped = read(testDataDirectory()+name, CSR);
+    ASSERT_EQ(streamed.getDimensions(), mapped.getDimensions());
+    ASSERT_TRUE(equals(streamed, mapped));
+  }
+
+  // Values are parsed exactly like strtod, including those that need more
+  // than 53 bits or large exponents, and comments and blank lines are skipped
+  std::vector<std::string> values = {"1.5e-3", "-0.1", "7", "2.5E+10",
+                                     "3.14159265358979323846",
+                                     "12345678901234567890.5", "1e-30",
+                                     "0.000001", "-4.2e300"};
+  std::string filename = util::getTmpdir() + "mapped.tns";
+  std::ofstream file(filename);
+  file << "# comment" << std::endl;
+  for (size_t i = 0; i < values.size(); i++) {
+    file << i+1 << "\t" << 2*i+1 << " " << values[i] << std::endl << std::endl;
+  }
+  file << "10 1 42";
+  file.close();
+  TensorBase tensor = read(filename, Format({Sparse,Sparse}));
+  std::remove(filename.c_str());
+  values.push_back("42");
+
+  ASSERT_EQ(std::vector<int>({10,17}), tensor.getDimensions());
+  size_t i = 0;
+  for (auto& value : iterate<double>(tensor)) {
+    ASSERT_EQ(i, value.first[0]);
+    ASSERT_EQ(std::strtod(values[i].c_str(), nullptr), value.second);
+    i++;
+  }
+  ASSERT_EQ(values.size(), i);
+}
+
+TEST(io, sorted) {
+  // Files sorted in the order of the levels are built without coordinates,
+  // and other files are packed
+  std::string filename = util::getTmpdir() + "sorted.mtx";
+  std::ofstream file(filename);
+  file << "%%MatrixMarket matrix coordinate real general" << std::endl;
+  file << "%" << std::endl;
+  file << "40 30 " << 40*5 << std::endl;
+  for (int i = 0; i < 40; i++) {
+    for (int j = (i * 7) % 6; j < 30; j += 6) {
+      file << i+1 << " " << j+1 << " " << i*30+j+1 << std::endl;
+    }
+  }
+  file.close();
+
+  for (Format format : {CSR, CSC, Format({Dense,Dense}),
+                        Format({Sparse,Sparse}), Format({Sparse,Dense})}) {
+    storage::resetPeakMemory();
+    const storage::MemoryStats before = storage::getMemoryStats();
+    TensorBase tensor = read(filename, format);
+    const size_t peakBytes = storage::getMemoryStats().peakBytes;
+    if (format != CSC) {
+      ASSERT_LE(peakBytes,
+                before.liveBytes + 2*tensor.getStorage().getSizeInBytes());
+    }
+    ASSERT_EQ(format, tensor.getFormat());
+    TensorBase expected(Float64, {40,30}, format);
+    for (int i = 0; i < 40; i++) {
+      for (int j = (i * 7) % 6; j < 30; j += 6) {
+        expected.insert({i,j}, (double)(i*30+j+1));
+      }
+    }
+    expected.pack();
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+
+  // Files of more than a round of chunks are parsed and appended in rounds,
+  // and files out of order past the first round are still packed
+  for (bool outOfOrder : {false, true}) {
+    file.open(filename);
+    file << "%%MatrixMarket matrix coordinate real general" << std::endl;
+    file << "1200 1000 " << 1200*100 << std::endl;
+    for (int i = 0; i < 1200; i++) {
+      const int row = (outOfOrder && i == 1000) ? 1 : i;
+      for (int j = i % 10; j < 1000; j += 10) {
+        file << row+1 << " " << j+1 << " " << i+j << "\n";
+      }
+    }
+    file.close();
+    TensorBase tensor = read(filename, CSR);
+    TensorBase expected(Float64, {1200,1000}, CSR);
+    for (int i = 0; i < 1200; i++) {
+      const int row = (outOfOrder && i == 1000) ? 1 : i;
+      for (int j = i % 10; j < 1000; j += 10) {
+        expected.insert({row,j}, (double)(i+j));
+      }
+    }
+    expected.pack();
+    ASSERT_TRUE(equals(expected, tensor));
+  }
+  std::remove(filename.c_str());
+}
+
+TEST(io, compressed) {
+  TensorBase tensor = read(testDataDirectory()+"2tensor.mtx", CSR);
+  std::vector<std::string> extensions = {".mtx.gz", ".tns.gz", ".taco.gz"};
+  if (system("command -v zstd >/dev/null 2>&1") == 0) {
+    extensions.push_back(".mtx.zst");
+    extensions.push_back(".taco.zst");
+  }
+  for (auto& extension : extensions) {
+    // Compressed files read like the files they decompress to
+    std::string filename = util::getTmpdir() + "compressed" + extension;
+    std::string decompressed = util::stripCompression(filename);
+    write(filename, tensor);
+    write(decompressed, tensor);
+    TensorBase compressed = read(filename, CSR);
+    TensorBase expected = read(decompressed, CSR);
+    std::remove(filename.c_str());
+    std::remove(decompressed.c_str());
+    ASSERT_EQ("compressed", compressed.getName());
+    ASSERT_EQ(expected.getDimensions(), compressed.getDimensions());
+    ASSERT_TRUE(equals(expected, compressed)) << extension;
+  }
+}
+
+TEST(io, compressed_blocks) {
+  // Compressed files are decompressed in blocks of whole lines, each of which
+  // is decompressed while the one before it is parsed
+  std::string filename = util::getTmpdir() + "blocks.tns.gz";
+  std::string text;
+  for (int i = 0; i < 500; i++) {
+    text += std::to_string(i+1) + " " + std::to_string(i%7+1) + " " +
+            std::to_string(i*0.5) + "\n";
+  }
+  util::FileStream file(filename, std::fstream::out);
+  file << text;
+  file.close();
+
+  storage::FileContents contents(filename, 64);
+  for (int pass = 0; pass < 2; pass++) {
+    std::string blocks;
+    int numBlocks = 0;
+    do {
+      std::string block(contents.begin(), contents.end());
+      ASSERT_FALSE(block.empty());
+      ASSERT_EQ('\n', block.back());
+      blocks += block;
+      numBlocks++;
+    } while (contents.next());
+    ASSERT_EQ(text, blocks);
+    ASSERT_LT(50, numBlocks);
+    ASSERT_FALSE(contents.next());
+    contents.rewind();
+  }
+
+  // The files sorted for CSR and not for CSC are built straight into CSR and
+  // read again into a coordinate buffer for CSC
+  std::string mtxFilename = util::getTmpdir() + "blocks.mtx.gz";
+  util::FileStream mtxFile(mtxFilename, std::fstream::out);
+  mtxFile << "%%MatrixMarket matrix coordinate real general\n500 7 500\n"
+          << text;
+  mtxFile.close();
+  for (Format format : {CSR, CSC}) {
+    TensorBase expected(Float64, {500,7}, format);
+    for (int i = 0; i < 500; i++) {
+      expected.insert({i,i%7}, i*0.5);
+    }
+    expected.pack();
+    ASSERT_TRUE(equals(expected, read(filename, format)));
+    ASSERT_TRUE(equals(expected, read(mtxFilename, format)));
+  }
+  std::remove(filename.c_str());
+  std::remove(mtxFilename.c_str());
+}
+
+TEST(io, writers) {
+  // The writers read the index arrays, and write what the iterator yields
+  std::vector<double> values = {1.0, -3.0, 0.5, 1.0/3.0, 1e7, 1234567.0,
+                                -0.0, 2.5e-12, 999999.0};
+  for (Format format : {CSR, CSC, Format({Sparse,Sparse}),
+                        Format({Dense,Dense}), Format({Dense,Sparse,Sparse}),
+                        Format({Sparse,Dense,Sparse}, {2,0,1})}) {
+    std::vector<int> dimensions(format.getOrder(), 7);
+    TensorBase tensor(Float64, dimensions, format);
+    for (size_t k = 0; k < 40; k++) {
+      std::vector<int> coordinate;
+      for (size_t i = 0; i < format.getOrder(); i++) {
+        coordinate.push_back((int)((k * (3 + 2*i) + i) % 7));
+      }
+      tensor.insert(coordinate, values[k % values.size()]);
+    }
+    tensor.pack();
+
+    std::stringstream expected;
+    for (auto& value : iterate<double>(tensor)) {
+      for (size_t coord : value.first) {
+        expected << coord+1 << " ";
+      }
+      expected << value.second << std::endl;
+    }
+    std::stringstream written;
+    writeTNS(written, tensor);
+    ASSERT_EQ(expected.str(), written.str()) << format;
+  }
+}
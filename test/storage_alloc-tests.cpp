@@ -124,4 +124,150 @@ INSTANTIATE_TEST_CASE_P(vector_add, alloc,
     )
 );
 
+/// An allocator that counts its allocated arrays.
+static void* countingAllocate(void* context, size_t size) {
+  (*(int*)context)++;
+  return malloc(size);
+}
+
+static void* countingReallocate(void* context, void* data, size_t size) {
+  (*(int*)context) += (data == nullptr);
+  return realloc(data, size);
+}
+
+static void countingDeallocate(void* context, void* data) {
+  (*(int*)context)--;
+  free(data);
+}
+
+TEST(alloc, allocator) {
+  int numArrays = 0;
+  storage::setAllocator({countingAllocate, countingReallocate,
+                         countingDeallocate, &numArrays});
+  Tensor<double> b = dla("b", Format({Sparse}));
+  Tensor<double> c = dlb("c", Format({Sparse}));
+  b.pack();
+  const int numArraysOfB = numArrays;
+  c.pack();
+  const int numPackedArrays = numArrays;
+  ASSERT_LT(0, numArraysOfB);
+
+  Tensor<double> a("a", {10000}, Format({Sparse}));
+  a(i) = b(i) + c(i);
+  a.compile();
+  a.assemble();
+  a.compute();
+  const int numComputedArrays = numArrays;
+  ASSERT_LT(numPackedArrays, numComputedArrays);
+
+  // Assembling again reclaims the arrays the kernels allocated before
+  a.assemble();
+  a.compute();
+  ASSERT_EQ(numComputedArrays, numArrays);
+
+  // Arrays are reclaimed by the allocator that allocated them
+  storage::setAllocator(storage::getDefaultAllocator());
+  b.pack(c, {0});
+  ASSERT_EQ(numComputedArrays - numArraysOfB, numArrays);
+}
+
+static bool isAligned(const storage::Array& array) {
+  return (uintptr_t)array.getData() % storage::ARRAY_ALIGNMENT == 0;
+}
+
+TEST(alloc, aligned) {
+  // Arrays of at least 256 bytes are mapped and backed by huge pages
+  storage::setAllocator(storage::getAlignedAllocator(
+      storage::HugePages::Transparent, 256));
+  Tensor<double> b = dla("b", Format({Sparse}));
+  Tensor<double> c = dlb("c", Format({Sparse}));
+  b.pack();
+  c.pack();
+  ASSERT_TRUE(isAligned(b.getStorage().getValues()));
+  ASSERT_TRUE(isAligned(b.getStorage().getIndex().getModeIndex(0)
+                                                 .getIndexArray(1)));
+
+  Tensor<double> a("a", {10000}, Format({Sparse}));
+  a(i) = b(i) + c(i);
+  a.evaluate();
+  ASSERT_NE(std::string::npos, a.getSource().find("__builtin_assume_aligned"));
+  ASSERT_TRUE(isAligned(a.getStorage().getValues()));
+
+  // Kernels stop assuming alignment once arrays may be unaligned
+  storage::setAllocator(storage::getDefaultAllocator());
+  Tensor<double> expected("expected", {10000}, Format({Sparse}));
+  expected(i) = b(i) + c(i);
+  expected.evaluate();
+  ASSERT_EQ(std::string::npos,
+            expected.getSource().find("__builtin_assume_aligned"));
+  ASSERT_TRUE(equals(expected, a));
+
+  a.assemble();
+  a.compute();
+  ASSERT_EQ(std::string::npos, a.getSource().find("__builtin_assume_aligned"));
+  ASSERT_TRUE(equals(expected, a));
+}
+
+TEST(alloc, arena) {
+  storage::Arena arena;
+  storage::setAllocator(arena.getAllocator());
+  Tensor<double> b = dla("b", Format({Sparse}));
+  Tensor<double> c = dlb("c", Format({Sparse}));
+  b.pack();
+  c.pack();
+
+  Tensor<double> a("a", {10000}, Format({Sparse}));
+  a(i) = b(i) + c(i);
+  a.evaluate();
+  ASSERT_EQ(0u, arena.getKeptBytes());
+
+  // Assembling again keeps the arrays of the previous assembly, which the
+  // assemblies after it reuse
+  a.assemble();
+  a.compute();
+  const size_t keptBytes = arena.getKeptBytes();
+  ASSERT_LT(0u, keptBytes);
+  a.assemble();
+  a.compute();
+  ASSERT_EQ(keptBytes, arena.getKeptBytes());
+
+  arena.clear();
+  ASSERT_EQ(0u, arena.getKeptBytes());
+  storage::setAllocator(storage::getDefaultAllocator());
+}
+
+TEST(alloc, memory_stats) {
+  Tensor<double> b = dla("b", Format({Sparse}));
+  Tensor<double> c = dlb("c", Format({Sparse}));
+  storage::resetPeakMemory();
+  const storage::MemoryStats before = storage::getMemoryStats();
+  b.pack();
+  c.pack();
+  const storage::MemoryStats packed = storage::getMemoryStats();
+  ASSERT_LE(before.liveBytes + b.getStorage().getSizeInBytes() +
+            c.getStorage().getSizeInBytes(), packed.liveBytes);
+  ASSERT_LT(packed.liveBytes, packed.peakBytes);
+  ASSERT_LT(before.numAllocations, packed.numAllocations);
+
+  size_t sizeInBytes = b.getStorage().getValuesSizeInBytes();
+  for (auto& modeSizes : b.getStorage().getIndexSizesInBytes()) {
+    for (size_t size : modeSizes) {
+      sizeInBytes += size;
+    }
+  }
+  ASSERT_EQ(b.getStorage().getSizeInBytes(), sizeInBytes);
+
+  // Kernels allocate through the allocator, so results are accounted
+  Tensor<double> a("a", {10000}, Format({Sparse}));
+  a(i) = b(i) + c(i);
+  a.compile();
+  storage::resetPeakMemory();
+  ASSERT_EQ(storage::getMemoryStats().liveBytes,
+            storage::getMemoryStats().peakBytes);
+  a.assemble();
+  a.compute();
+  ASSERT_LE(packed.liveBytes + a.getStorage().getSizeInBytes(),
+            storage::getMemoryStats().peakBytes);
+}
+
 }
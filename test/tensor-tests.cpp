@@ -4,6 +4,7 @@
 
 #include <vector>
 #include "taco/util/collections.h"
+#include "taco/storage/allocator.h"
 
 using namespace taco;
 
@@ -37,6 +38,29 @@ TEST(tensor, double_vector) {
   }
 }
 
+TEST(tensor, duplicates_keep_first) {
+  // Every coordinate is inserted several times, interleaved with the others,
+  // and the value inserted first is kept
+  Tensor<double> a({20,20}, CSR);
+  map<vector<int>,double> vals;
+  for (int round = 0; round < 5; ++round) {
+    for (int k = 0; k < 400; ++k) {
+      vector<int> coord = {(7*k) % 20, (k / 3) % 20};
+      double value = round * 1000 + k;
+      a.insert({coord[0], coord[1]}, value);
+      vals.insert({coord, value});
+    }
+  }
+  a.pack();
+  size_t numValues = 0;
+  for (auto val = a.beginTyped<int>(); val != a.endTyped<int>(); ++val) {
+    ASSERT_TRUE(util::contains(vals, val->first));
+    ASSERT_EQ(vals.at(val->first), val->second);
+    numValues++;
+  }
+  ASSERT_EQ(vals.size(), numValues);
+}
+
 TEST(tensor, iterate) {
   Tensor<double> a({5}, Sparse);
   a.insert({1}, 10.0);
@@ -96,3 +120,185 @@ TEST(tensor, transpose) {
   ASSERT_TRUE(equals(tensor.transpose({2,0,1}, Format({Sparse, Sparse, Dense}, {2, 1, 0})), transposedTensor2));
   ASSERT_TRUE(equals(tensor.transpose({0,1,2}), tensor));
 }
+
+TEST(tensor, convert) {
+  Tensor<double> A("A", {40,30}, CSR);
+  Tensor<double> Adense("Adense", {40,30}, Format({Dense,Dense}));
+  Tensor<double> At("At", {30,40}, CSR);
+  for (int i = 0; i < 40; ++i) {
+    for (int j = 0; j < 30; ++j) {
+      if ((7*i + 3*j) % 5 == 0) {
+        A.insert({i,j}, (double)(30*i + j + 1));
+        Adense.insert({i,j}, (double)(30*i + j + 1));
+        At.insert({j,i}, (double)(30*i + j + 1));
+      }
+    }
+  }
+  A.pack();
+  Adense.pack();
+  At.pack();
+  ASSERT_TRUE(equals(A.transpose({1,0}), At));
+
+  // Every source format converts to CSR and, with its stored zeros, to dense
+  const vector<Format> formats = {CSR, CSC, DCSR, COO, DIA, Format({Dense,Fixed}),
+                                  Format({Dense,Bitmap}), Format({Dense,Packed}),
+                                  Format({Dense,Hashed})};
+  for (const Format& format : formats) {
+    Tensor<double> B("B", {40,30}, format);
+    for (auto& value : A) {
+      B.insert({(int)value.first[0], (int)value.first[1]}, value.second);
+    }
+    B.pack();
+    Tensor<double> Bdense("Bdense", {40,30}, Format({Dense,Dense}));
+    Bdense.pack(B, {0,1});
+    ASSERT_TRUE(equals(Adense, Bdense)) << format;
+    if (format != DIA && format != Format({Dense,Fixed})) {
+      Tensor<double> Bcsr("Bcsr", {40,30}, CSR);
+      Bcsr.pack(B, {0,1});
+      ASSERT_TRUE(equals(A, Bcsr)) << format;
+    }
+  }
+
+  // Large conversions sort with several threads
+  Tensor<int> C("C", {512,512}, CSR);
+  Tensor<int> Ct("Ct", {512,512}, CSR);
+  for (int i = 0; i < 512; ++i) {
+    for (int j = 0; j < 512; ++j) {
+      if ((31*i + 17*j) % 3 != 0) {
+        C.insert({i,j}, i - j);
+        Ct.insert({j,i}, i - j);
+      }
+    }
+  }
+  C.pack();
+  Ct.pack();
+  ASSERT_TRUE(equals(C.transpose({1,0}), Ct));
+}
+
+TEST(tensor, convert_large_dimensions) {
+  // Conversions use memory proportional to the components and the result,
+  // not to the dimensions
+  const int n = 60000;
+  Tensor<double> A("A", {n,n}, CSR);
+  Tensor<double> At("At", {n,n}, CSR);
+  Tensor<double> Adcsc("Adcsc", {n,n}, DCSC);
+  for (int k = 0; k < 1000; ++k) {
+    int i = (int)((7919ll * k) % n);
+    int j = (int)((104729ll * k + 13) % n);
+    A.insert({i,j}, (double)(k+1));
+    At.insert({j,i}, (double)(k+1));
+    Adcsc.insert({i,j}, (double)(k+1));
+  }
+  A.pack();
+  At.pack();
+  Adcsc.pack();
+
+  Tensor<double> transposed = A.transpose({1,0}, CSR);
+  ASSERT_TRUE(equals(transposed, At));
+  ASSERT_LT(transposed.getStorage().getSizeInBytes(), 2*sizeof(int)*(n+1000));
+
+  Tensor<double> B("B", {n,n}, DCSC);
+  B.pack(A, {0,1});
+  ASSERT_TRUE(equals(B, Adcsc));
+  ASSERT_LT(B.getStorage().getSizeInBytes(), 64*1000u);
+}
+
+TEST(tensor, fixed_structure) {
+  Tensor<double> B("B", {20,20}, CSR);
+  Tensor<double> C("C", {20,20}, CSR);
+  for (int i = 0; i < 20; ++i) {
+    for (int j = 0; j < 20; ++j) {
+      if ((i + 3*j) % 4 == 0) B.insert({i,j}, (double)(i + j));
+      if ((2*i + j) % 5 == 0) C.insert({i,j}, (double)(i - j));
+    }
+  }
+  B.pack();
+  C.pack();
+
+  IndexVar i, j;
+  Tensor<double> A("A", {20,20}, CSR);
+  A.setFixedStructure(true);
+  A(i,j) = B(i,j) + C(i,j);
+  A.compile(true);
+  A.assemble();
+  A.compute();
+  const void* vals = A.getStorage().getValues().getData();
+
+  // New values of the operands are computed into the arrays of the first
+  // assembly
+  for (int iteration = 0; iteration < 3; ++iteration) {
+    double* Bvals = (double*)B.getStorage().getValues().getData();
+    for (size_t k = 0; k < B.getStorage().getValues().getSize(); ++k) {
+      Bvals[k] *= 2.0;
+    }
+    A.assemble();
+    A.compute();
+    ASSERT_EQ(vals, A.getStorage().getValues().getData());
+
+    Tensor<double> expected("expected", {20,20}, CSR);
+    expected(i,j) = B(i,j) + C(i,j);
+    expected.evaluate();
+    ASSERT_TRUE(equals(expected, A));
+  }
+
+  // Once the structure is no longer fixed, the tensor assembles while it
+  // computes again, as it was compiled to
+  A.setFixedStructure(false);
+  for (int i = 0; i < 20; ++i) {
+    C.insert({i,(3*i) % 20}, (double)i);
+  }
+  C.pack();
+  A.compute();
+  Tensor<double> expected("expected", {20,20}, CSR);
+  expected(i,j) = B(i,j) + C(i,j);
+  expected.evaluate();
+  ASSERT_TRUE(equals(expected, A));
+}
+
+TEST(tensor, pack_budget) {
+  const vector<Format> formats = {CSR, CSC, DCSR, COO, Format({Dense,Dense}),
+                                  Format({Sparse,Dense}),
+                                  Format({Dense,Packed}),
+                                  Format({Dense,Hashed})};
+  Tensor<double> Adense("Adense", {150,150}, Format({Dense,Dense}));
+  for (int i = 0; i < 150; ++i) {
+    for (int j = 0; j < 150; ++j) {
+      if ((7*i + 13*j) % 3 == 0 && i % 7 != 0) Adense.insert({i,j}, (double)(i*j));
+    }
+  }
+  Adense.pack();
+
+  // The coordinates are released as they are packed, so packing needs little
+  // memory besides them and the packed tensor
+  for (const Format& format : formats) {
+    Tensor<double> A("A", {150,150}, format);
+    A.setPackBudget(4096);
+    size_t numBytes = 0;
+    for (int j = 149; j >= 0; --j) {
+      for (int i = 0; i < 150; ++i) {
+        if ((7*i + 13*j) % 3 == 0 && i % 7 != 0) {
+          A.insert({i,j}, (double)(i*j));
+          numBytes += 2*sizeof(int) + sizeof(double);
+        }
+      }
+    }
+    storage::resetPeakMemory();
+    const size_t before = storage::getMemoryStats().liveBytes;
+    A.pack();
+    // Packed and hashed modes are encoded from a packed sparse mode
+    if (!isHashed(format) && format != Format({Dense,Packed})) {
+      ASSERT_GE(before + numBytes + A.getStorage().getSizeInBytes() + 65536,
+                storage::getMemoryStats().peakBytes) << format;
+    }
+    // Everything recorded while packing is released again, and the arrays
+    // are only accounted with the slack of their usable size
+    ASSERT_LE(before + A.getStorage().getSizeInBytes(),
+              storage::getMemoryStats().liveBytes) << format;
+    ASSERT_GT(before + A.getStorage().getSizeInBytes() + 256,
+              storage::getMemoryStats().liveBytes) << format;
+
+    Tensor<double> B("B", {150,150}, Format({Dense,Dense}));
+    B.pack(A, {0,1});
+    ASSERT_TRUE(equals(Adense, B)) << format;
+  }
+}
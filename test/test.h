@@ -79,7 +79,8 @@ void ASSERT_STORAGE_EQUALS(vector<vector<vector<int>>> expectedIndices,
         break;
       }
       case ModeType::Sparse:
-      case ModeType::Fixed: {
+      case ModeType::Fixed:
+      case ModeType::Diagonal: {
         taco_iassert(expectedIndices[i].size() == 2);
         ASSERT_EQ(2u, modeIndex.numIndexArrays());
         auto pos = modeIndex.getIndexArray(0);
@@ -90,6 +91,26 @@ void ASSERT_STORAGE_EQUALS(vector<vector<vector<int>>> expectedIndices,
                         {(int*)idx.getData(), idx.getSize()});
         break;
       }
+      case ModeType::Singleton: {
+        taco_iassert(expectedIndices[i].size() == 1);
+        ASSERT_EQ(1u, modeIndex.numIndexArrays());
+        auto idx = modeIndex.getIndexArray(0);
+        ASSERT_ARRAY_EQ(expectedIndices[i][0],
+                        {(int*)idx.getData(), idx.getSize()});
+        break;
+      }
+      case ModeType::Hashed:
+      case ModeType::Bitmap:
+      case ModeType::Packed: {
+        taco_iassert(expectedIndices[i].size() == 3);
+        ASSERT_EQ(3u, modeIndex.numIndexArrays());
+        for (size_t j = 0; j < 3; j++) {
+          auto array = modeIndex.getIndexArray(j);
+          ASSERT_ARRAY_EQ(expectedIndices[i][j],
+                          {(int*)array.getData(), array.getSize()});
+        }
+        break;
+      }
     }
   }
 
@@ -10,7 +10,9 @@
 
 #include "taco/error.h"
 #include "taco/parser/parser.h"
+#include "taco/index_notation/schedule.h"
 #include "taco/storage/storage.h"
+#include "taco/storage/allocator.h"
 #include "taco/ir/ir.h"
 #include "lower/lower_codegen.h"
 #include "lower/iterators.h"
@@ -39,11 +41,14 @@ using namespace taco;
 #define TOOL_BENCHMARK_TIMER(CODE,NAME,TIMER) {                  \
     if (time) {                                                  \
       taco::util::Timer timer;                                   \
+      taco::storage::resetPeakMemory();                          \
       timer.start();                                             \
       CODE;                                                      \
       timer.stop();                                              \
       taco::util::TimeResults result = timer.getResult();        \
-      cout << NAME << " " << result << " ms" << endl;            \
+      cout << NAME << " " << result << " ms, "                   \
+           << taco::storage::getMemoryStats().peakBytes          \
+           << " bytes peak" << endl;                             \
       TIMER=result;                                              \
     }                                                            \
     else {                                                       \
@@ -51,6 +56,22 @@ using namespace taco;
     }                                                            \
 }
 
+static void printMemory(const TensorBase& tensor) {
+  const storage::Storage& storage = tensor.getStorage();
+  vector<string> indexSizes;
+  for (auto& modeSizes : storage.getIndexSizesInBytes()) {
+    indexSizes.push_back("[" + util::join(modeSizes) + "]");
+  }
+  const storage::MemoryStats stats = storage::getMemoryStats();
+  cout << endl;
+  cout << tensor.getName() << " size: "
+       << "(" << util::join(tensor.getDimensions(), " x ") << "), "
+       << storage.getSizeInBytes() << " bytes (index: " << util::join(indexSizes)
+       << ", values: " << storage.getValuesSizeInBytes() << ")" << endl;
+  cout << "Memory: " << stats.liveBytes << " bytes live, "
+       << stats.numAllocations << " allocations" << endl;
+}
+
 static void printFlag(string flag, string text) {
   const size_t descriptionStart = 30;
   const size_t columnEnd        = 80;
@@ -70,7 +91,8 @@ static void printFlag(string flag, string text) {
   cout << endl;
 }
 
-static const string fileFormats = "(.tns .ttx .mtx .rb)";
+static const string fileFormats = "(.tns .ttx .mtx .rb .taco, which may be "
+                                  "compressed with .gz or .zst)";
 
 static void printUsageInfo() {
   cout << "Usage: taco <index expression> [options]" << endl;
@@ -90,9 +112,11 @@ static void printUsageInfo() {
   cout << endl;
   printFlag("f=<tensor>:<format>",
             "Specify the format of a tensor in the expression. Formats are "
-            "specified per dimension using d (dense) and s (sparse). "
-            "All formats default to dense. "
-            "Examples: A:ds, b:d and D:sss.");
+            "specified per dimension using d (dense), s (sparse), q "
+            "(singleton), h (hashed), b (bitmap) and p (packed). All formats "
+            "default to dense. "
+            "Examples: A:ds, b:d, D:sss, C:sq (coordinate list), "
+            "E:dh (hash map rows) and F:dp (bit-packed CSR).");
   cout << endl;
   printFlag("t=<tensor>:<data type>",
             "Specify the data type of a tensor (defaults to double)."
@@ -105,6 +129,14 @@ static void printUsageInfo() {
   printFlag("c",
             "Generate compute kernel that simultaneously does assembly.");
   cout << endl;
+  printFlag("unroll=<dimension>",
+            "Fully unroll loops over dense modes whose dimension is at most "
+            "<dimension> (defaults to 16).");
+  cout << endl;
+  printFlag("prefetch=<distance>",
+            "Prefetch operand values that are accessed through the indices of "
+            "a sparse mode <distance> loop iterations ahead (defaults to 16).");
+  cout << endl;
   printFlag("i=<tensor>:<filename>",
             "Read a tensor from a file " + fileFormats + ".");
   cout << endl;
@@ -123,7 +155,8 @@ static void printUsageInfo() {
   cout << endl;
   printFlag("time=<repeat>",
             "Time compilation, assembly and <repeat> times computation "
-            "(defaults to 1).");
+            "(defaults to 1), and report the peak memory of each step and "
+            "the memory of the result.");
   cout << endl;
   printFlag("write-time=<filename>",
             "Write computation times in csv format to <filename> "
@@ -207,6 +240,9 @@ int main(int argc, char* argv[]) {
   int  repeat = 1;
   taco::util::TimeResults timevalue;
 
+  size_t maxUnrolledDimension = 0;
+  size_t prefetchDistance = 0;
+
   string indexVarName = "";
 
   string exprStr;
@@ -253,6 +289,18 @@ int main(int argc, char* argv[]) {
           case 's':
             modeTypes.push_back(ModeType::Sparse);
             break;
+          case 'q':
+            modeTypes.push_back(ModeType::Singleton);
+            break;
+          case 'h':
+            modeTypes.push_back(ModeType::Hashed);
+            break;
+          case 'b':
+            modeTypes.push_back(ModeType::Bitmap);
+            break;
+          case 'p':
+            modeTypes.push_back(ModeType::Packed);
+            break;
           default:
             return reportError("Incorrect format descriptor", 3);
             break;
@@ -367,6 +415,28 @@ int main(int argc, char* argv[]) {
       }
       loaded = true;
     }
+    else if ("-unroll" == argName) {
+      maxUnrolledDimension = 16;
+      if (argValue != "") {
+        try {
+          maxUnrolledDimension = stoul(argValue);
+        }
+        catch (...) {
+          return reportError("Incorrect unroll descriptor", 3);
+        }
+      }
+    }
+    else if ("-prefetch" == argName) {
+      prefetchDistance = 16;
+      if (argValue != "") {
+        try {
+          prefetchDistance = stoul(argValue);
+        }
+        catch (...) {
+          return reportError("Incorrect prefetch descriptor", 3);
+        }
+      }
+    }
     else if ("-i" == argName) {
       vector<string> descriptor = util::split(argValue, ":");
       if (descriptor.size() != 2) {
@@ -502,6 +572,10 @@ int main(int argc, char* argv[]) {
     return reportError("Index variable is not in expression", 4);
   }
 
+  Schedule schedule = tensor.getTensorVar().getSchedule();
+  schedule.setMaxSpecializedDimension(maxUnrolledDimension);
+  schedule.setPrefetchDistance(prefetchDistance);
+
   // Generate tensors
   for (auto& fills : tensorsFill) {
     TensorBase tensor = parser.getTensor(fills.first);
@@ -536,6 +610,9 @@ int main(int argc, char* argv[]) {
     else {
       TOOL_BENCHMARK_REPEAT(tensor.compute(), "Compute", repeat);
     }
+    if (time) {
+      printMemory(tensor);
+    }
 
     for (auto& kernelFilename : kernelFilenames) {
       TensorBase kernelTensor;